@@ -1,8 +1,106 @@
 #include "adxlsimview.h"
 #include "ui_adxlsimview.h"
+#include "adxlsweep.h"
+#include "sweepdialog.h"
 
 using namespace cv;
 
+// Samples decoded at a time when the simulator is run in batches
+#define ADXL_BATCH_SAMPLES 65536
+
+namespace {
+/**
+ * Feeds every [stride]th sample of the acceleration columns to the simulator, [count] samples in all, and returns
+ * whether it is awake after each of them (see ADXLSimCore::run). Stops early if the run is canceled.
+ */
+QVector<quint64> runBatched(ADXLSimCore &adxl, const ColumnHandle &x, const ColumnHandle &y, const ColumnHandle &z, int stride, int count,
+                            LoadProgress &progress){
+    QVector<quint64> active((count + 63)/64 + 1, 0);
+    QVector<double> in[3];
+    const ColumnHandle *axes[3] = {&x, &y, &z};
+    // Batches start on a word of the mask, so that the mask can be written directly
+    for(int first=0; first<count && !progress.isCanceled(); first+=ADXL_BATCH_SAMPLES){
+        const int n = qMin(ADXL_BATCH_SAMPLES, count - first);
+        for(int axis=0; axis<3; axis++){
+            in[axis].resize(n);
+            axes[axis]->data()->readStrided(first*stride, n, stride, in[axis].data());
+        }
+        adxl.run(in[0].constData(), in[1].constData(), in[2].constData(), n, active.data() + first/64);
+        progress.add(qint64(n)*stride);
+    }
+    return active;
+}
+
+/**
+ * Simulates the ADXL on a worker thread, with the settings and acceleration columns the view gathered
+ */
+class ADXLSimJob : public SimulationJob
+{
+public:
+    ADXLSimCore adxl;
+    ColumnHandle accelX;
+    ColumnHandle accelY;
+    ColumnHandle accelZ;
+    int length;             // Samples simulated: all but the last
+    int downSample;
+    int idleDownSample;     // Downsample rate in wakeup mode when inactive
+    bool wakeupMode;
+
+protected:
+    bool simulateTimeline(ActivityTimeline &timeline, LoadProgress &progress, QString &error) override{
+        Q_UNUSED(error)
+        timeline.reset(length, downSample, idleDownSample);
+        progress.setTotal(length);
+        if(length == 0)
+            return true;
+
+        // With a fixed downsample rate, the samples fed to the simulator are known up front, so it is run over all of
+        // them at once. In wakeup mode the rate depends on the state, so samples are fed one by one.
+        if(!wakeupMode){
+            const int fedSamples = (length - 1)/downSample + 1;
+            const QVector<quint64> activeMask = runBatched(adxl, accelX, accelY, accelZ, downSample, fedSamples, progress);
+            if(progress.isCanceled())
+                return false;
+            timeline = ActivityTimeline::fromMask(activeMask.constData(), fedSamples, downSample, length);
+            return true;
+        }
+        bool active = false;
+        int start = 0;
+        // Read a batch at a time, so paged columns are not locked once per sample
+        ColumnReader readers[3] = {ColumnReader(accelX.data()), ColumnReader(accelY.data()), ColumnReader(accelZ.data())};
+        const double *in[3] = {nullptr, nullptr, nullptr};
+        int batchStart = 0;
+        for(int currentIndex=0; currentIndex<length; ++currentIndex){
+            if(currentIndex % ADXL_BATCH_SAMPLES == 0){
+                if(progress.isCanceled())
+                    return false;
+                const int n = qMin(ADXL_BATCH_SAMPLES, length - currentIndex);
+                for(int axis=0; axis<3; axis++){
+                    in[axis] = readers[axis].block(currentIndex, n);
+                }
+                batchStart = currentIndex;
+                progress.add(n);
+            }
+            // Only step the simulation every n samples. All other samples are interpolated, assuming the most recent states.
+            if((currentIndex % (active ? downSample : idleDownSample)) == 0){
+                const int i = currentIndex - batchStart;
+                adxl.next(in[0][i], in[1][i], in[2][i]);
+            }
+            if(adxl.isActive() != active){
+                active = !active;
+                if(active)
+                    start = currentIndex;
+                else
+                    timeline.append(start, currentIndex);
+            }
+        }
+        if(active)
+            timeline.append(start, length);
+        return true;
+    }
+};
+}
+
 ADXLSimView::ADXLSimView(QWidget *parent) :
     SimulatorTab(parent),
     ui(new Ui::ADXLSimView)
@@ -15,6 +113,16 @@ ADXLSimView::ADXLSimView(QWidget *parent) :
     deltaTVD = 0;
     rateMultiplier = 1.0;
     hasInit = false;
+    draggedMarker = NoMarker;
+    simulatingTimeline = false;
+    simulatingCounts = false;
+
+    applyTimer.setSingleShot(true);
+    applyTimer.setInterval(SIMULATION_DEBOUNCE_MS);
+    connect(&applyTimer, SIGNAL(timeout()), this, SLOT(on_buttonApply_clicked()));
+    connect(&simulation, SIGNAL(progressChanged(int)), this, SLOT(showSimulationProgress(int)));
+    connect(&simulation, SIGNAL(finished(SimulationResult)), this, SLOT(simulationFinished(SimulationResult)));
+    ui->progressBar_simulation->hide();
 
     connect(ui->xScrollBar, SIGNAL(valueChanged(int)), this, SLOT(horzScrollBarChanged(int)));
     connect(ui->customPlot->xAxis, SIGNAL(rangeChanged(QCPRange)), this, SLOT(xAxisChanged(QCPRange)));
@@ -25,6 +133,11 @@ ADXLSimView::ADXLSimView(QWidget *parent) :
     connect(ui->spinbox_inacttime, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
     connect(ui->spinbox_inactthresh, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
     connect(ui->spinbox_downsample, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    // Only the metrics depend on these, so updating is quick
+    connect(ui->spinbox_standbyenergy, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    connect(ui->spinbox_wakeupenergy, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    connect(ui->spinbox_energypersample, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    connect(ui->spinbox_bitspersample, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
 
     ui->playButton->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
     ui->forwardButton->setIcon(style()->standardIcon(QStyle::SP_MediaSkipForward));
@@ -78,11 +191,22 @@ void ADXLSimView::init(){
 
     ui->customPlot->replot();
 
-    // Set sample rate label. Also catch zero-div.
-    ui->label_samplerateactual->setText((dataLength>0)?QString::number(data->numRows()/(dataLength), 'f', 2):"0");
-
-    pathCoverage = new QHash<MotionPath *, double>();
+    // Set sample rate label. The rate is that of the longest uniformly sampled stretch, so gaps do not skew it.
+    const TimeIndex *timeIndex = data->timeIndex();
+    QString rateText = QString::number(timeIndex->sampleRate(), 'f', 2);
+    if(timeIndex->gaps().size() > 0){
+        rateText += QString(" (%1 gaps)").arg(timeIndex->gaps().size());
+    }
+    ui->label_samplerateactual->setText(rateText);
+
+    // New data, so everything is simulated again
+    stopSimulation();
+    timelineStage.invalidate();
+    countsStage.invalidate();
+    metricsStage.invalidate();
+    renderStage.invalidate();
     hasInit = true;
+    showVideoActive();
 }
 
 ADXLSimView::~ADXLSimView()
@@ -188,213 +312,244 @@ int ADXLSimView::dataTimeToFrame(double dataTime){
     return int((dataTime - deltaTVD)/rateMultiplier*1000.0/ui->vidWidget->getFrameInterval());
 }
 
+/**
+ * @brief ADXLSimView::on_buttonApply_clicked Brings the simulation up to date. It runs in stages, each of which is only
+ * recomputed when its inputs changed: the timeline of the simulator's state, the counts over the statistics window,
+ * the metrics derived from the counts, and the plot of the timeline. Editing the energy model, for instance, only
+ * recomputes the metrics. The timeline and the counts are computed on a worker thread, and the rest follows once they
+ * are published (see simulationFinished).
+ */
 void ADXLSimView::on_buttonApply_clicked()
 {
+    applyTimer.stop();
+    // The run in progress is superseded
+    stopSimulation();
+
+    const QVariant annotations = annotationInputs();
+
+    QVariantList timelineInputs;
+    timelineInputs << ui->spinbox_actthresh->value() << ui->spinbox_inactthresh->value() << ui->spinbox_acttime->value()
+                   << ui->spinbox_inacttime->value() << ui->spinbox_downsample->value() << ui->checkBox_adxlWakeup->isChecked();
+    const bool simulate = timelineStage.update(timelineInputs);
+
+    QVariantList countsInputs;
+    countsInputs << timelineStage.generation() << simStart << simEnd << deltaTVD << rateMultiplier
+                 << ui->vidWidget->getFrameInterval() << ui->groupBox_eventCoverage->isChecked() << annotations;
+    const bool count = countsStage.update(countsInputs);
+
+    if(simulate || count){
+        QSharedPointer<SimulationJob> job = simulationJob(simulate);
+        if(job.isNull()){
+            timelineStage.invalidate();
+            countsStage.invalidate();
+            return;
+        }
+        if(count){
+            job->count = true;
+            job->eventCoverage = ui->groupBox_eventCoverage->isChecked();
+            SimulationInput input = simulationInput();
+            if(!job->eventCoverage)
+                input.events.clear();
+            // Without enough data to simulate, everything counts zero
+            job->stats.prepare(input);
+        }
+        simulatingTimeline = simulate;
+        simulatingCounts = count;
+        simulation.start(job);
+        return;
+    }
+    showOutputs();
+}
 
-    plotMotionTracks();
+/**
+ * @brief ADXLSimView::simulationFinished Publishes the results of a run, and brings the metrics and the plot up to date
+ */
+void ADXLSimView::simulationFinished(SimulationResult result){
+    ui->progressBar_simulation->hide();
+    simulatingTimeline = false;
+    simulatingCounts = false;
+    // Nothing computed from data that could not be read is published
+    if(result.error.isEmpty())
+        result.error = data->getErrorString();
+    if(!result.error.isEmpty()){
+        timelineStage.invalidate();
+        countsStage.invalidate();
+        QMessageBox::warning(this, "", result.error);
+        return;
+    }
+    if(result.hasTimeline){
+        timeline = result.timeline;
+    }
+    if(result.hasCounts){
+        stats = result.stats;
+        counts = result.counts;
+        coverage = result.coverage;
+        activeRegionList = result.regions;
+    }
+    showOutputs();
+}
+
+/**
+ * @brief ADXLSimView::stopSimulation Cancels the run in progress, if any, without waiting for it. Whatever it was
+ * computing is computed again on the next update.
+ * @return true if a run was canceled
+ */
+bool ADXLSimView::stopSimulation(){
+    ui->progressBar_simulation->hide();
+    if(!simulation.cancel())
+        return false;
+    if(simulatingTimeline)
+        timelineStage.invalidate();
+    if(simulatingCounts)
+        countsStage.invalidate();
+    simulatingTimeline = false;
+    simulatingCounts = false;
+    return true;
+}
+
+void ADXLSimView::showSimulationProgress(int percent){
+    ui->progressBar_simulation->setValue(percent);
+    ui->progressBar_simulation->show();
+}
+
+/**
+ * @brief ADXLSimView::showOutputs Brings the metrics and the plot up to date with the published timeline and counts
+ */
+void ADXLSimView::showOutputs(){
+    QVariantList metricsInputs;
+    metricsInputs << countsStage.generation() << ui->spinbox_standbyenergy->value() << ui->spinbox_wakeupenergy->value()
+                  << ui->spinbox_energypersample->value() << ui->spinbox_bitspersample->value();
+    if(metricsStage.update(metricsInputs))
+        showMetrics();
+
+    QVariantList renderInputs;
+    renderInputs << timelineStage.generation() << deltaTVD << rateMultiplier << annotationInputs();
+    if(renderStage.update(renderInputs))
+        plotTimeline();
+}
+
+// Start and end frame of every annotated event, to tell when they change
+QVariant ADXLSimView::annotationInputs() const{
+    QVariantList frames;
+    for(MotionPath *p: *paths){
+        frames << p->start << p->end;
+    }
+    return frames;
+}
+
+/**
+ * @brief ADXLSimView::simulationJob Gathers the settings of the simulator and binds the acceleration columns, for a run
+ * on a worker thread
+ * @param simulate Whether the run is to simulate a new timeline, or to score the current one
+ * @return null if the data cannot be simulated
+ */
+QSharedPointer<SimulationJob> ADXLSimView::simulationJob(bool simulate){
+    QSharedPointer<ADXLSimJob> job(new ADXLSimJob());
+    job->simulate = simulate;
+    if(!simulate){
+        job->timeline = timeline;
+        return job;
+    }
 
     double threshAct = ui->spinbox_actthresh->value();
     double threshInact = ui->spinbox_inactthresh->value();
     int timeAct = ui->spinbox_acttime->value();
     int timeInact = ui->spinbox_inacttime->value();
-    // Quick check to make sure it's not zero
-    double samplerate = (dataLength > 0)?(data->numRows() / dataLength):0;
-
-    adxl = new ADXLSim2(threshAct, threshInact, timeAct, timeInact);
-
-    bool state_prev = false;
-    int firstActive = 0;
-    int lastActive = 0;
-    int totalActiveRegions = 0;
-    int totalActiveSamples = 0;
-    int samplesPerChunk = 1;
-
-    int currentIndex = 0;
-    int totalSamples = data->numRows();
-    int totalSamplesStat = 0; // Total number of samples within statistics window
-
     int downSample = ui->spinbox_downsample->value();
-    int samplesPerChunkDownSampled = 0;
-
-    int correctSamples = 0;
-    int falsePositives = 0;
-    int falseNegatives = 0;
-
-    int correctEvents = 0;
-    int falsePositiveEvents = 0;
-    bool annotationThisWakeup = false;
-
-    int frameStatStart = dataTimeToFrame(simStart);
-    int frameStatEnd = dataTimeToFrame(simEnd);
+    double samplerate = data->timeIndex()->sampleRate();
+    int totalSamples = data->numRows();
 
-    int wakeupDownSample = int(ceil(samplerate/6.0)); // Calculate downsample rate in wakeup mode when inactive (6 Hz)
     bool wakeupMode = false;
-
-    int currentDownSample = downSample;
-
-    activeRegionList.clear();
-
     if(ui->checkBox_adxlWakeup->isChecked()){
         timeAct = 1;
         wakeupMode = true;
     }
 
-    bool activebit = false;
-
-    pathCoverage->clear();
-    if(ui->groupBox_eventCoverage->isChecked()){
-        for(MotionPath *p: *paths){
-            if(p->end > frameStatStart && p->start <= frameStatEnd)
-                pathCoverage->insert(p, 0);
-        }
+    job->adxl = ADXLSimCore(threshAct, threshInact, timeAct, timeInact);
+    // The last sample is never simulated
+    job->length = qMax(0, totalSamples - 1);
+    job->downSample = downSample;
+    job->idleDownSample = wakeupMode ? int(ceil(samplerate/6.0)) : downSample; // Downsample rate in wakeup mode when inactive (6 Hz)
+    job->wakeupMode = wakeupMode;
+
+    // Bind to the acceleration channels once, whatever the data file calls them. Columns are read in here, so that the
+    // worker only reads them.
+    job->accelX = data->handle(Channel::AccelX);
+    job->accelY = data->handle(Channel::AccelY);
+    job->accelZ = data->handle(Channel::AccelZ);
+    if(!job->accelX.isValid() || !job->accelY.isValid() || !job->accelZ.isValid()){
+        QMessageBox::warning(this, "", "ADXL Simulator requires acceleration data, e.g. columns \"X\", \"Y\", and \"Z\"");
+        return QSharedPointer<SimulationJob>();
     }
+    return job;
+}
 
-    while(currentIndex + samplesPerChunk < totalSamples){
-        if(wakeupMode){
-            if(!activebit){
-                currentDownSample = wakeupDownSample;
-            }
-            else{
-                currentDownSample = downSample;
-            }
-        }
-        for(int chunkSamples = 0; chunkSamples < samplesPerChunk; ++chunkSamples){
-            int sampleIndex = currentIndex + chunkSamples;
-            // Only step the simulation every n samples. All other samples are interpolated, assuming the most recent states.
-            if((sampleIndex % currentDownSample) == 0)
-            {
-                samplesPerChunkDownSampled ++;
-                if (data->getColumn("X") == nullptr || data->getColumn("Y") == nullptr || data->getColumn("Z") == nullptr){
-                    QMessageBox::warning(this, "", "ADXL Simulator requires data with columns \"X\", \"Y\", and \"Z\"");
-                    return;
-                }
-                adxl->next(data->getColumn("X")->at(sampleIndex),
-                           data->getColumn("Y")->at(sampleIndex),
-                           data->getColumn("Z")->at(sampleIndex));
-                if (data->timeColumnData()->at(sampleIndex) >= simStart && data->timeColumnData()->at(sampleIndex) <= simEnd){
-                    totalSamplesStat ++;
-                }
-            }
-        }
-
-        activebit = adxl->isActive();
-
-        bool activeAnnotation = false; // Active bit from annotation
-        qreal currentTime = data->timeColumnData()->at(currentIndex);
-        int currentVideoFrame = dataTimeToFrame(currentTime);
-
-        if (currentTime >= simStart && currentTime <= simEnd){
-            // Find out if there's an annotation at the present location
-            if(ui->groupBox_eventCoverage->isChecked()){
-                for(MotionPath *p: pathCoverage->keys()){
-
-                    if(p->start <= currentVideoFrame && p->end > currentVideoFrame){
-                        activeAnnotation = true;
-                        if(activebit){
-                            pathCoverage->insert(p, pathCoverage->value(p)+((1.0/samplerate)/(ui->vidWidget->getFrameInterval()/1000.0))); // Increment this path's count by the number of frames covered by one sample
-
-                        }
-                    }
-                }
-            }
-            if(activebit){
-                totalActiveSamples += samplesPerChunkDownSampled;
-            }
-            if(ui->groupBox_eventCoverage->isChecked()){
-                if(activebit){
-                    if(activeAnnotation){
-                        correctSamples ++;
-                        annotationThisWakeup = true;
-                    }
-                    else{
-                        falsePositives ++;
-                    }
-                }
-                else{
-                    if(activeAnnotation){
-                        falseNegatives ++;
-                    }
-                    else{
-                        correctSamples ++;
-                    }
-
-                }
-            }
-        }
-        samplesPerChunkDownSampled = 0;
-        // Detect transitions from active -> inactive and vice versa
-
-        if(state_prev != activebit){
-            state_prev = activebit;
-
-            // Transition from active to inactive
-            if(!activebit){
-                if (currentTime >= simStart && currentTime <= simEnd && ui->groupBox_eventCoverage->isChecked()){
-                    double activeRegionLength = (samplerate > 0)?((currentIndex - firstActive)/samplerate):0;
-                    if(!annotationThisWakeup){
-                        falsePositiveEvents ++;
-                        activeRegionList.append(QPair<double, bool>(activeRegionLength, false));
-                    }else{
-                        correctEvents ++;
-                        activeRegionList.append(QPair<double, bool>(activeRegionLength, true));
-                    }
-                }
-                lastActive = currentIndex;
-            }
-
-            // Transition from inactive to active
-            else if(activebit){
-                firstActive = currentIndex;
-                annotationThisWakeup = false;
-                if (currentTime >= simStart && currentTime <= simEnd){
-                    ++totalActiveRegions;
-                }
-
-                QCPItemRect *rect = new QCPItemRect(ui->customPlot);
-                //Set rectangles to go off screen
-                rect->topLeft->setCoords(data->timeColumnData()->at(lastActive), ui->customPlot->yAxis->range().upper+1);
-                rect->bottomRight->setCoords(currentTime, ui->customPlot->yAxis->range().lower-1);
-                rect->setBrush(QBrush(QColor(127, 127, 127, 200)));
-            }
-        }
-        currentIndex += samplesPerChunk;
+/**
+ * @brief ADXLSimView::simulationInput The data and annotations the simulation is scored against
+ */
+SimulationInput ADXLSimView::simulationInput(){
+    SimulationInput input;
+    input.data = data;
+    input.statStart = simStart;
+    input.statEnd = simEnd;
+    for(MotionPath *p: *paths){
+        input.events.append(qMakePair(p->start, p->end));
     }
+    input.deltaTVD = deltaTVD;
+    input.rateMultiplier = rateMultiplier;
+    input.frameInterval = ui->vidWidget->getFrameInterval();
+    return input;
+}
 
-    // Do some additional calculations, and display the results
+/**
+ * @brief ADXLSimView::showMetrics Shows the counts, and the energy and storage they take
+ */
+void ADXLSimView::showMetrics(){
+    double samplerate = data->timeIndex()->sampleRate();
 
-    double totalEnergy = (ui->spinbox_standbyenergy->value()*(totalSamplesStat-totalActiveSamples) +
-                          ui->spinbox_wakeupenergy->value()*totalActiveRegions +
-                          ui->spinbox_energypersample->value()*totalActiveSamples)/1000.0;
+    double totalEnergy = (ui->spinbox_standbyenergy->value()*(counts.samples-counts.activeSamples) +
+                          ui->spinbox_wakeupenergy->value()*counts.wakeups +
+                          ui->spinbox_energypersample->value()*counts.activeSamples)/1000.0;
 
-    double storagekB = ui->spinbox_bitspersample->value()*totalActiveSamples/1000.0;
+    double storagekB = ui->spinbox_bitspersample->value()*counts.activeSamples/1000.0;
 
     ui->label_powerconsumed->setText(QString::number(totalEnergy, 'f', 2));
     ui->label_totalstorage->setText(QString::number(storagekB, 'f', 2));
 
-    ui->label_samples->setText(QString::number(totalSamplesStat));
-    ui->label_activesamples->setText(QString::number(totalActiveSamples));
-    ui->label_sampleratesim->setText(QString::number(samplerate/downSample, 'f', 2));
-    ui->label_wakeups->setText(QString::number(totalActiveRegions));
-    double percentActive = (currentIndex > 0)?double(totalActiveSamples)/totalSamplesStat*100:0;
+    ui->label_samples->setText(QString::number(counts.samples));
+    ui->label_activesamples->setText(QString::number(counts.activeSamples));
+    ui->label_sampleratesim->setText(QString::number(samplerate/timeline.activeStride(), 'f', 2));
+    ui->label_wakeups->setText(QString::number(counts.wakeups));
+    double percentActive = (counts.samples > 0)?double(counts.activeSamples)/counts.samples*100:0;
     ui->label_activepercent->setText(QString::number(percentActive, 'f', 1)); //Display percentage rounded to 1 decimal
 
-    ui->customPlot->replot();
-
     if(ui->groupBox_eventCoverage->isChecked()){
-        int coveredEvents = 0;
-        for(MotionPath *p: pathCoverage->keys()){
-            if(pathCoverage->value(p) >= 0.5*(p->end-p->start)){
-                coveredEvents++;
-            }
-        }
-        ui->label_correctsamples->setText(QString::number(correctSamples));
-        ui->label_falsepsamples->setText(QString::number(falsePositives));
-        ui->label_falsensamples->setText(QString::number(falseNegatives));
-        ui->label_correctevents->setText(QString::number(coveredEvents));
-        ui->label_falsepevents->setText(QString::number(falsePositiveEvents));
-        ui->label_falsenevents->setText(QString::number(pathCoverage->size()-coveredEvents));
-        ui->label_annotationCount->setText(QString::number(pathCoverage->size()));
+        ui->label_correctsamples->setText(QString::number(counts.correctSamples));
+        ui->label_falsepsamples->setText(QString::number(counts.falsePositiveSamples));
+        ui->label_falsensamples->setText(QString::number(counts.falseNegativeSamples));
+        ui->label_correctevents->setText(QString::number(counts.coveredEvents));
+        ui->label_falsepevents->setText(QString::number(counts.falsePositiveEvents));
+        ui->label_falsenevents->setText(QString::number(stats.numEvents()-counts.coveredEvents));
+        ui->label_annotationCount->setText(QString::number(stats.numEvents()));
+    }
+}
+
+/**
+ * @brief ADXLSimView::plotTimeline Plots the annotations, and shades the stretches where the simulator is inactive
+ */
+void ADXLSimView::plotTimeline(){
+    plotMotionTracks();
+
+    const TimeSeriesColumn *time = data->timeColumnData();
+    for(int i=0; i<timeline.size(); ++i){
+        const int lastActive = (i > 0) ? timeline.at(i - 1).end : 0;
+        QCPItemRect *rect = new QCPItemRect(ui->customPlot);
+        //Set rectangles to go off screen
+        rect->topLeft->setCoords(time->at(lastActive), ui->customPlot->yAxis->range().upper+1);
+        rect->bottomRight->setCoords(time->at(timeline.at(i).start), ui->customPlot->yAxis->range().lower-1);
+        rect->setBrush(QBrush(QColor(127, 127, 127, 200)));
     }
+    ui->customPlot->replot();
 }
 
 
@@ -513,6 +668,9 @@ void ADXLSimView::attachCap(VideoCapture *cap){
 }
 
 void ADXLSimView::attachTimeSeries(TimeSeries *ts){
+    // Runs may still be reading the old data, which is deleted next
+    stopSimulation();
+    simulation.wait();
     this->data = ts;
 }
 
@@ -534,6 +692,9 @@ void ADXLSimView::on_clipList_itemClicked(QListWidgetItem *item){
 }
 
 void ADXLSimView::updatePathList(QList<MotionPath *> *paths){
+    occupancy.update(*paths);
+    showVideoActive();
+
     namesToPath->clear();
     ui->clipList->clear();
     for(MotionPath *p : *paths){
@@ -547,8 +708,11 @@ void ADXLSimView::updatePathList(QList<MotionPath *> *paths){
         ui->clipList->addItem(name);
     }
 
-    if (hasInit)
+    if (hasInit){
         plotMotionTracks();
+        // That cleared the plot of the timeline
+        renderStage.invalidate();
+    }
 }
 
 void ADXLSimView::updateSync(double startTime, double rate){
@@ -562,17 +726,51 @@ void ADXLSimView::updateSync(double startTime, double rate){
 }
 
 void ADXLSimView::on_customPlot_mousePress(QMouseEvent *e){
+    // A press on a statistics marker grabs it, rather than seeking
+    if(hasInit && e->button() == Qt::LeftButton){
+        if(qAbs(e->x() - ui->customPlot->xAxis->coordToPixel(simStart)) <= STAT_MARKER_GRAB_PIXELS){
+            draggedMarker = StartMarker;
+            return;
+        }
+        if(qAbs(e->x() - ui->customPlot->xAxis->coordToPixel(simEnd)) <= STAT_MARKER_GRAB_PIXELS){
+            draggedMarker = EndMarker;
+            return;
+        }
+    }
     double x,y;
     ui->customPlot->graph(0)->pixelsToCoords(e->x(), e->y(), x, y);
     ui->vidWidget->seek_ms(((x-deltaTVD)/rateMultiplier)*1000);
 }
 
 void ADXLSimView::on_customPlot_mouseMove(QMouseEvent *e){
+    // The window's labels follow the marker; the simulation is only updated once it is dropped
+    if(draggedMarker != NoMarker){
+        double x = ui->customPlot->xAxis->pixelToCoord(e->x());
+        if(draggedMarker == StartMarker){
+            updateStat(x, simEnd);
+        }
+        else{
+            updateStat(simStart, x);
+        }
+        return;
+    }
     if(e->buttons() & Qt::LeftButton){
         on_customPlot_mousePress(e);
     }
 }
 
+void ADXLSimView::on_customPlot_mouseRelease(QMouseEvent *e){
+    Q_UNUSED(e)
+    if(draggedMarker == NoMarker){
+        return;
+    }
+    draggedMarker = NoMarker;
+    if (ui->checkBox_autoUpdate->isChecked()){
+        on_buttonApply_clicked();
+    }
+    emit statChanged(simStart, simEnd);
+}
+
 void ADXLSimView::on_magnify_toggled(bool checked)
 {
     ui->vidWidget->setMagnify(checked);
@@ -625,44 +823,22 @@ void ADXLSimView::on_customPlot_doubleClick(QMouseEvent *e){
     default:
         break;
     }
-
-
-    // Compute annotation active percentage within statistics region
-    int frameStart = 0;
-    int frameEnd = 0;
-
-    if(ui->vidWidget->getFrameInterval() >= 0){
-        frameStart = dataTimeToFrame(simStart);
-        frameEnd = dataTimeToFrame(simEnd);
-    }
-
-    int totalLength = 0;
-    // Count motion paths, but don't double-count
-    for(int i=frameStart; i<frameEnd; ++i){
-        for (MotionPath *p: *paths){
-            if(p->start <= i && p->end > i){
-                totalLength ++;
-                break;
-            }
-        }
-    }
-
-    qDebug() << totalLength;
-    ui->label_videoActive->setText(QString::number(double(100*totalLength)/(frameEnd-frameStart), 'f', 2));
+    showVideoActive();
 }
 
 
 void ADXLSimView::ADXL_spinbox_valueChanged(QString arg1)
 {
     Q_UNUSED(arg1)
+    // Holding down a spinbox's arrow only updates once it is let go
     if (ui->checkBox_autoUpdate->isChecked()){
-        on_buttonApply_clicked();
+        applyTimer.start();
     }
 }
 
 void ADXLSimView::on_button_exportcoverage_clicked()
 {
-    if (pathCoverage->empty()){
+    if (coverage.isEmpty()){
         QMessageBox::warning(this, "", "No coverage data to export. Click \"Apply\" to generate data or adjust simulation bounds to include annotations.");
         return;
     }
@@ -671,21 +847,8 @@ void ADXLSimView::on_button_exportcoverage_clicked()
 
     if(!saveFileName.isEmpty()){
         QFile coverageFile(saveFileName);
-        coverageFile.open(QFile::WriteOnly);\
-        // Write header
-        coverageFile.write("Start,Length,Coverage Percent\n");
-        for(MotionPath *p: (pathCoverage->keys())){
-            double pathStartTime = frameToDataTime(p->start);
-            double pathEndTime = frameToDataTime(p->end);
-            double pathLength = pathEndTime-pathStartTime;
-            // Cap value to 100 if it exceeds it.
-            double coveragePercent = qMin(100.0, pathLength>0?(100*pathCoverage->value(p)/(p->end-p->start)):0);
-
-            coverageFile.write(QString("%1,%2,%3\n")
-                               .arg(pathStartTime)
-                               .arg(pathLength)
-                               .arg(coveragePercent).toLatin1());
-        }
+        coverageFile.open(QFile::WriteOnly);
+        stats.writeCoverage(&coverageFile, coverage);
         coverageFile.close();
     }
 }
@@ -711,9 +874,25 @@ void ADXLSimView::updateStat(double start, double end){
     plotStatEnd->point1->setCoords(simEnd, 0);
     plotStatEnd->point2->setCoords(simEnd, 1);
 
+    showVideoActive();
     ui->customPlot->replot();
 }
 
+/**
+ * @brief ADXLSimView::showVideoActive Shows the percentage of the video frames in the statistics window that are
+ * annotated
+ */
+void ADXLSimView::showVideoActive(){
+    int frameStart = 0;
+    int frameEnd = 0;
+
+    if(ui->vidWidget->getFrameInterval() > 0){
+        frameStart = dataTimeToFrame(simStart);
+        frameEnd = dataTimeToFrame(simEnd);
+    }
+    ui->label_videoActive->setText(QString::number(occupancy.annotatedPercent(frameStart, frameEnd), 'f', 2));
+}
+
 void ADXLSimView::on_button_exportactive_clicked()
 {
     if (activeRegionList.isEmpty()){
@@ -734,3 +913,44 @@ void ADXLSimView::on_button_exportactive_clicked()
         eventFile.close();
     }
 }
+
+void ADXLSimView::on_button_sweep_clicked()
+{
+    if(!hasInit){
+        return;
+    }
+    // The sweep takes every core, so the run in progress is canceled, and redone afterwards if the sweep is not used
+    const bool interrupted = stopSimulation();
+    SimulationInput input = simulationInput();
+
+    EnergyModel energy;
+    energy.standby = ui->spinbox_standbyenergy->value();
+    energy.wakeup = ui->spinbox_wakeupenergy->value();
+    energy.perSample = ui->spinbox_energypersample->value();
+
+    QVector<double> current(5);
+    current[ADXLSweep::ThreshAct] = ui->spinbox_actthresh->value();
+    current[ADXLSweep::ThreshInact] = ui->spinbox_inactthresh->value();
+    current[ADXLSweep::TimeAct] = ui->spinbox_acttime->value();
+    current[ADXLSweep::TimeInact] = ui->spinbox_inacttime->value();
+    current[ADXLSweep::DownSample] = ui->spinbox_downsample->value();
+
+    ADXLSweep sweep(input);
+    SweepDialog dialog(&sweep, energy, current, this);
+    dialog.setWindowTitle("ADXL Parameter Sweep");
+    if(dialog.exec() == QDialog::Accepted){
+        // Sweeps do not use wakeup mode, so neither does the configuration picked from one
+        const QVector<double> config = dialog.selectedConfig();
+        ui->checkBox_adxlWakeup->setChecked(false);
+        ui->spinbox_actthresh->setValue(config.at(ADXLSweep::ThreshAct));
+        ui->spinbox_inactthresh->setValue(config.at(ADXLSweep::ThreshInact));
+        ui->spinbox_acttime->setValue(int(config.at(ADXLSweep::TimeAct)));
+        ui->spinbox_inacttime->setValue(int(config.at(ADXLSweep::TimeInact)));
+        ui->spinbox_downsample->setValue(int(config.at(ADXLSweep::DownSample)));
+        ui->groupBox_eventCoverage->setChecked(true);
+        on_buttonApply_clicked();
+    }
+    else if(interrupted){
+        on_buttonApply_clicked();
+    }
+}
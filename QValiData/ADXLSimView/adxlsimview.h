@@ -12,6 +12,11 @@
 #include "qcpplottimeseries.h"
 #include <QMessageBox>
 #include "simulatortab.h"
+#include "simulationstage.h"
+#include "activitytimeline.h"
+#include "activitystats.h"
+#include "frameoccupancy.h"
+#include "simulationrunner.h"
 
 namespace Ui {
 class ADXLSimView;
@@ -65,6 +70,8 @@ private slots:
 
     void on_customPlot_mouseMove(QMouseEvent *e);
 
+    void on_customPlot_mouseRelease(QMouseEvent *e);
+
     void on_customPlot_doubleClick(QMouseEvent *e);
 
     void on_magnify_toggled(bool checked);
@@ -79,6 +86,12 @@ private slots:
 
     void on_button_exportactive_clicked();
 
+    void on_button_sweep_clicked();
+
+    void simulationFinished(SimulationResult result);
+
+    void showSimulationProgress(int percent);
+
 public slots:
     void syncCap() override;
     void syncPath() override;
@@ -89,7 +102,6 @@ public slots:
 private:
     Ui::ADXLSimView *ui;
     TimeSeries *data;
-    ADXLSim2 *adxl;
 
     qreal dataLength;
 
@@ -107,8 +119,8 @@ private:
     QCPItemText *plotStatStartText;
     QCPItemText *plotStatEndText;
 
-    // Counts how many active samples cover each given path, in frames
-    QHash<MotionPath*, double> *pathCoverage;
+    // Frames of each annotated event in the statistics window covered by active samples, in the order of stats' events
+    QVector<double> coverage;
 
     // double = length of active region, in seconds. true = correct, false = false positive
     QList<QPair<double, bool>> activeRegionList;
@@ -121,8 +133,46 @@ private:
     double simStart;
     double simEnd;
 
+    // Annotated video frames, for the share of the statistics window that is annotated
+    FrameOccupancy occupancy;
+
+    // Statistics marker being dragged with the mouse, if any
+    enum StatMarker{
+        NoMarker,
+        StartMarker,
+        EndMarker
+    };
+    StatMarker draggedMarker;
+
+    // Stages of the simulation, each only recomputed when its inputs change (see on_buttonApply_clicked)
+    SimulationStage timelineStage;
+    SimulationStage countsStage;
+    SimulationStage metricsStage;
+    SimulationStage renderStage;
+
+    // Runs the timeline and counts stages on a worker thread. applyTimer holds off auto-updates while settings change.
+    SimulationRunner simulation;
+    QTimer applyTimer;
+    bool simulatingTimeline;
+    bool simulatingCounts;
+
+    // Where the simulator is active
+    ActivityTimeline timeline;
+
+    // Scores the timeline against the annotations over the statistics window
+    ActivityStats stats;
+    ActivityCounts counts;
+
     int dataTimeToFrame(double dataTime);
     double frameToDataTime(int frame);
+    QVariant annotationInputs() const;
+    SimulationInput simulationInput();
+    QSharedPointer<SimulationJob> simulationJob(bool simulate);
+    bool stopSimulation();
+    void showMetrics();
+    void plotTimeline();
+    void showOutputs();
+    void showVideoActive();
 
 signals:
     void statChanged(double start, double end);
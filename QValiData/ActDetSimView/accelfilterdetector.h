@@ -3,31 +3,30 @@
 
 #include <QMap>
 
-#include "activitydetector.h"
+#include "detectorpipeline.h"
 #include "Iir.h"
 
 #define FILTER_ORDER 4
 
-class AccelFilterDetector : public ActivityDetector
+/**
+ * @brief The AccelFilterDetector class emulates a bio-logger equipped with 3-axis accelerometer and a high pass fourth
+ * order Butterworth Filter. The energy expenditure of a single movement roughly correlates with the frequency of its
+ * accelerations, so this activity detector can be used to detect high-energy movements, such as flight in birds.
+ *
+ * Each axis has a filter of its own. Versions before the parameter sweep was added ran all three axes through the X
+ * axis filter, so their results differ from this detector's for the same data and configuration.
+ *
+ * Configuration values are:
+ *      1. "samplerate": Sample Rate, in Hertz, of source data
+ *      2. "cutoff": Cutoff frequency of the filter, which is lowest frequency that still retains half its power after passing through the filter.
+ *      3. "thresh": Acceleration threshold for triggering "Active" state
+ *      4. "delaytime": Number of seconds of continuous activity exceeding the threshold before transitioning to "Active"
+ *      5. "holdtime": Number of seconds to keep an "Active" state when there is no activity. Small values can group several short activity events into a single large event, reducing the number of wakeups.
+ */
+class AccelFilterDetector : public Pipeline<Stage::HighPass<FILTER_ORDER>, Stage::Max, Stage::Threshold, Stage::DelayHold>
 {
 public:
     AccelFilterDetector();
-
-    bool config(QMap<QString, qreal> config) override;
-    bool next(QMap<QString, qreal> sample) override;
-    bool isActive() override;
-    QString getErrorString() override;
-
-private:
-    Iir::Butterworth::HighPass<FILTER_ORDER> highPassX, highPassY, highPassZ;
-    int holdTimeSet;
-    int holdTimeCounter;
-    int delayTimeSet;
-    int delayTimeCounter;
-    bool active;
-    double thresh;
-    double xPrev, yPrev, zPrev;
-    QString errorString;
 };
 
 #endif // ACCELFILTERDETECTOR_H
@@ -0,0 +1,157 @@
+#include "accelfiltersweep.h"
+#include "accelfilterdetector.h"
+#include <QtConcurrent>
+#include <algorithm>
+
+AccelFilterSweep::AccelFilterSweep(const SimulationInput &input) : ParameterSweep(input)
+{
+    samplerate = 0;
+}
+
+/**
+ * @brief AccelFilterSweep::parameters By default, the threshold is swept around the current one, and the rest are kept
+ */
+QList<SweepParameter> AccelFilterSweep::parameters(const QVector<double> &current) const{
+    QList<SweepParameter> list;
+    list << SweepParameter{"Cutoff Frequency (Hz)", 0, 999.9, 4, current.at(Cutoff), current.at(Cutoff), 0.1};
+    list << SweepParameter{"Active Threshold (g)", 0, 99.99, 4,
+                           qMax(0.0, current.at(Thresh) - 0.25), current.at(Thresh) + 0.25, 0.05};
+    list << SweepParameter{"Hold Time (s)", 0, 99.99, 4, current.at(HoldTime), current.at(HoldTime), 0.05};
+    list << SweepParameter{"Delay Time (s)", 0, 99.99, 4, current.at(DelayTime), current.at(DelayTime), 0.01};
+    list << SweepParameter{"Downsample", 1, 100, 0, current.at(DownSample), current.at(DownSample), 1};
+    return list;
+}
+
+bool AccelFilterSweep::prepareData(const QVector<QVector<double>> &values){
+    levels.clear();
+    TimeSeries *data = input.data;
+    samplerate = data->timeIndex()->sampleRate();
+
+    thresholds = values.at(Thresh);
+    std::sort(thresholds.begin(), thresholds.end());
+    thresholds.erase(std::unique(thresholds.begin(), thresholds.end()), thresholds.end());
+    if(thresholds.size() > ACCEL_SWEEP_MAX_THRESHOLDS){
+        errorString = QString("At most %1 thresholds can be swept at once.").arg(ACCEL_SWEEP_MAX_THRESHOLDS);
+        return false;
+    }
+    for(double cutoff: values.at(Cutoff)){
+        // As in AccelFilterDetector::config, the cutoff frequency must be at most the Nyquist frequency
+        if(cutoff > (samplerate * 0.5) || cutoff == 0){
+            errorString = QString("Invalid configuration for this activity detector: cutoff frequencies must be above 0 "
+                                  "and at most half the sample rate (%1 Hz).").arg(samplerate, 0, 'f', 2);
+            return false;
+        }
+    }
+    const Channel::Role roles[3] = {Channel::AccelX, Channel::AccelY, Channel::AccelZ};
+    for(int axis=0; axis<3; axis++){
+        // Columns are loaded here, so that the workers only read them
+        accel[axis] = data->handle(roles[axis]);
+        if(!accel[axis].isValid()){
+            errorString = QString("Activity Detector Error: The data has no \"%1\" channel").arg(Channel::roleName(roles[axis]));
+            return false;
+        }
+    }
+
+    // Every filter is run on its own thread
+    QList<QPair<FilterKey, QVector<quint8> *>> jobs;
+    for(double cutoff: values.at(Cutoff)){
+        for(double downSample: values.at(DownSample)){
+            const FilterKey key(cutoff, int(downSample));
+            if(key.second >= 1 && !levels.contains(key))
+                levels.insert(key, QVector<quint8>(stats.fedSamples(key.second)));
+        }
+    }
+    for(auto it = levels.begin(); it != levels.end(); ++it){
+        jobs.append(qMakePair(it.key(), &it.value()));
+    }
+    QtConcurrent::blockingMap(jobs, [this](const QPair<FilterKey, QVector<quint8> *> &job){
+        filter(job.first, job.second);
+    });
+    return true;
+}
+
+// Filters the fed samples, and finds the level of each (see the class description)
+void AccelFilterSweep::filter(FilterKey key, QVector<quint8> *out) const{
+    // The filter and reduction stages of AccelFilterDetector
+    Stage::HighPass<FILTER_ORDER> highPass;
+    QMap<QString, qreal> config;
+    config.insert("samplerate", samplerate);
+    config.insert("cutoff", key.first);
+    QString error;
+    highPass.config(config, error);
+    const int count = out->size();
+    QVector<double> values[3];
+    for(int first=0; first<count; first+=SWEEP_BLOCK_SAMPLES){
+        const int n = qMin(SWEEP_BLOCK_SAMPLES, count - first);
+        for(int axis=0; axis<3; axis++){
+            values[axis].resize(n);
+            readFed(accel[axis].data(), key.second, first, n, values[axis].data());
+        }
+        for(int i=0; i<n; i++){
+            const qreal maxFiltered = Stage::Max::reduce(highPass.filter(0, values[0].at(i)), highPass.filter(1, values[1].at(i)),
+                                                         highPass.filter(2, values[2].at(i)));
+            // Number of thresholds below maxFiltered, i.e. that it exceeds
+            (*out)[first + i] = quint8(std::lower_bound(thresholds.constBegin(), thresholds.constEnd(), maxFiltered) - thresholds.constBegin());
+        }
+    }
+}
+
+ActivityCounts AccelFilterSweep::run(const QVector<double> &config) const{
+    const int downSample = int(config.at(DownSample));
+    const QVector<quint8> &level = levels.find(FilterKey(config.at(Cutoff), downSample)).value();
+    const int count = level.size();
+    // The sample exceeds the threshold if its level is above the threshold's index
+    const int thresh = int(std::lower_bound(thresholds.constBegin(), thresholds.constEnd(), config.at(Thresh)) - thresholds.constBegin());
+
+    // The hysteresis stage of AccelFilterDetector
+    Stage::DelayHold delayHold;
+    QMap<QString, qreal> options;
+    options.insert("samplerate", samplerate);
+    options.insert("holdtime", config.at(HoldTime));
+    options.insert("delaytime", config.at(DelayTime));
+    QString error;
+    delayHold.config(options, error);
+
+    QVector<quint64> mask((count + 63)/64 + 1, 0);
+    for(int i=0; i<count; i++){
+        mask[i >> 6] |= quint64(delayHold.next(level.at(i) > thresh)) << (i & 63);
+    }
+    return stats.count(mask.constData(), downSample);
+}
+
+/**
+ * @brief AccelFilterSweep::simulate Runs an AccelFilterDetector over the fed samples, as the activity detector view does
+ */
+ActivityTimeline AccelFilterSweep::simulate(const QVector<double> &config) const{
+    const int downSample = int(config.at(DownSample));
+    const int fedSamples = stats.fedSamples(downSample);
+    ActivityTimeline timeline;
+    timeline.reset(simulatedSamples(), downSample, downSample);
+    TimelineBuilder builder(&timeline, downSample);
+
+    AccelFilterDetector detector;
+    QMap<QString, qreal> options;
+    options.insert("samplerate", samplerate);
+    options.insert("cutoff", config.at(Cutoff));
+    options.insert("thresh", config.at(Thresh));
+    options.insert("holdtime", config.at(HoldTime));
+    options.insert("delaytime", config.at(DelayTime));
+    detector.config(options);
+
+    ChannelBlock block;
+    QVector<double> values[3];
+    for(int axis=0; axis<3; axis++){
+        values[axis].resize(ACTIVITY_BLOCK_SAMPLES);
+        block.values.append(values[axis].constData());
+    }
+    for(int first=0; first<fedSamples; first+=ACTIVITY_BLOCK_SAMPLES){
+        block.first = first;
+        block.count = qMin(ACTIVITY_BLOCK_SAMPLES, fedSamples - first);
+        for(int axis=0; axis<3; axis++){
+            readFed(accel[axis].data(), downSample, first, block.count, values[axis].data());
+        }
+        detector.process(block, builder);
+    }
+    builder.finish();
+    return timeline;
+}
@@ -0,0 +1,47 @@
+#ifndef ACCELFILTERSWEEP_H
+#define ACCELFILTERSWEEP_H
+
+#include <QMap>
+#include <QPair>
+#include <QVector>
+#include "parametersweep.h"
+
+// Most thresholds one sweep can try
+#define ACCEL_SWEEP_MAX_THRESHOLDS 255
+
+/**
+ * @brief The AccelFilterSweep class runs the AccelFilterDetector over the same data with many configurations.
+ *
+ * The high-pass filter only depends on the cutoff frequency (and on which samples are fed to it), so the acceleration
+ * channels are filtered once per cutoff frequency and downsample factor, in parallel. What is kept of the filter
+ * output is its level: for each fed sample, how many of the swept thresholds the largest filtered axis exceeds. That
+ * takes one byte per sample, and is all the rest of the detector looks at. Each configuration then only runs the
+ * delay/hold counters over the levels of its filter.
+ */
+class AccelFilterSweep : public ParameterSweep
+{
+public:
+    // Order of the parameters in a configuration
+    enum Parameter { Cutoff, Thresh, HoldTime, DelayTime, DownSample };
+
+    explicit AccelFilterSweep(const SimulationInput &input);
+    QList<SweepParameter> parameters(const QVector<double> &current) const override;
+    ActivityCounts run(const QVector<double> &config) const override;
+    ActivityTimeline simulate(const QVector<double> &config) const override;
+
+protected:
+    bool prepareData(const QVector<QVector<double>> &values) override;
+
+private:
+    // Cutoff frequency and downsample factor of a filter
+    typedef QPair<double, int> FilterKey;
+
+    void filter(FilterKey key, QVector<quint8> *out) const;
+
+    QMap<FilterKey, QVector<quint8>> levels;
+    QVector<double> thresholds; // Sorted
+    double samplerate;
+    ColumnHandle accel[3];
+};
+
+#endif // ACCELFILTERSWEEP_H
@@ -1,8 +1,92 @@
 #include "actdetsimview.h"
 #include "ui_actdetsimview.h"
+#include "accelfiltersweep.h"
+#include "sweepdialog.h"
+#include <QScopedPointer>
 
 using namespace cv;
 
+namespace {
+/**
+ * Runs the activity detector on a worker thread, over the columns the view bound it to. Inputs the data lacks may come
+ * from streams recorded at other rates: their latest sample at the time of each fed sample is held.
+ */
+class ActDetSimJob : public SimulationJob
+{
+public:
+    AccelFilterDetector detector;   // You may change this to the simulator backend of your choice
+    QVector<ColumnHandle> inputs;   // Invalid for inputs held from another stream
+    QVector<StreamHandle> held;     // Valid for inputs held from another stream
+    QStringList names;
+    const TimeSeriesColumn *time;
+    const StreamSet *streams;
+    int length;                     // Samples simulated: all but the last
+    int downSample;
+
+protected:
+    bool simulateTimeline(ActivityTimeline &timeline, LoadProgress &progress, QString &error) override{
+        ActivityDetector *accelSim = &detector;
+        timeline.reset(length, downSample, downSample);
+        progress.setTotal(length);
+
+        // The detector is run over every sample it is fed, a block at a time, and only its state changes are kept
+        TimelineBuilder builder(&timeline, downSample);
+        const int fedSamples = (length > 0) ? (length - 1)/downSample + 1 : 0;
+        ChannelBlock block;
+        block.names = names;
+        QVector<QVector<qreal>> buffers(inputs.size());
+        block.values.resize(inputs.size());
+        for(int c=0; c<inputs.size(); ++c){
+            buffers[c].resize(ACTIVITY_BLOCK_SAMPLES);
+            block.values[c] = buffers[c].constData();
+        }
+        bool holds = false;
+        for(const StreamHandle &h: held){
+            holds = holds || h.isValid();
+        }
+        QVector<qreal> times(holds ? ACTIVITY_BLOCK_SAMPLES : 0);
+        QScopedPointer<StreamIterator> heldSamples(holds ? new StreamIterator(streams) : nullptr);
+        // A held value is only read again once its stream moves on to another sample
+        QVector<int> heldRow(inputs.size(), -2);
+        QVector<qreal> heldValue(inputs.size(), 0);
+        for(int first=0; first<fedSamples; first+=ACTIVITY_BLOCK_SAMPLES){
+            if(progress.isCanceled())
+                return false;
+            block.first = first;
+            block.count = qMin(ACTIVITY_BLOCK_SAMPLES, fedSamples - first);
+            for(int c=0; c<inputs.size(); ++c){
+                if(!held.at(c).isValid())
+                    inputs.at(c).data()->readStrided(first*downSample, block.count, downSample, buffers[c].data());
+            }
+            if(holds){
+                time->readStrided(first*downSample, block.count, downSample, times.data());
+                for(int i=0; i<block.count; ++i){
+                    heldSamples->advanceTo(times.at(i));
+                    for(int c=0; c<inputs.size(); ++c){
+                        const StreamHandle &h = held.at(c);
+                        if(!h.isValid())
+                            continue;
+                        const int row = heldSamples->rowOf(h.stream);
+                        if(row != heldRow.at(c)){
+                            heldRow[c] = row;
+                            heldValue[c] = heldSamples->value(h);
+                        }
+                        buffers[c][i] = heldValue.at(c);
+                    }
+                }
+            }
+            if(!accelSim->process(block, builder)){
+                error = "Activity Detector Error: " + accelSim->getErrorString();
+                return false;
+            }
+            progress.add(qint64(block.count)*downSample);
+        }
+        builder.finish();
+        return true;
+    }
+};
+}
+
 ActDetSimView::ActDetSimView(QWidget *parent) :
     SimulatorTab(parent),
     ui(new Ui::ActDetSimView)
@@ -14,7 +98,18 @@ ActDetSimView::ActDetSimView(QWidget *parent) :
     paths = new QList<MotionPath *>();
     deltaTVD = 0;
     rateMultiplier = 1.0;
+    streams = nullptr;
     hasInit = false;
+    draggedMarker = NoMarker;
+    simulatingTimeline = false;
+    simulatingCounts = false;
+
+    applyTimer.setSingleShot(true);
+    applyTimer.setInterval(SIMULATION_DEBOUNCE_MS);
+    connect(&applyTimer, SIGNAL(timeout()), this, SLOT(on_buttonApply_clicked()));
+    connect(&simulation, SIGNAL(progressChanged(int)), this, SLOT(showSimulationProgress(int)));
+    connect(&simulation, SIGNAL(finished(SimulationResult)), this, SLOT(simulationFinished(SimulationResult)));
+    ui->progressBar_simulation->hide();
 
     connect(ui->xScrollBar, SIGNAL(valueChanged(int)), this, SLOT(horzScrollBarChanged(int)));
     connect(ui->customPlot->xAxis, SIGNAL(rangeChanged(QCPRange)), this, SLOT(xAxisChanged(QCPRange)));
@@ -25,6 +120,11 @@ ActDetSimView::ActDetSimView(QWidget *parent) :
     connect(ui->spinbox_holdtime, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
     connect(ui->spinbox_delaytime, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
     connect(ui->spinbox_downsample, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    // Only the metrics depend on these, so updating is quick
+    connect(ui->spinbox_standbyenergy, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    connect(ui->spinbox_wakeupenergy, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    connect(ui->spinbox_energypersample, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
+    connect(ui->spinbox_bitspersample, SIGNAL(valueChanged(QString)), this, SLOT(ADXL_spinbox_valueChanged(QString)));
 
     ui->playButton->setIcon(style()->standardIcon(QStyle::SP_MediaPlay));
     ui->forwardButton->setIcon(style()->standardIcon(QStyle::SP_MediaSkipForward));
@@ -54,6 +154,9 @@ void ActDetSimView::init(){
     ui->customPlot->clearGraphs();
     ui->customPlot->clearItems();
     int numGraphs = QCPPlotTimeSeries::plotData(ui->customPlot, data);
+    // Streams of other rates are plotted on their own time bases
+    if(streams != nullptr)
+        numGraphs += QCPPlotTimeSeries::plotStreams(ui->customPlot, streams, numGraphs);
 
     ui->customPlot->addGraph();
     ui->customPlot->graph(numGraphs)->setPen(QPen(QColor(127, 127, 127)));
@@ -78,11 +181,22 @@ void ActDetSimView::init(){
 
     ui->customPlot->replot();
 
-    // Set sample rate label. Also catch zero-div.
-    ui->label_samplerateactual->setText((dataLength>0)?QString::number(data->numRows()/(dataLength), 'f', 2):"0");
-
-    pathCoverage = new QHash<MotionPath *, double>();
+    // Set sample rate label. The rate is that of the longest uniformly sampled stretch, so gaps do not skew it.
+    const TimeIndex *timeIndex = data->timeIndex();
+    QString rateText = QString::number(timeIndex->sampleRate(), 'f', 2);
+    if(timeIndex->gaps().size() > 0){
+        rateText += QString(" (%1 gaps)").arg(timeIndex->gaps().size());
+    }
+    ui->label_samplerateactual->setText(rateText);
+
+    // New data, so everything is simulated again
+    stopSimulation();
+    timelineStage.invalidate();
+    countsStage.invalidate();
+    metricsStage.invalidate();
+    renderStage.invalidate();
     hasInit = true;
+    showVideoActive();
 }
 
 ActDetSimView::~ActDetSimView()
@@ -188,20 +302,157 @@ int ActDetSimView::dataTimeToFrame(double dataTime){
     return int((dataTime - deltaTVD)/rateMultiplier*1000.0/ui->vidWidget->getFrameInterval());
 }
 
+/**
+ * @brief ActDetSimView::on_buttonApply_clicked Brings the simulation up to date. It runs in stages, each of which is
+ * only recomputed when its inputs changed: the timeline of the detector's state, the counts over the statistics
+ * window, the metrics derived from the counts, and the plot of the timeline. Editing the energy model, for instance,
+ * only recomputes the metrics. The timeline and the counts are computed on a worker thread, and the rest follows once
+ * they are published (see simulationFinished).
+ */
 void ActDetSimView::on_buttonApply_clicked()
 {
-    plotMotionTracks();
+    applyTimer.stop();
+    // The run in progress is superseded
+    stopSimulation();
+
+    const QVariant annotations = annotationInputs();
+
+    QVariantList timelineInputs;
+    timelineInputs << ui->spinbox_actthresh->value() << ui->spinbox_cutoff->value() << ui->spinbox_holdtime->value()
+                   << ui->spinbox_delaytime->value() << ui->spinbox_downsample->value();
+    const bool simulate = timelineStage.update(timelineInputs);
+
+    QVariantList countsInputs;
+    countsInputs << timelineStage.generation() << simStart << simEnd << deltaTVD << rateMultiplier
+                 << ui->vidWidget->getFrameInterval() << ui->groupBox_eventCoverage->isChecked() << annotations;
+    const bool count = countsStage.update(countsInputs);
+
+    if(simulate || count){
+        QSharedPointer<SimulationJob> job = simulationJob(simulate);
+        if(job.isNull()){
+            timelineStage.invalidate();
+            countsStage.invalidate();
+            return;
+        }
+        if(count){
+            job->count = true;
+            job->eventCoverage = ui->groupBox_eventCoverage->isChecked();
+            SimulationInput input = simulationInput();
+            if(!job->eventCoverage)
+                input.events.clear();
+            // Without enough data to simulate, everything counts zero
+            job->stats.prepare(input);
+        }
+        simulatingTimeline = simulate;
+        simulatingCounts = count;
+        simulation.start(job);
+        return;
+    }
+    showOutputs();
+}
+
+/**
+ * @brief ActDetSimView::simulationFinished Publishes the results of a run, and brings the metrics and the plot up to
+ * date
+ */
+void ActDetSimView::simulationFinished(SimulationResult result){
+    ui->progressBar_simulation->hide();
+    simulatingTimeline = false;
+    simulatingCounts = false;
+    // Nothing computed from data that could not be read is published
+    if(result.error.isEmpty())
+        result.error = data->getErrorString();
+    if(!result.error.isEmpty()){
+        timelineStage.invalidate();
+        countsStage.invalidate();
+        QMessageBox::warning(this, "", result.error);
+        return;
+    }
+    if(result.hasTimeline){
+        timeline = result.timeline;
+    }
+    if(result.hasCounts){
+        stats = result.stats;
+        counts = result.counts;
+        coverage = result.coverage;
+    }
+    showOutputs();
+}
+
+/**
+ * @brief ActDetSimView::stopSimulation Cancels the run in progress, if any, without waiting for it. Whatever it was
+ * computing is computed again on the next update.
+ * @return true if a run was canceled
+ */
+bool ActDetSimView::stopSimulation(){
+    ui->progressBar_simulation->hide();
+    if(!simulation.cancel())
+        return false;
+    if(simulatingTimeline)
+        timelineStage.invalidate();
+    if(simulatingCounts)
+        countsStage.invalidate();
+    simulatingTimeline = false;
+    simulatingCounts = false;
+    return true;
+}
+
+void ActDetSimView::showSimulationProgress(int percent){
+    ui->progressBar_simulation->setValue(percent);
+    ui->progressBar_simulation->show();
+}
+
+/**
+ * @brief ActDetSimView::showOutputs Brings the metrics and the plot up to date with the published timeline and counts
+ */
+void ActDetSimView::showOutputs(){
+    QVariantList metricsInputs;
+    metricsInputs << countsStage.generation() << ui->spinbox_standbyenergy->value() << ui->spinbox_wakeupenergy->value()
+                  << ui->spinbox_energypersample->value() << ui->spinbox_bitspersample->value();
+    if(metricsStage.update(metricsInputs))
+        showMetrics();
+
+    QVariantList renderInputs;
+    renderInputs << timelineStage.generation() << deltaTVD << rateMultiplier << annotationInputs();
+    if(renderStage.update(renderInputs))
+        plotTimeline();
+}
+
+// Start and end frame of every annotated event, to tell when they change
+QVariant ActDetSimView::annotationInputs() const{
+    QVariantList frames;
+    for(MotionPath *p: *paths){
+        frames << p->start << p->end;
+    }
+    return frames;
+}
+
+/**
+ * @brief ActDetSimView::simulationJob Configures the detector and binds it to the data, for a run on a worker thread
+ * @param simulate Whether the run is to simulate a new timeline, or to score the current one
+ * @return null if the detector cannot be run on the data
+ */
+QSharedPointer<SimulationJob> ActDetSimView::simulationJob(bool simulate){
+    QSharedPointer<ActDetSimJob> job(new ActDetSimJob());
+    job->simulate = simulate;
+    if(!simulate){
+        job->timeline = timeline;
+        return job;
+    }
 
     // Get configuration values from UI elements
     double thresh = ui->spinbox_actthresh->value();
     double cutoff = ui->spinbox_cutoff->value(); // Cutoff frequency of high-pass filter
     double holdTime = ui->spinbox_holdtime->value();
     double delayTime = ui->spinbox_delaytime->value();
-    // Quick check to make sure it's not zero
-    double samplerate = (dataLength > 0)?(data->numRows() / dataLength):0;
+    double samplerate = data->timeIndex()->sampleRate();
+    int totalSamples = data->numRows();
+    job->downSample = ui->spinbox_downsample->value();
+    // The last sample is never fed
+    job->length = qMax(0, totalSamples - 1);
 
-    // You may change this to the simulator backend of your choice.
-    accelSim = new AccelFilterDetector();
+    // The backend is chosen in ActDetSimJob
+    ActivityDetector *accelSim = &job->detector;
 
     // These are configuration options to pass to the simulator backend.
     QMap<QString, double> config;
@@ -214,177 +465,111 @@ void ActDetSimView::on_buttonApply_clicked()
     // Everything else below this point is essentially the same for all simulator backends.
     if(!accelSim->config(config)){
         QMessageBox::warning(this, "", "Invalid configuration for this activity detector.");
-        return;
+        return QSharedPointer<SimulationJob>();
     }
 
-    bool state_prev = false;
-    int lastActive = 0;
-    int totalActiveRegions = 0;
-    int totalActiveSamples = 0;
-    int samplesPerChunk = 1;
-
-    int currentIndex = 0;
-    int totalSamples = data->numRows();
-    int totalSamplesStat = 0; // Total number of samples within statistics window
-
-    int downSample = ui->spinbox_downsample->value();
-    int samplesPerChunkDownSampled = 0;
-
-    int correctSamples = 0;
-    int falsePositives = 0;
-    int falseNegatives = 0;
-
-    int correctEvents = 0;
-    int falsePositiveEvents = 0;
-    bool annotationThisWakeup = false;
-
-    int frameStatStart = dataTimeToFrame(simStart);
-    int frameStatEnd = dataTimeToFrame(simEnd);
-
-    bool activebit = false;
-
-    pathCoverage->clear();
-    if(ui->groupBox_eventCoverage->isChecked()){
-        for(MotionPath *p: *paths){
-            if(p->end > frameStatStart && p->start <= frameStatEnd)
-                pathCoverage->insert(p, 0);
+    // Detectors that read channels are bound to them once. Others are passed the columns they read, by name. Columns
+    // are read in here, so that the worker only reads them. Those the data lacks are held from other streams.
+    job->time = data->timeColumnData();
+    job->streams = streams;
+    const QList<Channel::Role> requiredChannels = accelSim->requiredChannels();
+    for(Channel::Role role: requiredChannels){
+        const ColumnHandle column = data->handle(role);
+        const StreamHandle heldColumn = (column.isValid() || streams == nullptr) ? StreamHandle() : streams->handle(role);
+        if(!column.isValid() && !heldColumn.isValid()){
+            QMessageBox::warning(this, "", QString("Activity Detector Error: The data has no \"%1\" channel").arg(Channel::roleName(role)));
+            return QSharedPointer<SimulationJob>();
         }
+        job->inputs.append(column);
+        job->held.append(heldColumn);
+        job->names.append(column.isValid() ? data->columnName(column.column())
+                                           : streams->stream(heldColumn.stream)->columnName(heldColumn.column.column()));
     }
-
-    while(currentIndex + samplesPerChunk < totalSamples){
-        for(int chunkSamples = 0; chunkSamples < samplesPerChunk; ++chunkSamples){
-            int sampleIndex = currentIndex + chunkSamples;
-            if ((sampleIndex % downSample) == 0)
-            {
-                samplesPerChunkDownSampled ++;
-                QMap<QString, double> sample;
-                for(int col=0; col<data->numColumns(); ++col){
-                    sample.insert(data->columnName(col), data->getColumn(col)->at(sampleIndex));
-                }
-                if (!accelSim->next(sample)){
-                    QMessageBox::warning(this, "", "Activity Detector Error: " + accelSim->getErrorString());
-                    return;
-                }
-
-                if (data->timeColumnData()->at(sampleIndex) >= simStart && data->timeColumnData()->at(sampleIndex) <= simEnd){
-                    totalSamplesStat ++;
-                }
-            }
-        }
-
-        activebit = accelSim->isActive();
-        bool activeAnnotation = false; // Active bit from annotation
-        qreal currentTime = data->timeColumnData()->at(currentIndex);
-        int currentVideoFrame = dataTimeToFrame(currentTime);
-
-        if (currentTime >= simStart && currentTime <= simEnd){
-            // Find out if there's an annotation at the present location
-            if(ui->groupBox_eventCoverage->isChecked()){
-                for(MotionPath *p: pathCoverage->keys()){
-
-                    if(p->start <= currentVideoFrame && p->end > currentVideoFrame){
-                        activeAnnotation = true;
-                        if(activebit){
-                            pathCoverage->insert(p, pathCoverage->value(p)+((1.0/samplerate)/(ui->vidWidget->getFrameInterval()/1000.0))); // Increment this path's count by the number of frames covered by one sample
-
-                        }
-                    }
-                }
-            }
-            if(activebit){
-                totalActiveSamples += samplesPerChunkDownSampled;
-            }
-            if(ui->groupBox_eventCoverage->isChecked()){
-                if(activebit){
-                    if(activeAnnotation){
-                        correctSamples ++;
-                        annotationThisWakeup = true;
-                    }
-                    else{
-                        falsePositives ++;
-                    }
-                }
-                else{
-                    if(activeAnnotation){
-                        falseNegatives ++;
-                    }
-                    else{
-                        correctSamples ++;
-                    }
-
-                }
-            }
+    QStringList requiredColumns = accelSim->requiredColumns();
+    for(int col=0; col<data->numColumns() && requiredChannels.isEmpty(); ++col){
+        if(requiredColumns.isEmpty() || requiredColumns.contains(data->columnName(col))){
+            job->inputs.append(ColumnHandle(col, data->getColumn(col)));
+            job->held.append(StreamHandle());
+            job->names.append(data->columnName(col));
         }
-        samplesPerChunkDownSampled = 0;
-        // Detect transitions from active -> inactive and vice versa
-
-        if(state_prev != activebit){
-            state_prev = activebit;
-
-            // Transition from active to inactive
-            if(!activebit){
-                if (currentTime >= simStart && currentTime <= simEnd && ui->groupBox_eventCoverage->isChecked()){
-                    if(!annotationThisWakeup){
-                        falsePositiveEvents ++;
-                    }else{
-                        correctEvents ++;
-                    }
-                }
-                lastActive = currentIndex;
-            }
-
-            // Transition from inactive to active
-            else if(activebit){
-                annotationThisWakeup = false;
-                if (currentTime >= simStart && currentTime <= simEnd){
-                    ++totalActiveRegions;
-                }
-
-                QCPItemRect *rect = new QCPItemRect(ui->customPlot);
-                //Set rectangles to go off screen
-                rect->topLeft->setCoords(data->timeColumnData()->at(lastActive), ui->customPlot->yAxis->range().upper+1);
-                rect->bottomRight->setCoords(currentTime, ui->customPlot->yAxis->range().lower-1);
-                rect->setBrush(QBrush(QColor(127, 127, 127, 200)));
-            }
+    }
+    for(int i=0; i<requiredColumns.size() && requiredChannels.isEmpty() && streams != nullptr; ++i){
+        const StreamHandle heldColumn = data->handle(requiredColumns.at(i)).isValid() ? StreamHandle() : streams->handle(requiredColumns.at(i));
+        if(heldColumn.isValid()){
+            job->inputs.append(ColumnHandle());
+            job->held.append(heldColumn);
+            job->names.append(requiredColumns.at(i));
         }
-        currentIndex += samplesPerChunk;
     }
+    return job;
+}
+
+/**
+ * @brief ActDetSimView::simulationInput The data and annotations the simulation is scored against
+ */
+SimulationInput ActDetSimView::simulationInput(){
+    SimulationInput input;
+    input.data = data;
+    input.statStart = simStart;
+    input.statEnd = simEnd;
+    for(MotionPath *p: *paths){
+        input.events.append(qMakePair(p->start, p->end));
+    }
+    input.deltaTVD = deltaTVD;
+    input.rateMultiplier = rateMultiplier;
+    input.frameInterval = ui->vidWidget->getFrameInterval();
+    return input;
+}
 
-    // Do some additional calculations, and display the results
+/**
+ * @brief ActDetSimView::showMetrics Shows the counts, and the energy and storage they take
+ */
+void ActDetSimView::showMetrics(){
+    double samplerate = data->timeIndex()->sampleRate();
 
-    double totalEnergy = (ui->spinbox_standbyenergy->value()*(totalSamplesStat-totalActiveSamples) +
-                          ui->spinbox_wakeupenergy->value()*totalActiveRegions +
-                          ui->spinbox_energypersample->value()*totalActiveSamples)/1000.0;
+    double totalEnergy = (ui->spinbox_standbyenergy->value()*(counts.samples-counts.activeSamples) +
+                          ui->spinbox_wakeupenergy->value()*counts.wakeups +
+                          ui->spinbox_energypersample->value()*counts.activeSamples)/1000.0;
 
-    double storagekB = ui->spinbox_bitspersample->value()*totalActiveSamples/1000.0;
+    double storagekB = ui->spinbox_bitspersample->value()*counts.activeSamples/1000.0;
 
     ui->label_powerconsumed->setText(QString::number(totalEnergy, 'f', 2));
     ui->label_totalstorage->setText(QString::number(storagekB, 'f', 2));
 
-    ui->label_samples->setText(QString::number(totalSamplesStat));
-    ui->label_activesamples->setText(QString::number(totalActiveSamples));
-    ui->label_sampleratesim->setText(QString::number(samplerate/downSample, 'f', 2));
-    ui->label_wakeups->setText(QString::number(totalActiveRegions));
-    double percentActive = (currentIndex > 0)?double(totalActiveSamples)/totalSamplesStat*100:0;
+    ui->label_samples->setText(QString::number(counts.samples));
+    ui->label_activesamples->setText(QString::number(counts.activeSamples));
+    ui->label_sampleratesim->setText(QString::number(samplerate/timeline.activeStride(), 'f', 2));
+    ui->label_wakeups->setText(QString::number(counts.wakeups));
+    double percentActive = (counts.samples > 0)?double(counts.activeSamples)/counts.samples*100:0;
     ui->label_activepercent->setText(QString::number(percentActive, 'f', 1)); //Display percentage rounded to 1 decimal
 
-    ui->customPlot->replot();
-
     if(ui->groupBox_eventCoverage->isChecked()){
-        int coveredEvents = 0;
-        for(MotionPath *p: pathCoverage->keys()){
-            if(pathCoverage->value(p) >= 0.5*(p->end-p->start)){
-                coveredEvents++;
-            }
-        }
-        ui->label_correctsamples->setText(QString::number(correctSamples));
-        ui->label_falsepsamples->setText(QString::number(falsePositives));
-        ui->label_falsensamples->setText(QString::number(falseNegatives));
-        ui->label_correctevents->setText(QString::number(coveredEvents));
-        ui->label_falsepevents->setText(QString::number(falsePositiveEvents));
-        ui->label_falsenevents->setText(QString::number(pathCoverage->size()-coveredEvents));
-        ui->label_annotationCount->setText(QString::number(pathCoverage->size()));
+        ui->label_correctsamples->setText(QString::number(counts.correctSamples));
+        ui->label_falsepsamples->setText(QString::number(counts.falsePositiveSamples));
+        ui->label_falsensamples->setText(QString::number(counts.falseNegativeSamples));
+        ui->label_correctevents->setText(QString::number(counts.coveredEvents));
+        ui->label_falsepevents->setText(QString::number(counts.falsePositiveEvents));
+        ui->label_falsenevents->setText(QString::number(stats.numEvents()-counts.coveredEvents));
+        ui->label_annotationCount->setText(QString::number(stats.numEvents()));
+    }
+}
+
+/**
+ * @brief ActDetSimView::plotTimeline Plots the annotations, and shades the stretches where the detector is inactive
+ */
+void ActDetSimView::plotTimeline(){
+    plotMotionTracks();
+
+    const TimeSeriesColumn *time = data->timeColumnData();
+    for(int i=0; i<timeline.size(); ++i){
+        const int lastActive = (i > 0) ? timeline.at(i - 1).end : 0;
+        QCPItemRect *rect = new QCPItemRect(ui->customPlot);
+        //Set rectangles to go off screen
+        rect->topLeft->setCoords(time->at(lastActive), ui->customPlot->yAxis->range().upper+1);
+        rect->bottomRight->setCoords(time->at(timeline.at(i).start), ui->customPlot->yAxis->range().lower-1);
+        rect->setBrush(QBrush(QColor(127, 127, 127, 200)));
     }
+    ui->customPlot->replot();
 }
 
 
@@ -503,9 +688,19 @@ void ActDetSimView::attachCap(VideoCapture *cap){
 }
 
 void ActDetSimView::attachTimeSeries(TimeSeries *ts){
+    // Runs may still be reading the old data, which is deleted next
+    stopSimulation();
+    simulation.wait();
     this->data = ts;
 }
 
+void ActDetSimView::attachStreams(StreamSet *streams){
+    // Runs may still be reading the old streams, which are deleted next
+    stopSimulation();
+    simulation.wait();
+    this->streams = streams;
+}
+
 void ActDetSimView::syncCap(){
     ui->vidWidget->syncCap();
 }
@@ -524,6 +719,9 @@ void ActDetSimView::on_clipList_itemClicked(QListWidgetItem *item){
 }
 
 void ActDetSimView::updatePathList(QList<MotionPath *> *paths){
+    occupancy.update(*paths);
+    showVideoActive();
+
     namesToPath->clear();
     ui->clipList->clear();
     for(MotionPath *p : *paths){
@@ -537,8 +735,11 @@ void ActDetSimView::updatePathList(QList<MotionPath *> *paths){
         ui->clipList->addItem(name);
     }
 
-    if (hasInit)
+    if (hasInit){
         plotMotionTracks();
+        // That cleared the plot of the timeline
+        renderStage.invalidate();
+    }
 }
 
 void ActDetSimView::updateSync(double startTime, double rate){
@@ -552,17 +753,51 @@ void ActDetSimView::updateSync(double startTime, double rate){
 }
 
 void ActDetSimView::on_customPlot_mousePress(QMouseEvent *e){
+    // A press on a statistics marker grabs it, rather than seeking
+    if(hasInit && e->button() == Qt::LeftButton){
+        if(qAbs(e->x() - ui->customPlot->xAxis->coordToPixel(simStart)) <= STAT_MARKER_GRAB_PIXELS){
+            draggedMarker = StartMarker;
+            return;
+        }
+        if(qAbs(e->x() - ui->customPlot->xAxis->coordToPixel(simEnd)) <= STAT_MARKER_GRAB_PIXELS){
+            draggedMarker = EndMarker;
+            return;
+        }
+    }
     double x,y;
     ui->customPlot->graph(0)->pixelsToCoords(e->x(), e->y(), x, y);
     ui->vidWidget->seek_ms(((x-deltaTVD)/rateMultiplier)*1000);
 }
 
 void ActDetSimView::on_customPlot_mouseMove(QMouseEvent *e){
+    // The window's labels follow the marker; the simulation is only updated once it is dropped
+    if(draggedMarker != NoMarker){
+        double x = ui->customPlot->xAxis->pixelToCoord(e->x());
+        if(draggedMarker == StartMarker){
+            updateStat(x, simEnd);
+        }
+        else{
+            updateStat(simStart, x);
+        }
+        return;
+    }
     if(e->buttons() & Qt::LeftButton){
         on_customPlot_mousePress(e);
     }
 }
 
+void ActDetSimView::on_customPlot_mouseRelease(QMouseEvent *e){
+    Q_UNUSED(e)
+    if(draggedMarker == NoMarker){
+        return;
+    }
+    draggedMarker = NoMarker;
+    if (ui->checkBox_autoUpdate->isChecked()){
+        on_buttonApply_clicked();
+    }
+    emit statChanged(simStart, simEnd);
+}
+
 void ActDetSimView::on_magnify_toggled(bool checked)
 {
     ui->vidWidget->setMagnify(checked);
@@ -615,20 +850,22 @@ void ActDetSimView::on_customPlot_doubleClick(QMouseEvent *e){
     default:
         break;
     }
+    showVideoActive();
 }
 
 
 void ActDetSimView::ADXL_spinbox_valueChanged(QString arg1)
 {
     Q_UNUSED(arg1)
+    // Holding down a spinbox's arrow only updates once it is let go
     if (ui->checkBox_autoUpdate->isChecked()){
-        on_buttonApply_clicked();
+        applyTimer.start();
     }
 }
 
 void ActDetSimView::on_button_exportcoverage_clicked()
 {
-    if (pathCoverage->empty()){
+    if (coverage.isEmpty()){
         QMessageBox::warning(this, "", "No coverage data to export. Click \"Apply\" to generate data or adjust simulation bounds to include annotations.");
         return;
     }
@@ -637,26 +874,52 @@ void ActDetSimView::on_button_exportcoverage_clicked()
 
     if(!saveFileName.isEmpty()){
         QFile coverageFile(saveFileName);
-        coverageFile.open(QFile::WriteOnly);\
-        // Write header
-        coverageFile.write("Start,Length,Coverage Percent\n");
-        for(MotionPath *p: (pathCoverage->keys())){
-            double pathStartTime = frameToDataTime(p->start);
-            double pathEndTime = frameToDataTime(p->end);
-            double pathLength = pathEndTime-pathStartTime;
-            // Cap value to 100 if it exceeds it.
-            double coveragePercent = qMin(100.0, pathLength>0?(100*pathCoverage->value(p)/(p->end-p->start)):0);
-
-            coverageFile.write(QString("%1,%2,%3\n")
-                               .arg(pathStartTime)
-                               .arg(pathLength)
-                               .arg(coveragePercent).toLatin1());
-        }
+        coverageFile.open(QFile::WriteOnly);
+        stats.writeCoverage(&coverageFile, coverage);
         coverageFile.close();
     }
 
 }
 
+void ActDetSimView::on_button_sweep_clicked()
+{
+    if(!hasInit){
+        return;
+    }
+    // The sweep takes every core, so the run in progress is canceled, and redone afterwards if the sweep is not used
+    const bool interrupted = stopSimulation();
+    SimulationInput input = simulationInput();
+
+    EnergyModel energy;
+    energy.standby = ui->spinbox_standbyenergy->value();
+    energy.wakeup = ui->spinbox_wakeupenergy->value();
+    energy.perSample = ui->spinbox_energypersample->value();
+
+    QVector<double> current(5);
+    current[AccelFilterSweep::Cutoff] = ui->spinbox_cutoff->value();
+    current[AccelFilterSweep::Thresh] = ui->spinbox_actthresh->value();
+    current[AccelFilterSweep::HoldTime] = ui->spinbox_holdtime->value();
+    current[AccelFilterSweep::DelayTime] = ui->spinbox_delaytime->value();
+    current[AccelFilterSweep::DownSample] = ui->spinbox_downsample->value();
+
+    AccelFilterSweep sweep(input);
+    SweepDialog dialog(&sweep, energy, current, this);
+    dialog.setWindowTitle("Activity Detector Parameter Sweep");
+    if(dialog.exec() == QDialog::Accepted){
+        const QVector<double> config = dialog.selectedConfig();
+        ui->spinbox_cutoff->setValue(config.at(AccelFilterSweep::Cutoff));
+        ui->spinbox_actthresh->setValue(config.at(AccelFilterSweep::Thresh));
+        ui->spinbox_holdtime->setValue(config.at(AccelFilterSweep::HoldTime));
+        ui->spinbox_delaytime->setValue(config.at(AccelFilterSweep::DelayTime));
+        ui->spinbox_downsample->setValue(int(config.at(AccelFilterSweep::DownSample)));
+        ui->groupBox_eventCoverage->setChecked(true);
+        on_buttonApply_clicked();
+    }
+    else if(interrupted){
+        on_buttonApply_clicked();
+    }
+}
+
 void ActDetSimView::updateStat(double start, double end){
     simStart = start;
     simEnd = end;
@@ -669,5 +932,21 @@ void ActDetSimView::updateStat(double start, double end){
     plotStatEnd->point1->setCoords(simEnd, 0);
     plotStatEnd->point2->setCoords(simEnd, 1);
 
+    showVideoActive();
     ui->customPlot->replot();
 }
+
+/**
+ * @brief ActDetSimView::showVideoActive Shows the percentage of the video frames in the statistics window that are
+ * annotated
+ */
+void ActDetSimView::showVideoActive(){
+    int frameStart = 0;
+    int frameEnd = 0;
+
+    if(ui->vidWidget->getFrameInterval() > 0){
+        frameStart = dataTimeToFrame(simStart);
+        frameEnd = dataTimeToFrame(simEnd);
+    }
+    ui->label_videoActive->setText(QString::number(occupancy.annotatedPercent(frameStart, frameEnd), 'f', 2));
+}
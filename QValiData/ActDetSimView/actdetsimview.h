@@ -12,6 +12,11 @@
 #include "accelfilterdetector.h"
 #include "qcpplottimeseries.h"
 #include "simulatortab.h"
+#include "simulationstage.h"
+#include "activitytimeline.h"
+#include "activitystats.h"
+#include "frameoccupancy.h"
+#include "simulationrunner.h"
 #include "Iir.h"
 
 namespace Ui {
@@ -27,6 +32,7 @@ public:
     ~ActDetSimView() override;
     void attachCap(cv::VideoCapture *cap) override;
     void attachTimeSeries(TimeSeries *ts) override;
+    void attachStreams(StreamSet *streams) override;
     void attachPath(QList<MotionPath *> *paths) override;
     void init() override;
 
@@ -66,6 +72,8 @@ private slots:
 
     void on_customPlot_mouseMove(QMouseEvent *e);
 
+    void on_customPlot_mouseRelease(QMouseEvent *e);
+
     void on_customPlot_doubleClick(QMouseEvent *e);
 
     void on_magnify_toggled(bool checked);
@@ -76,6 +84,12 @@ private slots:
 
     void on_button_exportcoverage_clicked();
 
+    void on_button_sweep_clicked();
+
+    void simulationFinished(SimulationResult result);
+
+    void showSimulationProgress(int percent);
+
 public slots:
     void syncCap() override;
     void syncPath() override;
@@ -86,7 +100,8 @@ public slots:
 private:
     Ui::ActDetSimView *ui;
     TimeSeries *data;
-    AccelFilterDetector *accelSim;
+    // Data recorded at other rates, or null. Detector inputs the data lacks are held from these.
+    StreamSet *streams;
 
     qreal dataLength;
 
@@ -104,7 +119,8 @@ private:
     QCPItemText *plotStatStartText;
     QCPItemText *plotStatEndText;
 
-    QHash<MotionPath*, double> *pathCoverage;
+    // Frames of each annotated event in the statistics window covered by active samples, in the order of stats' events
+    QVector<double> coverage;
 
     qreal deltaTVD;
     qreal rateMultiplier;
@@ -114,8 +130,46 @@ private:
     double simStart;
     double simEnd;
 
+    // Annotated video frames, for the share of the statistics window that is annotated
+    FrameOccupancy occupancy;
+
+    // Statistics marker being dragged with the mouse, if any
+    enum StatMarker{
+        NoMarker,
+        StartMarker,
+        EndMarker
+    };
+    StatMarker draggedMarker;
+
+    // Stages of the simulation, each only recomputed when its inputs change (see on_buttonApply_clicked)
+    SimulationStage timelineStage;
+    SimulationStage countsStage;
+    SimulationStage metricsStage;
+    SimulationStage renderStage;
+
+    // Runs the timeline and counts stages on a worker thread. applyTimer holds off auto-updates while settings change.
+    SimulationRunner simulation;
+    QTimer applyTimer;
+    bool simulatingTimeline;
+    bool simulatingCounts;
+
+    // Where the detector is active
+    ActivityTimeline timeline;
+
+    // Scores the timeline against the annotations over the statistics window
+    ActivityStats stats;
+    ActivityCounts counts;
+
     int dataTimeToFrame(double dataTime);
     double frameToDataTime(int frame);
+    QVariant annotationInputs() const;
+    SimulationInput simulationInput();
+    QSharedPointer<SimulationJob> simulationJob(bool simulate);
+    bool stopSimulation();
+    void showMetrics();
+    void plotTimeline();
+    void showOutputs();
+    void showVideoActive();
 
 signals:
     void statChanged(double start, double end);
@@ -7,8 +7,10 @@ FileSelector::FileSelector(QFrame *parent) : QFrame(parent),
     ui->setupUi(this);
 
     videoFile = new QString();
-    dataFile = new QString();
+    dataFiles = new QStringList();
+    layoutFile = new QString();
     defaultDir = new QString();
+    setLoading(false);
 }
 
 FileSelector::~FileSelector()
@@ -31,18 +33,70 @@ void FileSelector::on_button_videoBrowse_clicked()
 
 void FileSelector::on_button_dataBrowse_clicked()
 {
-    QString fname = QFileDialog::getOpenFileName(this, "Open Data File", *defaultDir);
-    if(!fname.isEmpty()){
-        delete dataFile;
-        dataFile = new QString(fname);
-        ui->label_dataFile->setText(*dataFile);
-        emit dataFileChanged(*dataFile);
+    // Selecting several files (e.g. one per logger rollover) merges them into one data set
+    QStringList fnames = QFileDialog::getOpenFileNames(this, "Open Data Files", *defaultDir);
+    if(!fnames.isEmpty()){
+        fnames.sort();
+        restoreDataFiles(fnames);
+        // A new file has its own columns, so start by reading all of them
+        selectedColumns.clear();
+        emit dataFilesChanged(*dataFiles);
     }
     else{
     }   
 }
 
-QString FileSelector::getDataFile(){return *dataFile;}
+void FileSelector::on_button_layoutBrowse_clicked()
+{
+    QString fname = QFileDialog::getOpenFileName(this, "Open Record Layout", *defaultDir, "Record Layout (*.ini *.conf);;All Files (*)");
+    if(!fname.isEmpty()){
+        restoreLayoutFile(fname);
+        // Read the data file again with the new layout
+        if(!dataFiles->isEmpty()){
+            emit dataFilesChanged(*dataFiles);
+        }
+    }
+}
+
+void FileSelector::on_combo_dataFormat_currentIndexChanged(int index)
+{
+    ui->label_layoutFile->setEnabled(index == DATA_FORMAT_BINARY);
+    ui->button_layoutBrowse->setEnabled(index == DATA_FORMAT_BINARY);
+    ui->group_columns->setEnabled(index == DATA_FORMAT_CSV);
+    if(!dataFiles->isEmpty() && (index == DATA_FORMAT_CSV || !layoutFile->isEmpty())){
+        emit dataFilesChanged(*dataFiles);
+    }
+}
+
+QStringList FileSelector::getDataFiles(){return *dataFiles;}
+/**
+ * @brief FileSelector::getLayoutFile Returns the record layout to read binary data files with, or an empty string
+ * if data files are CSV.
+ */
+QString FileSelector::getLayoutFile(){
+    return (ui->combo_dataFormat->currentIndex() == DATA_FORMAT_BINARY) ? *layoutFile : QString();
+}
+/**
+ * @brief FileSelector::getSelectedColumns Returns the names of the columns of CSV data files to read up front, or an
+ * empty list to read all of them. The time column is always read.
+ */
+QStringList FileSelector::getSelectedColumns(){
+    return selectedColumns;
+}
+/**
+ * @brief FileSelector::getTimeRange Returns the time range to read from HDF5 data files. Without a range, start and
+ * end are infinite.
+ */
+void FileSelector::getTimeRange(double &start, double &end){
+    if(ui->check_timeRange->isChecked()){
+        start = ui->spin_rangeStart->value();
+        end = ui->spin_rangeEnd->value();
+    }
+    else{
+        start = -std::numeric_limits<double>::infinity();
+        end = std::numeric_limits<double>::infinity();
+    }
+}
 QString FileSelector::getVideoFile(){return *videoFile;}
 QString FileSelector::getDefaultDir(){return *defaultDir;}
 
@@ -55,8 +109,63 @@ QTableWidget *FileSelector::previewTable(){
     return (ui->tableWidget);
 }
 
+// A negative totalSize means the size is not known yet because the file is still loading
 void FileSelector::setDataPreviewSize(int previewSize, int totalSize){
-    ui->group_dataPreview->setTitle(QString("Data Preview (First %1 rows of %2)").arg(previewSize).arg(totalSize));
+    if(totalSize < 0)
+        ui->group_dataPreview->setTitle(QString("Data Preview (First %1 rows, loading...)").arg(previewSize));
+    else
+        ui->group_dataPreview->setTitle(QString("Data Preview (First %1 rows of %2)").arg(previewSize).arg(totalSize));
+}
+
+// Shows or hides the progress bar and cancel button of a data file being loaded
+void FileSelector::setLoading(bool loading){
+    ui->progress_dataLoad->setValue(0);
+    ui->progress_dataLoad->setVisible(loading);
+    ui->button_cancelLoad->setVisible(loading);
+}
+
+void FileSelector::setLoadProgress(int percent){
+    ui->progress_dataLoad->setValue(percent);
+}
+
+void FileSelector::on_button_cancelLoad_clicked()
+{
+    emit loadCanceled();
+}
+
+void FileSelector::on_button_loadColumns_clicked()
+{
+    QStringList checked;
+    for(int i=0; i<ui->list_columns->count(); i++){
+        if(ui->list_columns->item(i)->checkState() == Qt::Checked)
+            checked.append(ui->list_columns->item(i)->text());
+    }
+    // Checking everything is the same as not selecting at all, and keeps columns added to the file later on
+    restoreSelectedColumns((checked.size() == ui->list_columns->count()) ? QStringList() : checked);
+    if(!dataFiles->isEmpty()){
+        emit dataFilesChanged(*dataFiles);
+    }
+}
+
+// The range is applied by "Reload Selected", along with the columns
+void FileSelector::on_check_timeRange_toggled(bool checked)
+{
+    ui->spin_rangeStart->setEnabled(checked);
+    ui->spin_rangeEnd->setEnabled(checked);
+}
+
+/**
+ * @brief FileSelector::setColumns Lists the columns of the data file, checking those that will be read up front
+ */
+void FileSelector::setColumns(QStringList columnNames){
+    ui->list_columns->clear();
+    for(int i=0; i<columnNames.size(); i++){
+        QListWidgetItem *item = new QListWidgetItem(columnNames.at(i), ui->list_columns);
+        const bool checked = selectedColumns.isEmpty() || selectedColumns.contains(columnNames.at(i));
+        // The first column holds the time, which is always needed
+        item->setFlags((i == 0) ? Qt::ItemIsUserCheckable : (Qt::ItemIsUserCheckable | Qt::ItemIsEnabled));
+        item->setCheckState((checked || i == 0) ? Qt::Checked : Qt::Unchecked);
+    }
 }
 
 void FileSelector::restoreVideoFile(QString videoFile){
@@ -71,16 +180,43 @@ void FileSelector::restoreVideoFile(QString videoFile){
     }
 }
 
-void FileSelector::restoreDataFile(QString dataFile){
-    delete this->dataFile;
-    if(dataFile.isEmpty()){
-        this->dataFile = new QString();
+void FileSelector::restoreDataFiles(QStringList dataFiles){
+    delete this->dataFiles;
+    this->dataFiles = new QStringList(dataFiles);
+    if(dataFiles.isEmpty()){
         ui->label_dataFile->setText(DEFAULT_STR_EMPTYFILE);
         ui->tableWidget->setRowCount(0);
         ui->tableWidget->setColumnCount(0);
+        ui->list_columns->clear();
+    }
+    else if(dataFiles.size() == 1){
+        ui->label_dataFile->setText(dataFiles.first());
     }
     else{
-        this->dataFile = new QString(dataFile);
-        ui->label_dataFile->setText(dataFile);
+        ui->label_dataFile->setText(QString("%1 files merged by time:\n%2\n...\n%3")
+                                    .arg(dataFiles.size()).arg(dataFiles.first()).arg(dataFiles.last()));
     }
 }
+
+void FileSelector::restoreLayoutFile(QString layoutFile){
+    delete this->layoutFile;
+    this->layoutFile = new QString(layoutFile);
+    ui->label_layoutFile->setText(layoutFile.isEmpty() ? DEFAULT_STR_EMPTYLAYOUT : layoutFile);
+    // Restoring a project must not trigger a reload before its data file is known
+    ui->combo_dataFormat->blockSignals(true);
+    ui->combo_dataFormat->setCurrentIndex(layoutFile.isEmpty() ? DATA_FORMAT_CSV : DATA_FORMAT_BINARY);
+    ui->combo_dataFormat->blockSignals(false);
+    ui->label_layoutFile->setEnabled(!layoutFile.isEmpty());
+    ui->button_layoutBrowse->setEnabled(!layoutFile.isEmpty());
+    ui->group_columns->setEnabled(layoutFile.isEmpty());
+}
+
+void FileSelector::restoreSelectedColumns(QStringList columns){
+    selectedColumns = columns;
+}
+
+void FileSelector::restoreTimeRange(bool enabled, double start, double end){
+    ui->check_timeRange->setChecked(enabled);
+    ui->spin_rangeStart->setValue(start);
+    ui->spin_rangeEnd->setValue(end);
+}
@@ -4,8 +4,15 @@
 #include <QFrame>
 #include <QTableWidget>
 #include <QFileDialog>
+#include <QStringList>
+#include <limits>
 
 #define DEFAULT_STR_EMPTYFILE "[No File Selected]"
+#define DEFAULT_STR_EMPTYLAYOUT "[No Layout Selected]"
+
+// Indices of the data format combo box
+#define DATA_FORMAT_CSV 0
+#define DATA_FORMAT_BINARY 1
 
 namespace Ui{
 class FileSelector;
@@ -19,31 +26,50 @@ public:
     ~FileSelector();
 
     QString getVideoFile();
-    QString getDataFile();
+    QStringList getDataFiles();
+    QString getLayoutFile();
+    QStringList getSelectedColumns();
+    void getTimeRange(double &start, double &end);
     QString getDefaultDir();
     void setDefaultDir(QString dir);
     QTableWidget * previewTable();
     void setDataPreviewSize(int previewSize, int totalSize);
+    void setLoading(bool loading);
 
 private:
     Ui::FileSelector *ui;
     // Path to video file
     QString *videoFile;
-    // Path to data file
-    QString *dataFile;
+    // Paths to data files. Several CSV files are merged into one data set.
+    QStringList *dataFiles;
+    // Path to record layout of binary data files
+    QString *layoutFile;
     // Previously-opened directory, if there is one
     QString *defaultDir;
+    // Names of the data columns to read when the data file is loaded, or empty for all of them
+    QStringList selectedColumns;
 
 signals:
     void videoFileChanged(QString fname);
-    void dataFileChanged(QString fname);
+    void dataFilesChanged(QStringList fnames);
+    void loadCanceled();
 
 public slots:
     void restoreVideoFile(QString videoFile);
-    void restoreDataFile(QString dataFile);
+    void restoreDataFiles(QStringList dataFiles);
+    void restoreLayoutFile(QString layoutFile);
+    void restoreSelectedColumns(QStringList columns);
+    void restoreTimeRange(bool enabled, double start, double end);
+    void setColumns(QStringList columnNames);
+    void setLoadProgress(int percent);
 private slots:
     void on_button_videoBrowse_clicked();
     void on_button_dataBrowse_clicked();
+    void on_button_layoutBrowse_clicked();
+    void on_combo_dataFormat_currentIndexChanged(int index);
+    void on_button_cancelLoad_clicked();
+    void on_button_loadColumns_clicked();
+    void on_check_timeRange_toggled(bool checked);
 
 };
 
@@ -6,7 +6,7 @@
 
 QT       += core gui
 
-greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport
+greaterThan(QT_MAJOR_VERSION, 4): QT += widgets printsupport concurrent
 
 TARGET = QValiData
 TEMPLATE = app
@@ -30,6 +30,7 @@ INCLUDEPATH += \
         ActDetSimView \
         ADXLSimView \
         FileSelector \
+        SweepDialog \
         SyncView \
         TrackView \
         ../lib/ActivityDetector \
@@ -38,6 +39,7 @@ INCLUDEPATH += \
         ../lib/MotionPath \
         ../lib/OpenCVDisplay \
         ../lib/OpenCVVideoPlayer \
+        ../lib/ParameterSweep \
         ../lib/QCPPlotTimeSeries \
         ../lib/QCustomPlot \
         ../lib/SimulatorTab \
@@ -55,23 +57,50 @@ LIBS += \
         -lopencv_video490.dll \
         -lopencv_tracking490.dll
 
+# HDF5 import is optional. Build with "qmake CONFIG+=hdf5" to enable it.
+hdf5 {
+    DEFINES += QVALIDATA_HAVE_HDF5
+    INCLUDEPATH += ../hdf5/x64/include
+    LIBS += -L../hdf5/x64/lib -lhdf5
+}
+
 SOURCES += \
         ../lib/ADXLSim/adxlsim.cpp \
+        ../lib/ADXLSim/adxlsweep.cpp \
         ../lib/ActivityDetector/activitydetector.cpp \
+        ../lib/ActivityDetector/activitystats.cpp \
+        ../lib/ActivityDetector/activitytimeline.cpp \
         ../lib/CloseupVideoViewer/closeupvideoviewer.cpp \
+        ../lib/MotionPath/frameoccupancy.cpp \
         ../lib/MotionPath/motionpath.cpp \
         ../lib/OpenCVVideoPlayer/opencvvideoplayer.cpp \
         ../lib/OpenCVDisplay/opencvdisplay.cpp \
+        ../lib/ParameterSweep/parametersweep.cpp \
         ../lib/QCPPlotTimeSeries/qcpplottimeseries.cpp \
         ../lib/QCustomPlot/qcustomplot.cpp \
+        ../lib/SimulatorTab/simulationrunner.cpp \
         ../lib/SimulatorTab/simulatortab.cpp \
+        ../lib/TimeSeries/binaryreader.cpp \
+        ../lib/TimeSeries/channel.cpp \
+        ../lib/TimeSeries/columnpager.cpp \
+        ../lib/TimeSeries/csvreader.cpp \
+        ../lib/TimeSeries/hdf5reader.cpp \
+        ../lib/TimeSeries/streamset.cpp \
+        ../lib/TimeSeries/timeindex.cpp \
         ../lib/TimeSeries/timeseries.cpp \
+        ../lib/TimeSeries/timeseriescache.cpp \
+        ../lib/TimeSeries/timeseriescolumn.cpp \
+        ../lib/TimeSeries/timeseriesloader.cpp \
+        ../lib/TimeSeries/timeseriesmerge.cpp \
+        ../lib/TimeSeries/timeseriesresample.cpp \
         ../lib/VideoTracker/bgsfilteredtracker.cpp \
         ../lib/VideoTracker/filteredtracker.cpp \
         ADXLSimView/adxlsimview.cpp \
         ActDetSimView/actdetsimview.cpp \
         ActDetSimView/accelfilterdetector.cpp \
+        ActDetSimView/accelfiltersweep.cpp \
         FileSelector/fileselector.cpp \
+        SweepDialog/sweepdialog.cpp \
         SyncView/syncview.cpp \
         TrackView/trackview.cpp \
         main.cpp \
@@ -79,21 +108,44 @@ SOURCES += \
 
 HEADERS += \
         ../lib/ADXLSim/adxlsim.h \
+        ../lib/ADXLSim/adxlsweep.h \
         ../lib/ActivityDetector/activitydetector.h \
+        ../lib/ActivityDetector/activitystats.h \
+        ../lib/ActivityDetector/activitytimeline.h \
+        ../lib/ActivityDetector/detectorpipeline.h \
         ../lib/CloseupVideoViewer/closeupvideoviewer.h \
+        ../lib/MotionPath/frameoccupancy.h \
         ../lib/MotionPath/motionpath.h \
         ../lib/OpenCVVideoPlayer/opencvvideoplayer.h \
         ../lib/OpenCVDisplay/opencvdisplay.h \
+        ../lib/ParameterSweep/parametersweep.h \
         ../lib/QCPPlotTimeSeries/qcpplottimeseries.h \
         ../lib/QCustomPlot/qcustomplot.h \
+        ../lib/SimulatorTab/simulationrunner.h \
+        ../lib/SimulatorTab/simulationstage.h \
         ../lib/SimulatorTab/simulatortab.h \
+        ../lib/TimeSeries/binaryreader.h \
+        ../lib/TimeSeries/channel.h \
+        ../lib/TimeSeries/columnpager.h \
+        ../lib/TimeSeries/csvreader.h \
+        ../lib/TimeSeries/hdf5reader.h \
+        ../lib/TimeSeries/loadprogress.h \
+        ../lib/TimeSeries/streamset.h \
+        ../lib/TimeSeries/timeindex.h \
         ../lib/TimeSeries/timeseries.h \
+        ../lib/TimeSeries/timeseriescache.h \
+        ../lib/TimeSeries/timeseriescolumn.h \
+        ../lib/TimeSeries/timeseriesloader.h \
+        ../lib/TimeSeries/timeseriesmerge.h \
+        ../lib/TimeSeries/timeseriesresample.h \
         ../lib/VideoTracker/bgsfilteredtracker.h \
         ../lib/VideoTracker/filteredtracker.h \
         ActDetSimView/accelfilterdetector.h \
+        ActDetSimView/accelfiltersweep.h \
         ActDetSimView/actdetsimview.h \
         ADXLSimView/adxlsimview.h \
         FileSelector/fileselector.h \
+        SweepDialog/sweepdialog.h \
         SyncView/syncview.h \
         TrackView/trackview.h \
         mainwindow.h
@@ -102,6 +154,7 @@ FORMS += \
         ActDetSimView/actdetsimview.ui \
         ADXLSimView/adxlsimview.ui \
         FileSelector/fileselector.ui \
+        SweepDialog/sweepdialog.ui \
         SyncView/syncview.ui \
         TrackView/trackview.ui \
         mainwindow.ui
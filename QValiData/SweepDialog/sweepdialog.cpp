@@ -0,0 +1,327 @@
+#include "sweepdialog.h"
+#include "ui_sweepdialog.h"
+#include <QLabel>
+#include <QMessageBox>
+#include <QtConcurrent>
+#include <cmath>
+
+namespace {
+// Runs one configuration. QtConcurrent::mapped takes the result type from result_type.
+struct SweepRunner
+{
+    typedef SweepResult result_type;
+    const ParameterSweep *sweep;
+    EnergyModel energy;
+    QVector<double> checked;    // Also simulated the slow way, to check the sweep against
+
+    SweepResult operator()(const QVector<double> &config) const {
+        SweepResult result;
+        result.config = config;
+        result.counts = sweep->run(config);
+        result.energy = energy.energy(result.counts.samples, result.counts.activeSamples, result.counts.wakeups);
+        if(config == checked)
+            sweep->check(config, result.counts, result.mismatch);
+        return result;
+    }
+};
+}
+
+SweepDialog::SweepDialog(ParameterSweep *sweep, const EnergyModel &energy, const QVector<double> &current, QWidget *parent) :
+    QDialog(parent),
+    ui(new Ui::SweepDialog),
+    sweep(sweep),
+    energy(energy),
+    current(current)
+{
+    ui->setupUi(this);
+    selected = -1;
+
+    // One row of spinboxes per parameter, starting from the sweep's default ranges
+    params = sweep->parameters(current);
+    QStringList headers;
+    for(int p=0; p<params.size(); p++){
+        const SweepParameter &param = params.at(p);
+        const double singleStep = (param.decimals > 0) ? std::pow(10.0, 1 - param.decimals) : 1;
+        RangeRow row;
+        QDoubleSpinBox **boxes[3] = {&row.from, &row.to, &row.step};
+        const double initial[3] = {param.from, param.to, param.step};
+        ui->gridLayout_ranges->addWidget(new QLabel(param.name, ui->groupBox_ranges), p + 1, 0);
+        for(int col=0; col<3; col++){
+            QDoubleSpinBox *spinbox = new QDoubleSpinBox(ui->groupBox_ranges);
+            spinbox->setDecimals(param.decimals);
+            spinbox->setRange((col == 2) ? 0 : param.minimum, param.maximum);
+            spinbox->setSingleStep(singleStep);
+            spinbox->setValue(initial[col]);
+            connect(spinbox, SIGNAL(valueChanged(double)), this, SLOT(updateConfigCount()));
+            ui->gridLayout_ranges->addWidget(spinbox, p + 1, col + 1);
+            *boxes[col] = spinbox;
+        }
+        ranges.append(row);
+        headers << param.name;
+    }
+    connect(&watcher, SIGNAL(progressRangeChanged(int, int)), ui->progressBar, SLOT(setRange(int, int)));
+    connect(&watcher, SIGNAL(progressValueChanged(int)), ui->progressBar, SLOT(setValue(int)));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(sweepFinished()));
+
+    headers << "Energy (mAh)" << "Active (%)" << "Wakeups" << "Covered Events" << "False + Events";
+    ui->table_results->setColumnCount(headers.size());
+    ui->table_results->setHorizontalHeaderLabels(headers);
+
+    QCustomPlot *plot = ui->plot_pareto;
+    plot->xAxis->setLabel("Energy (mAh)");
+    plot->yAxis->setLabel("Covered Events");
+    plot->yAxis2->setLabel("False + Events");
+    plot->yAxis2->setVisible(true);
+    plot->legend->setVisible(true);
+    plot->axisRect()->insetLayout()->setInsetAlignment(0, Qt::AlignBottom|Qt::AlignRight);
+
+    updateConfigCount();
+}
+
+SweepDialog::~SweepDialog()
+{
+    stop();
+    delete ui;
+}
+
+/**
+ * @brief SweepDialog::selectedConfig The configuration picked from the results, one value per parameter. Only valid
+ * once the dialog has been accepted.
+ */
+QVector<double> SweepDialog::selectedConfig() const{
+    return results.at(selected).config;
+}
+
+void SweepDialog::reject(){
+    stop();
+    QDialog::reject();
+}
+
+// Cancels the sweep in progress, if any, and waits for the configurations already started
+void SweepDialog::stop(){
+    if(watcher.isRunning()){
+        watcher.cancel();
+        watcher.waitForFinished();
+    }
+}
+
+// Every value each parameter takes
+QVector<QVector<double>> SweepDialog::values() const{
+    QVector<QVector<double>> v;
+    for(const RangeRow &row: ranges){
+        v.append(ParameterSweep::steps(row.from->value(), row.to->value(), row.step->value()));
+    }
+    return v;
+}
+
+void SweepDialog::updateConfigCount(){
+    qint64 total = 1;
+    for(const QVector<double> &v: values()){
+        total *= v.size();
+    }
+    ui->label_configCount->setText(QString("%1 configurations").arg(total));
+}
+
+void SweepDialog::setRunning(bool running){
+    ui->groupBox_ranges->setEnabled(!running);
+    ui->button_run->setEnabled(!running);
+    ui->button_cancel->setEnabled(running);
+    ui->button_use->setEnabled(!running && selected >= 0);
+}
+
+void SweepDialog::on_button_run_clicked()
+{
+    const QVector<QVector<double>> v = values();
+    const QVector<QVector<double>> grid = ParameterSweep::grid(v);
+    if(grid.isEmpty()){
+        QMessageBox::warning(this, "", "Too many configurations.");
+        return;
+    }
+    if(grid.size() > SWEEP_LARGE &&
+            QMessageBox::question(this, "", QString("Run all %1 configurations? This may take a while.").arg(grid.size())) != QMessageBox::Yes){
+        return;
+    }
+
+    // The data is read here, on the GUI thread; the workers only read what the sweep has prepared
+    elapsed.start();
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool prepared = sweep->prepare(v);
+    QApplication::restoreOverrideCursor();
+    if(!prepared){
+        QMessageBox::warning(this, "", sweep->getErrorString());
+        return;
+    }
+
+    results.clear();
+    onFront.clear();
+    selected = -1;
+    fillTable();
+    plotResults();
+
+    SweepRunner runner;
+    runner.sweep = sweep;
+    runner.energy = energy;
+    // The view's own configuration is checked if it is swept, as its results can be compared to the view's
+    runner.checked = grid.contains(current) ? current : grid.first();
+    setRunning(true);
+    ui->label_status->setText(QString("Running %1 configurations...").arg(grid.size()));
+    watcher.setFuture(QtConcurrent::mapped(grid, runner));
+}
+
+void SweepDialog::on_button_cancel_clicked()
+{
+    watcher.cancel();
+}
+
+void SweepDialog::sweepFinished(){
+    // A canceled sweep keeps the configurations it got through
+    const QFuture<SweepResult> future = watcher.future();
+    const bool canceled = future.isCanceled();
+    results.clear();
+    for(int i=0; i<future.progressMaximum(); i++){
+        if(future.isResultReadyAt(i))
+            results.append(future.resultAt(i));
+    }
+    watcher.setFuture(QFuture<SweepResult>());
+    // Results computed from data that could not be read are not shown
+    const QString error = sweep->getErrorString();
+    if(!error.isEmpty()){
+        results.clear();
+        QMessageBox::warning(this, "", error);
+    }
+    for(const SweepResult &result: results){
+        if(!result.mismatch.isEmpty())
+            QMessageBox::warning(this, "", result.mismatch);
+    }
+
+    onFront.fill(false, results.size());
+    const QVector<int> front = ParameterSweep::paretoFront(results);
+    for(int i: front){
+        onFront[i] = true;
+    }
+
+    setRunning(false);
+    fillTable();
+    plotResults();
+    ui->label_status->setText(QString("%1%2 configurations in %3 s, %4 on the Pareto front. %5 annotated events.")
+                              .arg(canceled ? QString("Canceled after ") : QString()).arg(results.size())
+                              .arg(elapsed.elapsed()/1000.0, 0, 'f', 1).arg(front.size()).arg(sweep->numEvents()));
+}
+
+void SweepDialog::fillTable(){
+    QTableWidget *table = ui->table_results;
+    table->setSortingEnabled(false);
+    table->clearContents();
+    table->setRowCount(0);
+
+    QVector<int> shown;
+    for(int i=0; i<results.size(); i++){
+        if(!ui->checkBox_paretoOnly->isChecked() || onFront.at(i))
+            shown.append(i);
+    }
+
+    QFont bold = table->font();
+    bold.setBold(true);
+    table->setRowCount(shown.size());
+    for(int row=0; row<shown.size(); row++){
+        const int i = shown.at(row);
+        const SweepResult &r = results.at(i);
+        const ActivityCounts &c = r.counts;
+        const double activePercent = (c.samples > 0) ? std::round(1000.0*c.activeSamples/c.samples)/10.0 : 0;
+        QVector<double> cells = r.config;
+        cells << r.energy << activePercent << c.wakeups << c.coveredEvents << c.falsePositiveEvents;
+        for(int col=0; col<cells.size(); col++){
+            // Numbers rather than text, so that columns sort numerically
+            QTableWidgetItem *item = new QTableWidgetItem();
+            item->setData(Qt::DisplayRole, cells.at(col));
+            if(onFront.at(i))
+                item->setFont(bold);
+            table->setItem(row, col, item);
+        }
+        table->item(row, 0)->setData(Qt::UserRole, i);
+    }
+    table->setSortingEnabled(true);
+    table->resizeColumnsToContents();
+}
+
+void SweepDialog::plotResults(){
+    QVector<double> energyAll, coveredAll, energyFront, coveredFront, falseFront;
+    for(int i=0; i<results.size(); i++){
+        const SweepResult &r = results.at(i);
+        energyAll.append(r.energy);
+        coveredAll.append(r.counts.coveredEvents);
+        if(onFront.at(i)){
+            energyFront.append(r.energy);
+            coveredFront.append(r.counts.coveredEvents);
+            falseFront.append(r.counts.falsePositiveEvents);
+        }
+    }
+
+    QCustomPlot *plot = ui->plot_pareto;
+    plot->clearGraphs();
+
+    QCPGraph *all = plot->addGraph();
+    all->setName("Covered Events");
+    all->setLineStyle(QCPGraph::lsNone);
+    all->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssDisc, QColor(160, 160, 160), 3));
+    all->setData(energyAll, coveredAll);
+
+    QCPGraph *front = plot->addGraph();
+    front->setName("Covered Events (Pareto)");
+    front->setLineStyle(QCPGraph::lsNone);
+    front->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, QColor(218, 0, 0), 7));
+    front->setData(energyFront, coveredFront);
+
+    QCPGraph *falsePositives = plot->addGraph(plot->xAxis, plot->yAxis2);
+    falsePositives->setName("False + Events (Pareto)");
+    falsePositives->setLineStyle(QCPGraph::lsNone);
+    falsePositives->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCross, QColor(0, 0, 218), 7));
+    falsePositives->setData(energyFront, falseFront);
+
+    // Marks the configuration selected in the table
+    QCPGraph *marker = plot->addGraph();
+    marker->setName("Selected");
+    marker->setLineStyle(QCPGraph::lsNone);
+    marker->setScatterStyle(QCPScatterStyle(QCPScatterStyle::ssCircle, QPen(Qt::black, 2), Qt::NoBrush, 12));
+
+    plot->rescaleAxes();
+    plot->replot();
+}
+
+void SweepDialog::on_table_results_itemSelectionChanged()
+{
+    const QList<QTableWidgetItem *> items = ui->table_results->selectedItems();
+    selected = items.isEmpty() ? -1 : ui->table_results->item(items.first()->row(), 0)->data(Qt::UserRole).toInt();
+    ui->button_use->setEnabled(!watcher.isRunning() && selected >= 0);
+
+    if(ui->plot_pareto->graphCount() < 4)
+        return;
+    QVector<double> x, y;
+    if(selected >= 0){
+        x.append(results.at(selected).energy);
+        y.append(results.at(selected).counts.coveredEvents);
+    }
+    ui->plot_pareto->graph(3)->setData(x, y);
+    ui->plot_pareto->replot();
+}
+
+void SweepDialog::on_checkBox_paretoOnly_toggled(bool checked)
+{
+    Q_UNUSED(checked)
+    selected = -1;
+    fillTable();
+    on_table_results_itemSelectionChanged();
+}
+
+void SweepDialog::on_button_use_clicked()
+{
+    if(selected >= 0){
+        stop();
+        accept();
+    }
+}
+
+void SweepDialog::on_button_close_clicked()
+{
+    reject();
+}
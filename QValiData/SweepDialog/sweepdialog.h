@@ -0,0 +1,83 @@
+#ifndef SWEEPDIALOG_H
+#define SWEEPDIALOG_H
+
+#include <QDialog>
+#include <QDoubleSpinBox>
+#include <QElapsedTimer>
+#include <QFutureWatcher>
+#include "parametersweep.h"
+
+// Sweeps larger than this are only run after asking
+#define SWEEP_LARGE 100000
+
+namespace Ui {
+class SweepDialog;
+}
+
+/**
+ * @brief The SweepDialog class runs a ParameterSweep over a grid of configurations on the thread pool, and shows the
+ * results as a table and as a plot of energy against covered and false positive events, with the Pareto front
+ * highlighted. A configuration picked from the table can be handed back to the simulator view.
+ *
+ * One configuration of each sweep, the view's own if it is swept, is also simulated the way the view does it (see
+ * ParameterSweep::check), and any difference is reported.
+ */
+class SweepDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit SweepDialog(ParameterSweep *sweep, const EnergyModel &energy, const QVector<double> &current,
+                         QWidget *parent = nullptr);
+    ~SweepDialog() override;
+    QVector<double> selectedConfig() const;
+
+public slots:
+    void reject() override;
+
+private slots:
+    void on_button_run_clicked();
+
+    void on_button_cancel_clicked();
+
+    void on_button_use_clicked();
+
+    void on_button_close_clicked();
+
+    void on_checkBox_paretoOnly_toggled(bool checked);
+
+    void on_table_results_itemSelectionChanged();
+
+    void updateConfigCount();
+
+    void sweepFinished();
+
+private:
+    // Spinboxes of one row of the ranges
+    struct RangeRow{
+        QDoubleSpinBox *from;
+        QDoubleSpinBox *to;
+        QDoubleSpinBox *step;
+    };
+
+    QVector<QVector<double>> values() const;
+    void setRunning(bool running);
+    void fillTable();
+    void plotResults();
+    void stop();
+
+    Ui::SweepDialog *ui;
+    ParameterSweep *sweep;  // Not owned
+    EnergyModel energy;
+    QVector<double> current;    // The simulator view's configuration
+    QList<SweepParameter> params;
+    QVector<RangeRow> ranges;
+    QFutureWatcher<SweepResult> watcher;
+    QElapsedTimer elapsed;
+
+    QVector<SweepResult> results;
+    QVector<bool> onFront;
+    int selected;   // Index into results, or -1
+};
+
+#endif // SWEEPDIALOG_H
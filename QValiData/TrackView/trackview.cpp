@@ -5,6 +5,9 @@
 #include <QDebug>
 #include <QTime>
 #include <QMessageBox>
+#include <QFileDialog>
+#include <QApplication>
+#include "timeseriesresample.h"
 
 using namespace cv;
 TrackView::TrackView(QWidget *parent) :
@@ -466,3 +469,31 @@ void TrackView::on_checkBox_showPaths_toggled(bool checked)
         ui->vidWidget->frameUpdate();
     }
 }
+
+// Writes the sensor data at every video frame, e.g. as training data for models working on video and sensor data
+void TrackView::on_button_exportFrames_clicked()
+{
+    if(!hasInit || data->numColumns() == 0 || data->numRows() == 0 || ui->vidWidget->getTotalFrames() <= 0){
+        QMessageBox::warning(this, "", "Open a video and a data file first.");
+        return;
+    }
+    if(rateMultiplier <= 0){
+        QMessageBox::warning(this, "", "Synchronize the video and the data first.");
+        return;
+    }
+
+    QString filter;
+    QString saveFileName = QFileDialog::getSaveFileName(this, "Export data per frame...", "", "CSV (*.csv);;Binary Records (*.bin)", &filter);
+    if(saveFileName.isEmpty())
+        return;
+    TimeSeriesResample::Format format = filter.startsWith("Binary") ? TimeSeriesResample::Binary : TimeSeriesResample::CSV;
+
+    QString error;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    bool result = TimeSeriesResample::exportFrames(data, ui->vidWidget->getTotalFrames(), ui->vidWidget->getFrameInterval(),
+                                                   deltaTVD, rateMultiplier, saveFileName, format, &error);
+    QApplication::restoreOverrideCursor();
+    if(!result){
+        QMessageBox::warning(this, "Export Failed", error);
+    }
+}
@@ -76,6 +76,8 @@ private slots:
 
     void on_checkBox_showPaths_toggled(bool checked);
 
+    void on_button_exportFrames_clicked();
+
 public slots:
     void syncCap();
     void syncPath();
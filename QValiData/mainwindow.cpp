@@ -14,6 +14,7 @@ MainWindow::MainWindow(QWidget *parent) :
     userFileName = new QString();
 
     fs = new FileSelector();
+    loader = new TimeSeriesLoader(this);
     sync = new SyncView();
     track = new TrackView();
 
@@ -31,7 +32,12 @@ MainWindow::MainWindow(QWidget *parent) :
 
     loadPersistent();
 
-    connect(fs, SIGNAL(dataFileChanged(QString)), this, SLOT(gotDataFile(QString)));
+    connect(fs, SIGNAL(dataFilesChanged(QStringList)), this, SLOT(gotDataFiles(QStringList)));
+    connect(fs, SIGNAL(loadCanceled()), loader, SLOT(cancel()));
+    connect(loader, SIGNAL(progressChanged(int)), fs, SLOT(setLoadProgress(int)));
+    connect(loader, SIGNAL(previewReady(QStringList, QList<QList<qreal>>)), this, SLOT(gotDataPreview(QStringList, QList<QList<qreal>>)));
+    connect(loader, SIGNAL(loaded(TimeSeries *, StreamSet *)), this, SLOT(gotData(TimeSeries *, StreamSet *)));
+    connect(loader, SIGNAL(failed(QString)), this, SLOT(dataLoadFailed(QString)));
     connect(fs, SIGNAL(videoFileChanged(QString)), this, SLOT(gotVideoFile(QString)));
     connect(sync, SIGNAL(syncChanged(double, double)), this, SLOT(updateSync(double, double)));
     connect(sync, SIGNAL(syncChanged(double, double)), track, SLOT(updateSync(double, double)));
@@ -59,13 +65,13 @@ MainWindow::MainWindow(QWidget *parent) :
 void MainWindow::init(){
     cap = new VideoCapture();
     data = new TimeSeries();
+    streams = nullptr;
 
     videoFileName = new QString();
-    dataFileName = new QString();
+    dataFileNames = new QStringList();
     videoFileValid = false;
     dataFileValid = false;
 
-    dataFile = new QFile();
     data = new TimeSeries();
     paths = new QList<MotionPath *>();
 
@@ -158,9 +164,31 @@ void MainWindow::loadUserFile(){
 
     userFile->beginGroup("file");
     QString saveFileVideo = parentDirectory.absoluteFilePath(userFile->value("vidfile", QString()).toString());
-    QString saveFileData = parentDirectory.absoluteFilePath(userFile->value("datafile", QString()).toString());
+    QString saveFileData = userFile->value("datafile", QString()).toString();
+    QString saveFileLayout = userFile->value("datalayout", QString()).toString();
+    QStringList saveFileColumns = userFile->value("datacolumns", QStringList()).toStringList();
+    bool saveRangeEnabled = userFile->value("rangeenabled", false).toBool();
+    double saveRangeStart = userFile->value("rangestart", 0.0).toDouble();
+    double saveRangeEnd = userFile->value("rangeend", 0.0).toDouble();
     userFile->endGroup();
 
+    // Projects covering a whole deployment list all of their data files. Older projects only have the one.
+    QStringList saveFileDataList;
+    int numDataFiles = userFile->beginReadArray("datafiles");
+    for(int i=0; i<numDataFiles; ++i){
+        userFile->setArrayIndex(i);
+        saveFileDataList.append(parentDirectory.absoluteFilePath(userFile->value("path", QString()).toString()));
+    }
+    userFile->endArray();
+    if(saveFileDataList.isEmpty() && !saveFileData.isEmpty()){
+        saveFileDataList.append(parentDirectory.absoluteFilePath(saveFileData));
+    }
+
+    // The layout decides how the data file is read, so it has to be known first
+    fs->restoreLayoutFile(saveFileLayout.isEmpty() ? QString() : parentDirectory.absoluteFilePath(saveFileLayout));
+    fs->restoreSelectedColumns(saveFileColumns);
+    fs->restoreTimeRange(saveRangeEnabled, saveRangeStart, saveRangeEnd);
+
     if(!saveFileVideo.isEmpty()){
         if(cap->isOpened()){
             cap->release();
@@ -168,8 +196,8 @@ void MainWindow::loadUserFile(){
         gotVideoFile(saveFileVideo);
     }
 
-    if(!saveFileData.isEmpty()){
-        gotDataFile(saveFileData);
+    if(!saveFileDataList.isEmpty()){
+        gotDataFiles(saveFileDataList);
     }
     setWindowTitle(*userFileName + " - QValiData");
 }
@@ -207,9 +235,27 @@ void MainWindow::saveUserFile(){
 
     userFile->beginGroup("file");
     userFile->setValue("vidfile", parentDirectory.relativeFilePath(*videoFileName));
-    userFile->setValue("datafile", parentDirectory.relativeFilePath(*dataFileName));
+    // The first file is also written on its own, so that older versions can still open the project
+    userFile->setValue("datafile", dataFileNames->isEmpty() ? QString() : parentDirectory.relativeFilePath(dataFileNames->first()));
+    QString layoutFileName = fs->getLayoutFile();
+    userFile->setValue("datalayout", layoutFileName.isEmpty() ? QString() : parentDirectory.relativeFilePath(layoutFileName));
+    userFile->setValue("datacolumns", fs->getSelectedColumns());
+    double rangeStart, rangeEnd;
+    fs->getTimeRange(rangeStart, rangeEnd);
+    userFile->setValue("rangeenabled", qIsFinite(rangeStart));
+    if(qIsFinite(rangeStart)){
+        userFile->setValue("rangestart", rangeStart);
+        userFile->setValue("rangeend", rangeEnd);
+    }
     userFile->endGroup();
 
+    userFile->beginWriteArray("datafiles");
+    for(int i=0; i<dataFileNames->size(); ++i){
+        userFile->setArrayIndex(i);
+        userFile->setValue("path", parentDirectory.relativeFilePath(dataFileNames->at(i)));
+    }
+    userFile->endArray();
+
     userFile->beginGroup("sync");
     userFile->setValue("starttime", startTime);
     userFile->setValue("datarate", dataRate);
@@ -245,51 +291,86 @@ void MainWindow::gotVideoFile(QString fname){
     }
 }
 
-void MainWindow::gotDataFile(QString fname){
-    delete dataFileName;
-    dataFileName = new QString(fname);
-    dataFile->setFileName(*dataFileName);
-    delete data;
-    data = new TimeSeries();
-    bool openResult = data->fromCSV(dataFile, 0);
-    if(openResult){
-        fs->restoreDataFile(*dataFileName);
-
-
-        QTableWidget *table = fs->previewTable();
-        // Set table to show 10 rows or less, plus the header.
-        int previewSize = qMin(data->numRows(), 10);
-        table->setRowCount(previewSize+1);
-        table->setColumnCount(data->numColumns());
-        for(int i=0; i<data->numColumns(); i++){
-            table->setItem(0, i, new QTableWidgetItem(data->columnName(i)));
-        }
+void MainWindow::gotDataFiles(QStringList fnames){
+    delete dataFileNames;
+    dataFileNames = new QStringList(fnames);
+    // Nothing can use the data until it has been loaded
+    dataFileValid = false;
+    lockOtherTabs();
+    fs->setLoading(true);
+    LoadRequest request;
+    request.dataFileNames = *dataFileNames;
+    request.layoutFileName = fs->getLayoutFile();
+    request.selectedColumns = fs->getSelectedColumns();
+    fs->getTimeRange(request.rangeStart, request.rangeEnd);
+    loader->start(request);
+}
 
-        for(int row=1; row<table->rowCount(); row++){
-            QList<qreal> dataRow = data->rowData(row-1);
-            for(int col=0; col<table->columnCount(); col++){
-                table->setItem(row, col, new QTableWidgetItem(QString::number(dataRow.at(col))));
-            }
-        }
-        fs->setDataPreviewSize(previewSize, data->numRows());
+// Shows the first rows of the data file while the rest is still loading
+void MainWindow::gotDataPreview(QStringList columnNames, QList<QList<qreal>> rows){
+    fs->restoreDataFiles(*dataFileNames);
+    fs->setColumns(columnNames);
+    showDataPreview(columnNames, rows, -1);
+}
 
-        dataFileValid = true;
+void MainWindow::gotData(TimeSeries *newData, StreamSet *newStreams){
+    fs->setLoading(false);
+    // Only deleted once the simulators have let go of them, as they may be reading them on a worker thread
+    TimeSeries *oldData = data;
+    StreamSet *oldStreams = streams;
+    data = newData;
+    streams = newStreams;
+    fs->restoreDataFiles(*dataFileNames);
 
-        sync->attachTimeSeries(data);
-        track->attachTimeSeries(data);
+    // The preview rows are already shown. Reading them from data instead would read in any columns left out of the load.
+    fs->setDataPreviewSize(qMax(fs->previewTable()->rowCount() - 1, 0), data->numRows());
 
-        for(SimulatorTab * s: *simulators){
-            s->attachTimeSeries(data);
-        }
+    dataFileValid = true;
 
-        if(videoFileValid && dataFileValid){
-            unlockOtherTabs();
-        }
+    sync->attachTimeSeries(data);
+    track->attachTimeSeries(data);
+
+    for(SimulatorTab * s: *simulators){
+        s->attachTimeSeries(data);
+        s->attachStreams(streams);
     }
-    else{
-        QMessageBox::warning(this, "Invalid Data Format", QString("'%1'\ncannot be opened, or is not a valid data file.").arg(fname));
-        lockOtherTabs();
+    delete oldData;
+    delete oldStreams;
+
+    if(videoFileValid && dataFileValid){
+        unlockOtherTabs();
+    }
+}
+
+void MainWindow::dataLoadFailed(QString error){
+    fs->setLoading(false);
+    // No error means the user canceled
+    if(!error.isEmpty()){
+        QMessageBox::warning(this, "Invalid Data Format", error);
+    }
+    lockOtherTabs();
+}
+
+/**
+ * @brief MainWindow::showDataPreview Fills the preview table with a header row followed by the given rows
+ * @param totalRows Number of rows in the whole file, or -1 if not known yet
+ */
+void MainWindow::showDataPreview(const QStringList &columnNames, const QList<QList<qreal>> &rows, int totalRows){
+    QTableWidget *table = fs->previewTable();
+    // Set table to show PREVIEW_ROWS rows or less, plus the header.
+    table->setRowCount(rows.size()+1);
+    table->setColumnCount(columnNames.size());
+    for(int i=0; i<columnNames.size(); i++){
+        table->setItem(0, i, new QTableWidgetItem(columnNames.at(i)));
+    }
+
+    for(int row=1; row<table->rowCount(); row++){
+        const QList<qreal> &dataRow = rows.at(row-1);
+        for(int col=0; col<table->columnCount() && col<dataRow.size(); col++){
+            table->setItem(row, col, new QTableWidgetItem(QString::number(dataRow.at(col))));
+        }
     }
+    fs->setDataPreviewSize(rows.size(), totalRows);
 }
 
 // Disable all but the first tab
@@ -353,10 +434,13 @@ void MainWindow::on_tabWidget_currentChanged(int index)
 
 void MainWindow::on_actionNew_triggered()
 {
+    loader->cancel();
     userFile = new QSettings();
     userFileName = new QString();
-    fs->restoreDataFile("");
+    fs->restoreDataFiles(QStringList());
     fs->restoreVideoFile("");
+    fs->restoreSelectedColumns(QStringList());
+    fs->restoreTimeRange(false, 0, 0);
     setWindowTitle("QValiData");
     init();
 }
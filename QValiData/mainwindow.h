@@ -7,6 +7,7 @@
 #include "fileselector.h"
 #include "syncview.h"
 #include "timeseries.h"
+#include "timeseriesloader.h"
 #include "trackview.h"
 #include "adxlsimview.h"
 #include "actdetsimview.h"
@@ -40,14 +41,16 @@ private:
     FileSelector *fs;
 
     QString *videoFileName;
-    QString *dataFileName;
+    QStringList *dataFileNames;
 
     bool videoFileValid;
     bool dataFileValid;
 
     VideoCapture *cap;
     TimeSeries *data;
-    QFile *dataFile;
+    // Data files recorded at other rates than data, or null if there are none
+    StreamSet *streams;
+    TimeSeriesLoader *loader;
 
     SyncView *sync;
     double startTime;
@@ -63,10 +66,14 @@ private:
 
     void lockOtherTabs();
     void unlockOtherTabs();
+    void showDataPreview(const QStringList &columnNames, const QList<QList<qreal>> &rows, int totalRows);
 
 private slots:
     void gotVideoFile(QString fname);
-    void gotDataFile(QString fname);
+    void gotDataFiles(QStringList fnames);
+    void gotDataPreview(QStringList columnNames, QList<QList<qreal>> rows);
+    void gotData(TimeSeries *newData, StreamSet *newStreams);
+    void dataLoadFailed(QString error);
     void updateSync(double start, double rate);
     void updateStat(double start, double end);
     void on_tabWidget_currentChanged(int index);
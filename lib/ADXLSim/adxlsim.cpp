@@ -1,6 +1,119 @@
 #include "adxlsim.h"
+#include <algorithm>
+#include <cstring>
 
-ADXLSim2::ADXLSim2(double threshAct, double threshInact, int timeAct, int timeInact, QObject *parent):QObject(parent){
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define ADXLSIM_AVX2
+#include <immintrin.h>
+#endif
+
+namespace {
+inline double maxDelta(double X, double Y, double Z, const double *ref){
+    return qMax(qMax(qAbs(X - ref[ACCEL_X]), qAbs(Y - ref[ACCEL_Y])), qAbs(Z - ref[ACCEL_Z]));
+}
+
+// First sample in [begin, end) that is not below the inactive threshold, or end
+int scanAwakeScalar(const double *x, const double *y, const double *z, int begin, int end, const double *refInact, double threshInact){
+    for(int i=begin; i<end; i++){
+        if(!(maxDelta(x[i], y[i], z[i], refInact) < threshInact))
+            return i;
+    }
+    return end;
+}
+
+// First sample in [begin, end) that exceeds the active threshold or reaches the inactive one, or end
+int scanAsleepScalar(const double *x, const double *y, const double *z, int begin, int end,
+                     const double *refAct, double threshAct, const double *refInact, double threshInact){
+    for(int i=begin; i<end; i++){
+        if(maxDelta(x[i], y[i], z[i], refAct) > threshAct || maxDelta(x[i], y[i], z[i], refInact) >= threshInact)
+            return i;
+    }
+    return end;
+}
+
+#ifdef ADXLSIM_AVX2
+// maxDelta of four samples at once. qMax(a, b) keeps a if either is NaN, and so does _mm256_max_pd(b, a), so the
+// comparisons made on the result are the same as in the scalar code.
+__attribute__((target("avx2")))
+inline __m256d maxDelta4(const double *x, const double *y, const double *z, __m256d rx, __m256d ry, __m256d rz){
+    const __m256d sign = _mm256_set1_pd(-0.0);
+    const __m256d dx = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(x), rx));
+    const __m256d dy = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(y), ry));
+    const __m256d dz = _mm256_andnot_pd(sign, _mm256_sub_pd(_mm256_loadu_pd(z), rz));
+    return _mm256_max_pd(dz, _mm256_max_pd(dy, dx));
+}
+
+__attribute__((target("avx2")))
+int scanAwakeAVX2(const double *x, const double *y, const double *z, int begin, int end, const double *refInact, double threshInact){
+    const __m256d rx = _mm256_set1_pd(refInact[ACCEL_X]);
+    const __m256d ry = _mm256_set1_pd(refInact[ACCEL_Y]);
+    const __m256d rz = _mm256_set1_pd(refInact[ACCEL_Z]);
+    const __m256d t = _mm256_set1_pd(threshInact);
+    int i = begin;
+    for(; i + 4 <= end; i += 4){
+        const int loud = _mm256_movemask_pd(_mm256_cmp_pd(maxDelta4(x + i, y + i, z + i, rx, ry, rz), t, _CMP_NLT_UQ));
+        if(loud != 0)
+            return i + __builtin_ctz(unsigned(loud));
+    }
+    return scanAwakeScalar(x, y, z, i, end, refInact, threshInact);
+}
+
+__attribute__((target("avx2")))
+int scanAsleepAVX2(const double *x, const double *y, const double *z, int begin, int end,
+                   const double *refAct, double threshAct, const double *refInact, double threshInact){
+    const __m256d ax = _mm256_set1_pd(refAct[ACCEL_X]);
+    const __m256d ay = _mm256_set1_pd(refAct[ACCEL_Y]);
+    const __m256d az = _mm256_set1_pd(refAct[ACCEL_Z]);
+    const __m256d ix = _mm256_set1_pd(refInact[ACCEL_X]);
+    const __m256d iy = _mm256_set1_pd(refInact[ACCEL_Y]);
+    const __m256d iz = _mm256_set1_pd(refInact[ACCEL_Z]);
+    const __m256d tAct = _mm256_set1_pd(threshAct);
+    const __m256d tInact = _mm256_set1_pd(threshInact);
+    int i = begin;
+    for(; i + 4 <= end; i += 4){
+        const __m256d act = _mm256_cmp_pd(maxDelta4(x + i, y + i, z + i, ax, ay, az), tAct, _CMP_GT_OQ);
+        const __m256d inact = _mm256_cmp_pd(maxDelta4(x + i, y + i, z + i, ix, iy, iz), tInact, _CMP_GE_OQ);
+        const int event = _mm256_movemask_pd(_mm256_or_pd(act, inact));
+        if(event != 0)
+            return i + __builtin_ctz(unsigned(event));
+    }
+    return scanAsleepScalar(x, y, z, i, end, refAct, threshAct, refInact, threshInact);
+}
+#endif
+
+int scanAwake(const double *x, const double *y, const double *z, int begin, int end, const double *refInact, double threshInact){
+#ifdef ADXLSIM_AVX2
+    if(ADXLSimCore::hasAVX2())
+        return scanAwakeAVX2(x, y, z, begin, end, refInact, threshInact);
+#endif
+    return scanAwakeScalar(x, y, z, begin, end, refInact, threshInact);
+}
+
+int scanAsleep(const double *x, const double *y, const double *z, int begin, int end,
+               const double *refAct, double threshAct, const double *refInact, double threshInact){
+#ifdef ADXLSIM_AVX2
+    if(ADXLSimCore::hasAVX2())
+        return scanAsleepAVX2(x, y, z, begin, end, refAct, threshAct, refInact, threshInact);
+#endif
+    return scanAsleepScalar(x, y, z, begin, end, refAct, threshAct, refInact, threshInact);
+}
+
+// Sets bits [from, to) of a bitmask
+void setBits(quint64 *mask, int from, int to, bool value){
+    while(from < to){
+        const int bit = from & 63;
+        const int n = qMin(64 - bit, to - from);
+        const quint64 bits = ((n == 64) ? ~quint64(0) : ((quint64(1) << n) - 1)) << bit;
+        if(value)
+            mask[from >> 6] |= bits;
+        else
+            mask[from >> 6] &= ~bits;
+        from += n;
+    }
+}
+}
+
+ADXLSimCore::ADXLSimCore(double threshAct, double threshInact, int timeAct, int timeInact){
     reset();
     this->threshAct = threshAct;
     this->threshInact = threshInact;
@@ -8,12 +121,11 @@ ADXLSim2::ADXLSim2(double threshAct, double threshInact, int timeAct, int timeIn
     this->timeInact = timeInact;
 }
 
-
 /**
- * @brief ADXLSim::next Performs one cycle of the algorithm, taking one sample from the
+ * @brief ADXLSimCore::next Performs one cycle of the algorithm, taking one sample from the
  * signal source.
  */
-void ADXLSim2::next(double X, double Y, double Z){
+void ADXLSimCore::next(double X, double Y, double Z){
     /*
      * Assuming operation in loop mode, so the ADXL is only either awake or not awake.
      *
@@ -82,11 +194,58 @@ void ADXLSim2::next(double X, double Y, double Z){
     }
 }
 
-bool ADXLSim2::isActive(){
-    return awake;
+/**
+ * @brief ADXLSimCore::run Feeds a run of samples, leaving the simulator in the same state as calling next() for each
+ * of them would
+ * @param x, y, z Contiguous samples of each axis
+ * @param count Number of samples
+ * @param activeMask Receives whether the ADXL is awake after each sample: bit i%64 of word i/64 for sample i.
+ * Must have room for (count + 63)/64 words.
+ */
+void ADXLSimCore::run(const double *x, const double *y, const double *z, int count, quint64 *activeMask){
+    int i = 0;
+    while(i < count){
+        // Busy stretches move the references at almost every sample, so the next one is checked before scanning ahead
+        if(awake && maxDelta(x[i], y[i], z[i], refInact) < threshInact){
+            // Quiet samples only count towards going to sleep. Skip to the next loud one, or to the one that completes
+            // [timeInact] quiet samples.
+            const int toSleep = qMax(1, timeInact - countInact);
+            const int end = (count - i > toSleep) ? i + toSleep : count;
+            const int loud = scanAwake(x, y, z, i, end, refInact, threshInact);
+            const int quiet = loud - i;
+            if(quiet == toSleep){
+                setBits(activeMask, i, loud - 1, true);
+                setBits(activeMask, loud - 1, loud, false);
+                awake = false;
+                resetRefActive = true;
+                countInact = 0;
+                i = loud;
+                continue;
+            }
+            countInact += quiet;
+            setBits(activeMask, i, loud, true);
+            i = loud;
+        }
+        else if(!awake && !resetRefActive && !(maxDelta(x[i], y[i], z[i], refAct) > threshAct) &&
+                !(maxDelta(x[i], y[i], z[i], refInact) >= threshInact)){
+            // Asleep, samples below both thresholds only clear the active count
+            const int event = scanAsleep(x, y, z, i, count, refAct, threshAct, refInact, threshInact);
+            if(event > i){
+                countAct = 0;
+                setBits(activeMask, i, event, false);
+                i = event;
+            }
+        }
+        if(i == count)
+            break;
+        // This sample moves a reference or changes the state
+        next(x[i], y[i], z[i]);
+        setBits(activeMask, i, i + 1, awake);
+        ++i;
+    }
 }
 
-void ADXLSim2::reset(){
+void ADXLSimCore::reset(){
     awake = false;
     countAct = 0;
     countInact = 0;
@@ -94,3 +253,29 @@ void ADXLSim2::reset(){
     std::fill_n(refAct, 3, 0);
     std::fill_n(refInact, 3, 0);
 }
+
+// True if run() uses AVX2 on this CPU
+bool ADXLSimCore::hasAVX2(){
+#ifdef ADXLSIM_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+ADXLSim2::ADXLSim2(double threshAct, double threshInact, int timeAct, int timeInact, QObject *parent):QObject(parent),
+    core(threshAct, threshInact, timeAct, timeInact){
+}
+
+void ADXLSim2::next(double X, double Y, double Z){
+    core.next(X, Y, Z);
+}
+
+bool ADXLSim2::isActive(){
+    return core.isActive();
+}
+
+void ADXLSim2::reset(){
+    core.reset();
+}
@@ -2,20 +2,31 @@
 #define ADXLSIM2_H
 
 #include <QObject>
+#include <QtGlobal>
+
+enum AccelCh{ACCEL_X=0, ACCEL_Y=1, ACCEL_Z=2};
 
 /**
- * @brief The ADXLSim2 class: Basically the same in operation as ADXLSim, but more flexible, and operates in units of g, rather than raw binary values.
+ * @brief The ADXLSimCore class is the ADXL activity/inactivity state machine as a plain value type, without any
+ * QObject overhead, so it can be copied, kept on the stack and run from any thread.
+ *
+ * Samples can be fed one at a time with next(), or many at once with run(). run() gives exactly the same states as
+ * calling next() for every sample, but does most of its work in bulk: runs of samples that leave the state machine
+ * where it is (samples below both thresholds while asleep, quiet samples while awake) are found with SIMD compares
+ * (AVX2 where the CPU has it) and skipped in one go. Only the samples that change a reference or the state are
+ * stepped through one by one.
  */
-enum AccelCh{ACCEL_X=0, ACCEL_Y=1, ACCEL_Z=2};
-class ADXLSim2 : public QObject
+class ADXLSimCore
 {
-    Q_OBJECT
 public:
-    explicit ADXLSim2(double threshAct, double threshInact, int timeAct, int timeInact, QObject *parent = nullptr);
+    ADXLSimCore(double threshAct = 0, double threshInact = 0, int timeAct = 1, int timeInact = 1);
     void next(double X, double Y, double Z);
-    bool isActive();
+    void run(const double *x, const double *y, const double *z, int count, quint64 *activeMask);
+    bool isActive() const { return awake; }
     void reset();
 
+    static bool hasAVX2();
+
 private:
     bool awake;
     double refAct[3];       // Store the reference points for each axis to have a baseline for comparison
@@ -30,6 +41,23 @@ private:
     double threshInact;
     int timeAct;
     int timeInact;
+};
+
+/**
+ * @brief The ADXLSim2 class: Basically the same in operation as ADXLSim, but more flexible, and operates in units of g, rather than raw binary values.
+ * It wraps an ADXLSimCore; use that directly where a QObject is not needed.
+ */
+class ADXLSim2 : public QObject
+{
+    Q_OBJECT
+public:
+    explicit ADXLSim2(double threshAct, double threshInact, int timeAct, int timeInact, QObject *parent = nullptr);
+    void next(double X, double Y, double Z);
+    bool isActive();
+    void reset();
+
+private:
+    ADXLSimCore core;
 
 signals:
 
@@ -0,0 +1,75 @@
+#include "adxlsweep.h"
+
+ADXLSweep::ADXLSweep(const SimulationInput &input) : ParameterSweep(input)
+{
+}
+
+/**
+ * @brief ADXLSweep::parameters By default, the thresholds are swept around the current ones, and the rest are kept
+ */
+QList<SweepParameter> ADXLSweep::parameters(const QVector<double> &current) const{
+    QList<SweepParameter> list;
+    list << SweepParameter{"Active Threshold (g)", 0, 99.99, 4,
+                           qMax(0.0, current.at(ThreshAct) - 0.25), current.at(ThreshAct) + 0.25, 0.05};
+    list << SweepParameter{"Inactive Threshold (g)", 0, 99.99, 4,
+                           qMax(0.0, current.at(ThreshInact) - 0.25), current.at(ThreshInact) + 0.25, 0.05};
+    list << SweepParameter{"Active Time", 0, 255, 0, current.at(TimeAct), current.at(TimeAct), 1};
+    list << SweepParameter{"Inactive Time", 0, 255, 0, current.at(TimeInact), current.at(TimeInact), 1};
+    list << SweepParameter{"Downsample", 1, 100, 0, current.at(DownSample), current.at(DownSample), 1};
+    return list;
+}
+
+bool ADXLSweep::prepareData(const QVector<QVector<double>> &values){
+    samples.clear();
+    TimeSeries *data = input.data;
+    const ColumnHandle accel[3] = {data->handle(Channel::AccelX), data->handle(Channel::AccelY), data->handle(Channel::AccelZ)};
+    if(!accel[ACCEL_X].isValid() || !accel[ACCEL_Y].isValid() || !accel[ACCEL_Z].isValid()){
+        errorString = "ADXL Simulator requires acceleration data, e.g. columns \"X\", \"Y\", and \"Z\"";
+        return false;
+    }
+    for(double value: values.at(DownSample)){
+        const int downSample = int(value);
+        if(downSample < 1 || samples.contains(downSample))
+            continue;
+        Samples &s = samples[downSample];
+        const int count = stats.fedSamples(downSample);
+        QVector<double> *axes[3] = {&s.x, &s.y, &s.z};
+        for(int axis=0; axis<3; axis++){
+            axes[axis]->resize(count);
+            readFed(accel[axis].data(), downSample, 0, count, axes[axis]->data());
+        }
+    }
+    return true;
+}
+
+ActivityCounts ADXLSweep::run(const QVector<double> &config) const{
+    const int downSample = int(config.at(DownSample));
+    const Samples &s = samples.find(downSample).value();
+    const int count = s.x.size();
+
+    ADXLSimCore adxl(config.at(ThreshAct), config.at(ThreshInact), int(config.at(TimeAct)), int(config.at(TimeInact)));
+    QVector<quint64> mask((count + 63)/64 + 1, 0);
+    adxl.run(s.x.constData(), s.y.constData(), s.z.constData(), count, mask.data());
+    return stats.count(mask.constData(), downSample);
+}
+
+/**
+ * @brief ADXLSweep::simulate Steps the ADXL through the fed samples one at a time, as the ADXL view does in wakeup mode
+ */
+ActivityTimeline ADXLSweep::simulate(const QVector<double> &config) const{
+    const int downSample = int(config.at(DownSample));
+    const Samples &s = samples.find(downSample).value();
+    ActivityTimeline timeline;
+    timeline.reset(simulatedSamples(), downSample, downSample);
+    TimelineBuilder builder(&timeline, downSample);
+
+    ADXLSimCore adxl(config.at(ThreshAct), config.at(ThreshInact), int(config.at(TimeAct)), int(config.at(TimeInact)));
+    for(int i=0; i<s.x.size(); i++){
+        const bool wasActive = adxl.isActive();
+        adxl.next(s.x.at(i), s.y.at(i), s.z.at(i));
+        if(adxl.isActive() != wasActive)
+            builder.stateChanged(i, adxl.isActive());
+    }
+    builder.finish();
+    return timeline;
+}
@@ -0,0 +1,41 @@
+#ifndef ADXLSWEEP_H
+#define ADXLSWEEP_H
+
+#include <QMap>
+#include <QVector>
+#include "adxlsim.h"
+#include "parametersweep.h"
+
+/**
+ * @brief The ADXLSweep class runs the ADXL simulator over the same data with many configurations, with fixed
+ * (non-wakeup mode) downsampling.
+ *
+ * The acceleration channels are decoded once for every downsample factor. Each configuration then feeds them to an
+ * ADXLSimCore in one go, and is scored from the active regions of the result.
+ */
+class ADXLSweep : public ParameterSweep
+{
+public:
+    // Order of the parameters in a configuration
+    enum Parameter { ThreshAct, ThreshInact, TimeAct, TimeInact, DownSample };
+
+    explicit ADXLSweep(const SimulationInput &input);
+    QList<SweepParameter> parameters(const QVector<double> &current) const override;
+    ActivityCounts run(const QVector<double> &config) const override;
+    ActivityTimeline simulate(const QVector<double> &config) const override;
+
+protected:
+    bool prepareData(const QVector<QVector<double>> &values) override;
+
+private:
+    // Every [downSample]th sample of the acceleration channels, as fed to the ADXL
+    struct Samples{
+        QVector<double> x;
+        QVector<double> y;
+        QVector<double> z;
+    };
+
+    QMap<int, Samples> samples;
+};
+
+#endif // ADXLSWEEP_H
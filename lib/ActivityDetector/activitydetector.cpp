@@ -1,5 +1,56 @@
 #include "activitydetector.h"
 
+StateSink::~StateSink()
+{
+}
+
 ActivityDetector::ActivityDetector(QObject *parent) : QObject(parent)
 {
 }
+
+QStringList ActivityDetector::requiredColumns(){
+    return QStringList();
+}
+
+QList<Channel::Role> ActivityDetector::requiredChannels(){
+    return QList<Channel::Role>();
+}
+
+// Only called for detectors that require channels, which must override it
+bool ActivityDetector::nextChannels(const qreal *values){
+    Q_UNUSED(values)
+    return false;
+}
+
+/**
+ * @brief ActivityDetector::process Adapts detectors written against next() and nextChannels(), by stepping them
+ * through the block one sample at a time and comparing isActive() before and after each sample
+ */
+bool ActivityDetector::process(const ChannelBlock &block, StateSink &sink){
+    const bool byChannel = !requiredChannels().isEmpty();
+    QVector<qreal> channelValues(block.values.size());
+    bool active = (block.first > 0) && isActive();
+    for(int i=0; i<block.count; ++i){
+        bool nextResult;
+        if(byChannel){
+            for(int c=0; c<block.values.size(); ++c){
+                channelValues[c] = block.values.at(c)[i];
+            }
+            nextResult = nextChannels(channelValues.constData());
+        }
+        else{
+            QMap<QString, qreal> sample;
+            for(int c=0; c<block.values.size(); ++c){
+                sample.insert(block.names.at(c), block.values.at(c)[i]);
+            }
+            nextResult = next(sample);
+        }
+        if(!nextResult)
+            return false;
+        if(isActive() != active){
+            active = !active;
+            sink.stateChanged(block.first + i, active);
+        }
+    }
+    return true;
+}
@@ -2,8 +2,44 @@
 #define ACTIVITYDETECTOR_H
 
 #include <QObject>
+#include <QList>
+#include <QStringList>
+#include <QVector>
+#include "channel.h"
 #include "timeseries.h"
 
+// Samples handed to ActivityDetector::process() at a time
+#define ACTIVITY_BLOCK_SAMPLES 4096
+
+/**
+ * @brief The ChannelBlock struct is a run of consecutive samples fed to an activity detector, with one contiguous
+ * array of values per input. The inputs are the detector's requiredChannels(), in order, or, for detectors stepped
+ * with next(), the columns it reads.
+ */
+struct ChannelBlock
+{
+    int first;                      // Index of the first sample, counted in fed samples since the start of the run
+    int count;                      // Samples in the block
+    QVector<const qreal *> values;  // count values per input
+    QStringList names;              // Column name of each input, for next()
+};
+
+/**
+ * @brief The StateSink class receives the state changes of an activity detector. The state before the first sample of
+ * a run is inactive, so changes alternate between active and inactive.
+ */
+class StateSink
+{
+public:
+    virtual ~StateSink();
+
+    /**
+     * @brief stateChanged Called when the detector turns active or inactive
+     * @param sample Fed sample from which the new state holds, counted as in ChannelBlock::first
+     */
+    virtual void stateChanged(int sample, bool active) = 0;
+};
+
 /**
  * @brief The ActivityDetector class provides an interface for implementing your own activity detectors.
  * Activity detectors are designed to handle streaming data and thus must be able to keep their own internal state.
@@ -41,6 +77,36 @@ public:
      */
     virtual QString getErrorString() = 0;
 
+    /**
+     * @brief requiredColumns Returns the names of the data columns that next() reads. Only these columns are passed
+     * in each sample, so columns that were left out when the data was loaded are only read if they are needed.
+     * @return The column names, or an empty list (the default) to be passed every column
+     */
+    virtual QStringList requiredColumns();
+
+    /**
+     * @brief requiredChannels Returns the channels that nextChannels() reads. Detectors that read channels are bound
+     * to the matching columns once per run, whatever the data file calls them, and are then stepped with
+     * nextChannels() rather than next().
+     * @return The channels, or an empty list (the default) to be stepped with next()
+     */
+    virtual QList<Channel::Role> requiredChannels();
+
+    /**
+     * @brief nextChannels Runs an additional iteration of the activity detector.
+     * @param values One value per channel of requiredChannels(), in the same order
+     * @return true if successful, false if something goes wrong. Call getErrorString() for more details.
+     */
+    virtual bool nextChannels(const qreal *values);
+
+    /**
+     * @brief process Runs the activity detector over a block of samples, and reports its state changes to sink.
+     * Blocks of a run are passed in order. The default steps next() or nextChannels() once per sample; detectors can
+     * override it to work on whole blocks.
+     * @return true if successful, false if something goes wrong. Call getErrorString() for more details.
+     */
+    virtual bool process(const ChannelBlock &block, StateSink &sink);
+
 signals:
 
 public slots:
@@ -0,0 +1,248 @@
+#include "activitystats.h"
+#include <algorithm>
+
+namespace {
+// First index in [begin, end) whose time is not below [value] (or above it, if [after]), or end. Times are sorted.
+int searchTime(const TimeSeriesColumn *time, int begin, int end, double value, bool after){
+    while(begin < end){
+        const int mid = begin + (end - begin)/2;
+        const double t = time->at(mid);
+        if(after ? !(t > value) : (t < value))
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+    return begin;
+}
+
+// First index in [begin, end) whose video frame is at least [frame], or end
+int searchFrame(const SimulationInput &input, const TimeSeriesColumn *time, int begin, int end, int frame){
+    while(begin < end){
+        const int mid = begin + (end - begin)/2;
+        if(input.frameOf(time->at(mid)) < frame)
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+    return begin;
+}
+
+}
+
+ActivityStats::ActivityStats()
+{
+    input.data = nullptr;
+    annotatedSamples = 0;
+    samplerate = 0;
+    loopEnd = 0;
+    statFirst = 0;
+    statEnd = 0;
+}
+
+/**
+ * @brief ActivityStats::prepare Finds the statistics window and the samples of the annotated events. Must be called
+ * from the thread that owns the data.
+ * @return false if there is not enough data to simulate
+ */
+bool ActivityStats::prepare(const SimulationInput &input){
+    this->input = input;
+    events.clear();
+    annotated.clear();
+    annotatedSamples = 0;
+    loopEnd = 0;
+    statFirst = 0;
+    statEnd = 0;
+    errorString.clear();
+
+    TimeSeries *data = input.data;
+    if(data->numColumns() == 0 || data->numRows() < 2){
+        errorString = "There is not enough data to simulate.";
+        return false;
+    }
+    const TimeSeriesColumn *time = data->timeColumnData();
+    samplerate = data->timeIndex()->sampleRate();
+
+    // The simulator views step through all samples but the last
+    loopEnd = data->numRows() - 1;
+    statFirst = searchTime(time, 0, loopEnd, input.statStart, false);
+    statEnd = searchTime(time, statFirst, loopEnd, input.statEnd, true);
+
+    if(input.frameInterval <= 0)
+        return true;
+    // Events that overlap the statistics window, as in the simulator views
+    const int frameStatStart = input.frameOf(input.statStart);
+    const int frameStatEnd = input.frameOf(input.statEnd);
+    const TimeIndex *timeIndex = data->timeIndex();
+    const double frameSeconds = input.frameInterval/1000.0;
+    for(const QPair<int, int> &frames: input.events){
+        if(!(frames.second > frameStatStart && frames.first <= frameStatEnd))
+            continue;
+        Event event;
+        event.startFrame = frames.first;
+        event.endFrame = frames.second;
+        event.first = searchFrame(input, time, statFirst, statEnd, frames.first);
+        event.end = searchFrame(input, time, event.first, statEnd, frames.second);
+        event.required = 0.5*(frames.second - frames.first);
+        event.frames.resize(event.end - event.first);
+        event.coverage.resize(event.end - event.first + 1);
+        event.coverage[0] = 0;
+        for(int i=event.first; i<event.end; i++){
+            event.frames[i - event.first] = timeIndex->samplePeriod(i)/frameSeconds;
+            event.coverage[i - event.first + 1] = event.coverage.at(i - event.first) + event.frames.at(i - event.first);
+        }
+        if(event.end > event.first)
+            annotated.append(qMakePair(event.first, event.end));
+        events.append(event);
+    }
+
+    // Merge the annotated ranges, so that looking up a region is a single search
+    std::sort(annotated.begin(), annotated.end());
+    int merged = 0;
+    for(int i=0; i<annotated.size(); i++){
+        if(merged > 0 && annotated.at(i).first <= annotated.at(merged - 1).second)
+            annotated[merged - 1].second = qMax(annotated.at(merged - 1).second, annotated.at(i).second);
+        else
+            annotated[merged++] = annotated.at(i);
+    }
+    annotated.resize(merged);
+    for(const QPair<int, int> &range: annotated){
+        annotatedSamples += range.second - range.first;
+    }
+    return true;
+}
+
+/**
+ * @brief ActivityStats::fedSamples Number of samples fed to a detector that takes every [downSample]th sample
+ */
+int ActivityStats::fedSamples(int downSample) const{
+    return (loopEnd > 0) ? (loopEnd - 1)/downSample + 1 : 0;
+}
+
+// True if any of the samples [first, end) is in an annotated event
+bool ActivityStats::isAnnotated(int first, int end) const{
+    if(first >= end)
+        return false;
+    // First range that ends after [first]
+    auto range = std::upper_bound(annotated.constBegin(), annotated.constEnd(), first,
+                                  [](int sample, const QPair<int, int> &r){ return sample < r.second; });
+    return range != annotated.constEnd() && range->first < end;
+}
+
+/**
+ * @brief ActivityStats::count Scores one run of a detector
+ * @param activeMask Whether the detector is active after each fed sample, fedSamples(downSample) bits in all
+ */
+ActivityCounts ActivityStats::count(const quint64 *activeMask, int downSample) const{
+    return count(ActivityTimeline::fromMask(activeMask, fedSamples(downSample), downSample, loopEnd));
+}
+
+/**
+ * @brief ActivityStats::count Scores one run of a detector
+ * @param timeline Where the detector is active, over all samples but the last
+ * @param coverage If given, set to the frames of each event covered by active samples, in the order of the events
+ * @param regions If given, set to the length in seconds of each active region that ends within the window, and
+ * whether it saw an annotated event
+ */
+ActivityCounts ActivityStats::count(const ActivityTimeline &timeline, QVector<double> *coverage,
+                                    QList<QPair<double, bool>> *regions) const{
+    ActivityCounts counts;
+    counts.samples = timeline.fedSamples(statFirst, statEnd);
+    counts.activeSamples = timeline.activeFedSamples(statFirst, statEnd);
+    counts.wakeups = timeline.wakeups(statFirst, statEnd);
+    counts.coveredEvents = 0;
+    counts.falsePositiveEvents = 0;
+
+    // Sweep the active intervals and the annotated ranges together, adding up their overlap within the window
+    int activeSamples = 0;
+    int annotatedActive = 0;
+    int range = 0;
+    for(int i=timeline.find(statFirst); i<timeline.size() && timeline.at(i).start < statEnd; ++i){
+        const int first = qMax(timeline.at(i).start, statFirst);
+        const int end = qMin(timeline.at(i).end, statEnd);
+        activeSamples += end - first;
+        while(range < annotated.size() && annotated.at(range).second <= first){
+            ++range;
+        }
+        for(int r=range; r<annotated.size() && annotated.at(r).first < end; ++r){
+            annotatedActive += qMin(end, annotated.at(r).second) - qMax(first, annotated.at(r).first);
+        }
+    }
+    counts.falsePositiveSamples = activeSamples - annotatedActive;
+    counts.falseNegativeSamples = annotatedSamples - annotatedActive;
+    counts.correctSamples = (statEnd - statFirst) - counts.falsePositiveSamples - counts.falseNegativeSamples;
+
+    // Active regions that end within the window. The one still open at the end of the data never does.
+    if(regions)
+        regions->clear();
+    for(int i=timeline.find(statFirst - 1); i<timeline.size() && timeline.at(i).end < statEnd; ++i){
+        if(timeline.isOpen(i))
+            break;
+        const ActivityTimeline::Interval &region = timeline.at(i);
+        // As in the simulator views, an annotation on the sample that wakes the detector up does not count
+        const bool correct = isAnnotated(qMax(region.start + 1, statFirst), region.end);
+        if(!correct)
+            ++counts.falsePositiveEvents;
+        if(regions)
+            regions->append(qMakePair((samplerate > 0) ? ((region.end - region.start)/samplerate) : 0, correct));
+    }
+
+    if(coverage)
+        coverage->resize(events.size());
+    for(int e=0; e<events.size(); e++){
+        const double frames = covered(events.at(e), timeline);
+        if(frames >= events.at(e).required)
+            ++counts.coveredEvents;
+        if(coverage)
+            (*coverage)[e] = frames;
+    }
+    return counts;
+}
+
+// Frames of the event covered by active samples
+double ActivityStats::covered(const Event &event, const ActivityTimeline &timeline) const{
+    const int begin = timeline.find(event.first);
+    double frames = 0;
+    for(int i=begin; i<timeline.size() && timeline.at(i).start < event.end; ++i){
+        frames += event.coverage.at(qMin(timeline.at(i).end, event.end) - event.first) -
+                event.coverage.at(qMax(timeline.at(i).start, event.first) - event.first);
+    }
+    // Too close to call from the prefix sums: add up the samples one by one, in the same order as the views
+    if(qAbs(frames - event.required) <= ACTIVITY_COVERAGE_TIE*event.required){
+        frames = 0;
+        for(int i=begin; i<timeline.size() && timeline.at(i).start < event.end; ++i){
+            for(int j=qMax(timeline.at(i).start, event.first); j<qMin(timeline.at(i).end, event.end); j++){
+                frames += event.frames.at(j - event.first);
+            }
+        }
+    }
+    return frames;
+}
+
+int ActivityStats::numEvents() const{
+    return events.size();
+}
+
+/**
+ * @brief ActivityStats::writeCoverage Writes the coverage of each event as CSV: its start and length in data time, and
+ * the percentage of its frames that active samples cover
+ * @param coverage Frames covered of each event, from count()
+ */
+void ActivityStats::writeCoverage(QIODevice *device, const QVector<double> &coverage) const{
+    device->write("Start,Length,Coverage Percent\n");
+    for(int e=0; e<events.size() && e<coverage.size(); e++){
+        const Event &event = events.at(e);
+        double pathStartTime = input.timeOf(event.startFrame);
+        double pathLength = input.timeOf(event.endFrame) - pathStartTime;
+        // Cap value to 100 if it exceeds it.
+        double coveragePercent = qMin(100.0, pathLength>0?(100*coverage.at(e)/(event.endFrame-event.startFrame)):0);
+
+        device->write(QString("%1,%2,%3\n")
+                      .arg(pathStartTime)
+                      .arg(pathLength)
+                      .arg(coveragePercent).toLatin1());
+    }
+}
+
+QString ActivityStats::getErrorString() const{
+    return errorString;
+}
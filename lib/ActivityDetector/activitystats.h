@@ -0,0 +1,115 @@
+#ifndef ACTIVITYSTATS_H
+#define ACTIVITYSTATS_H
+
+#include <QIODevice>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include "timeseries.h"
+#include "activitytimeline.h"
+
+// Relative difference between an event's coverage and the coverage it needs below which rounding could decide it
+#define ACTIVITY_COVERAGE_TIE 1e-9
+
+/**
+ * @brief The SimulationInput struct is the data and annotations a simulation is scored against
+ */
+struct SimulationInput
+{
+    TimeSeries *data;
+    // Statistics window, in data time
+    double statStart;
+    double statEnd;
+    // Annotated events as [start, end) in video frames
+    QList<QPair<int, int>> events;
+    // Maps data time to video frames, as the simulator views do
+    double deltaTVD;
+    double rateMultiplier;
+    double frameInterval;
+
+    int frameOf(double time) const { return int((time - deltaTVD)/rateMultiplier*1000.0/frameInterval); }
+    double timeOf(int frame) const { return ((frame*frameInterval/1000.0)*rateMultiplier) + deltaTVD; }
+};
+
+/**
+ * @brief The EnergyModel struct is the energy model of the simulator views. Energies are in μAh.
+ */
+struct EnergyModel
+{
+    double standby;     // Per sample while inactive
+    double wakeup;      // Per transition to active
+    double perSample;   // Per sample while active
+
+    // Total energy in mAh
+    double energy(int samples, int activeSamples, int wakeups) const {
+        return (standby*(samples - activeSamples) + wakeup*wakeups + perSample*activeSamples)/1000.0;
+    }
+};
+
+/**
+ * @brief The ActivityCounts struct holds the statistics of one simulation over the statistics window
+ */
+struct ActivityCounts
+{
+    int samples;                // Samples fed to the detector
+    int activeSamples;
+    int wakeups;
+    int coveredEvents;          // Annotated events at least half covered by active samples
+    int falsePositiveEvents;    // Active regions that end without having seen an annotated event
+    // Every sample of the window, fed or not, against the annotations
+    int correctSamples;         // Active and annotated, or neither
+    int falsePositiveSamples;   // Active but not annotated
+    int falseNegativeSamples;   // Annotated but not active
+};
+
+/**
+ * @brief The ActivityStats class scores the output of a detector against the annotations, for the simulator views and
+ * the parameter sweeps alike. prepare() finds the statistics window and turns the annotated events into sorted sample
+ * ranges once; count() then sweeps the active intervals of a run and the annotated ranges together, so that it takes
+ * time in the number of intervals and events rather than of samples times events. count() only reads what prepare()
+ * built, so it can be called from several threads at once.
+ *
+ * A run is passed as an ActivityTimeline, or as a bitmask with one bit per fed sample of a detector fed every
+ * [downSample]th sample (see ADXLSimCore::run).
+ */
+class ActivityStats
+{
+public:
+    ActivityStats();
+    bool prepare(const SimulationInput &input);
+    int fedSamples(int downSample) const;
+    ActivityCounts count(const quint64 *activeMask, int downSample) const;
+    ActivityCounts count(const ActivityTimeline &timeline, QVector<double> *coverage = nullptr,
+                         QList<QPair<double, bool>> *regions = nullptr) const;
+    int numEvents() const;
+    void writeCoverage(QIODevice *device, const QVector<double> &coverage) const;
+    QString getErrorString() const;
+
+private:
+    // An annotated event, as the samples [first, end) of the statistics window
+    struct Event{
+        int startFrame;             // As annotated
+        int endFrame;
+        int first;
+        int end;
+        double required;            // Frames to cover
+        QVector<double> frames;     // Frames covered by each sample
+        QVector<double> coverage;   // Frames covered by the samples before each one, from first
+    };
+
+    bool isAnnotated(int first, int end) const;
+    double covered(const Event &event, const ActivityTimeline &timeline) const;
+
+    SimulationInput input;
+    QVector<Event> events;
+    QVector<QPair<int, int>> annotated; // Merged sample ranges of all events, in order
+    int annotatedSamples;               // Samples in any of them
+    double samplerate;
+    int loopEnd;                        // Samples stepped through by the simulator views
+    int statFirst;                      // Statistics window in samples
+    int statEnd;
+    QString errorString;
+};
+
+#endif // ACTIVITYSTATS_H
@@ -0,0 +1,180 @@
+#include "activitytimeline.h"
+
+ActivityTimeline::ActivityTimeline()
+{
+    numSamples = 0;
+    strideActive = 1;
+    strideIdle = 1;
+}
+
+/**
+ * @brief ActivityTimeline::reset Empties the timeline
+ * @param length Samples the timeline covers
+ * @param activeStride, idleStride The detector is fed every [stride]th sample while active, or inactive
+ */
+void ActivityTimeline::reset(int length, int activeStride, int idleStride){
+    list.clear();
+    numSamples = length;
+    strideActive = activeStride;
+    strideIdle = idleStride;
+}
+
+/**
+ * @brief ActivityTimeline::append Adds an active interval after the last one. Empty intervals are dropped.
+ */
+void ActivityTimeline::append(int start, int end){
+    end = qMin(end, numSamples);
+    if(end <= start)
+        return;
+    Interval interval;
+    interval.start = start;
+    interval.end = end;
+    list.append(interval);
+}
+
+/**
+ * @brief ActivityTimeline::fromMask Builds the timeline of a detector fed every [downSample]th sample, from a bitmask of
+ * its state after each fed sample (see ADXLSimCore::run)
+ */
+ActivityTimeline ActivityTimeline::fromMask(const quint64 *activeMask, int fedSamples, int downSample, int length){
+    ActivityTimeline timeline;
+    timeline.reset(length, downSample, downSample);
+    bool active = false;
+    int start = 0;
+    for(int fed=0; fed<fedSamples; ){
+        // Skip whole words without changes
+        const quint64 word = activeMask[fed/64];
+        if(fed%64 == 0 && word == (active ? ~quint64(0) : 0)){
+            fed += 64;
+            continue;
+        }
+        if(bool((word >> (fed%64)) & 1) != active){
+            active = !active;
+            if(active)
+                start = fed*downSample;
+            else
+                timeline.append(start, fed*downSample);
+        }
+        ++fed;
+    }
+    if(active)
+        timeline.append(start, length);
+    return timeline;
+}
+
+/**
+ * @brief ActivityTimeline::find Index of the first interval that ends after the sample, or size() if there is none
+ */
+int ActivityTimeline::find(int sample) const{
+    int begin = 0;
+    int end = list.size();
+    while(begin < end){
+        const int mid = begin + (end - begin)/2;
+        if(list.at(mid).end <= sample)
+            begin = mid + 1;
+        else
+            end = mid;
+    }
+    return begin;
+}
+
+bool ActivityTimeline::isActive(int sample) const{
+    const int i = find(sample);
+    return i < list.size() && list.at(i).start <= sample;
+}
+
+// Whether the detector is active at a time of the data, i.e. after the last sample at or before it
+bool ActivityTimeline::isActiveAt(TimeSeries *data, double time) const{
+    const int sample = data->timeIndex()->indexOfLEQ(data->timeColumnData(), time);
+    return sample >= 0 && isActive(sample);
+}
+
+// First sample of the timeline at or after a time of the data, or length()
+int ActivityTimeline::sampleAtOrAfter(TimeSeries *data, double time) const{
+    const TimeSeriesColumn *timeColumn = data->timeColumnData();
+    int sample = data->timeIndex()->indexOfLEQ(timeColumn, time);
+    while(sample >= 0 && !(timeColumn->at(sample) < time)){
+        --sample;
+    }
+    return qMin(sample + 1, numSamples);
+}
+
+// First sample of the timeline after a time of the data, or length()
+int ActivityTimeline::sampleAfter(TimeSeries *data, double time) const{
+    const int sample = data->timeIndex()->indexOfLEQ(data->timeColumnData(), time);
+    return qMin(sample + 1, numSamples);
+}
+
+/**
+ * @brief ActivityTimeline::fedSamples Number of the samples [first, end) that are fed to the detector
+ */
+int ActivityTimeline::fedSamples(int first, int end) const{
+    if(strideActive == strideIdle)
+        return multiples(first, end, strideIdle);
+    // Samples right after an active one, up to and including the first inactive one, are fed at the active rate
+    int fed = multiples(first, end, strideIdle);
+    for(int i=find(first - 1); i<list.size() && list.at(i).start + 1 < end; ++i){
+        const int from = qMax(list.at(i).start + 1, first);
+        const int to = qMin(list.at(i).end + 1, end);
+        fed += multiples(from, to, strideActive) - multiples(from, to, strideIdle);
+    }
+    return fed;
+}
+
+/**
+ * @brief ActivityTimeline::activeFedSamples Number of the samples [first, end) that are fed to the detector while it is
+ * active
+ */
+int ActivityTimeline::activeFedSamples(int first, int end) const{
+    int fed = 0;
+    for(int i=find(first); i<list.size() && list.at(i).start < end; ++i){
+        const Interval &interval = list.at(i);
+        // The sample that woke the detector, then the ones fed at the active rate
+        if(interval.start >= first)
+            ++fed;
+        fed += multiples(qMax(interval.start + 1, first), qMin(interval.end, end), strideActive);
+    }
+    return fed;
+}
+
+/**
+ * @brief ActivityTimeline::wakeups Number of intervals that start within the samples [first, end)
+ */
+int ActivityTimeline::wakeups(int first, int end) const{
+    int count = 0;
+    for(int i=find(first); i<list.size() && list.at(i).start < end; ++i){
+        if(list.at(i).start >= first)
+            ++count;
+    }
+    return count;
+}
+
+// Number of multiples of stride in [first, end), for first >= 0
+int ActivityTimeline::multiples(int first, int end, int stride){
+    if(end <= first)
+        return 0;
+    return (end - 1)/stride - (first + stride - 1)/stride + 1;
+}
+
+TimelineBuilder::TimelineBuilder(ActivityTimeline *timeline, int downSample) :
+    timeline(timeline),
+    downSample(downSample),
+    start(-1)
+{
+}
+
+void TimelineBuilder::stateChanged(int sample, bool active){
+    if(active){
+        start = sample*downSample;
+    }
+    else if(start >= 0){
+        timeline->append(start, sample*downSample);
+        start = -1;
+    }
+}
+
+void TimelineBuilder::finish(){
+    if(start >= 0)
+        timeline->append(start, timeline->length());
+    start = -1;
+}
@@ -0,0 +1,76 @@
+#ifndef ACTIVITYTIMELINE_H
+#define ACTIVITYTIMELINE_H
+
+#include <QVector>
+#include "activitydetector.h"
+#include "timeseries.h"
+
+/**
+ * @brief The ActivityTimeline class is the output of a simulation: the stretches of samples over which the detector
+ * is active, as sorted, disjoint [start, end) intervals of sample indices. It takes memory per wakeup rather than per
+ * sample, and statistics, plots and exports work through the intervals rather than through every sample.
+ *
+ * The timeline covers the first length() samples of the data. An interval that is still open at the end of the run
+ * ends at length(). Intervals start at samples that were fed to the detector. The detector is fed every
+ * activeStride()th sample while active and every idleStride()th one while inactive (the two only differ in the ADXL's
+ * wakeup mode), at the rate of the state before the sample.
+ */
+class ActivityTimeline
+{
+public:
+    struct Interval{
+        int start;
+        int end;
+    };
+
+    ActivityTimeline();
+    void reset(int length, int activeStride, int idleStride);
+    void append(int start, int end);
+    static ActivityTimeline fromMask(const quint64 *activeMask, int fedSamples, int downSample, int length);
+
+    int length() const { return numSamples; }
+    int activeStride() const { return strideActive; }
+    int idleStride() const { return strideIdle; }
+    int size() const { return list.size(); }
+    bool isEmpty() const { return list.isEmpty(); }
+    const Interval &at(int i) const { return list.at(i); }
+    const QVector<Interval> &intervals() const { return list; }
+    bool isOpen(int i) const { return list.at(i).end >= numSamples; }
+
+    int find(int sample) const;
+    bool isActive(int sample) const;
+    bool isActiveAt(TimeSeries *data, double time) const;
+    int sampleAtOrAfter(TimeSeries *data, double time) const;
+    int sampleAfter(TimeSeries *data, double time) const;
+
+    int fedSamples(int first, int end) const;
+    int activeFedSamples(int first, int end) const;
+    int wakeups(int first, int end) const;
+
+private:
+    static int multiples(int first, int end, int stride);
+
+    QVector<Interval> list;
+    int numSamples;
+    int strideActive;
+    int strideIdle;
+};
+
+/**
+ * @brief The TimelineBuilder class builds an ActivityTimeline from the state changes of an ActivityDetector that is fed
+ * every [downSample]th sample. Call finish() once the run is over, to close the last interval.
+ */
+class TimelineBuilder : public StateSink
+{
+public:
+    TimelineBuilder(ActivityTimeline *timeline, int downSample);
+    void stateChanged(int sample, bool active) override;
+    void finish();
+
+private:
+    ActivityTimeline *timeline;
+    int downSample;
+    int start;  // Start of the open interval, or -1
+};
+
+#endif // ACTIVITYTIMELINE_H
@@ -0,0 +1,263 @@
+#ifndef DETECTORPIPELINE_H
+#define DETECTORPIPELINE_H
+
+#include <QMap>
+#include <QString>
+#include <QtMath>
+#include "activitydetector.h"
+#include "Iir.h"
+
+/**
+ * Stages of a detector Pipeline. A stage is a plain class with inline members, so that a Pipeline compiles its stages
+ * into a single loop over the samples, without virtual calls. Each kind of stage provides:
+ *   Filter:     bool config(const QMap<QString, qreal> &config, QString &error); qreal filter(int axis, qreal value);
+ *   Reduction:  static qreal reduce(qreal x, qreal y, qreal z);
+ *   Decision:   bool config(const QMap<QString, qreal> &config, QString &error); bool decide(qreal value) const;
+ *   Hysteresis: bool config(const QMap<QString, qreal> &config, QString &error); bool next(bool above);
+ * config() reads the stage's options from the detector configuration, and resets the stage.
+ */
+namespace Stage{
+
+/**
+ * @brief The NoFilter class passes the samples through unchanged
+ */
+class NoFilter
+{
+public:
+    bool config(const QMap<QString, qreal> &config, QString &error){
+        Q_UNUSED(config)
+        Q_UNUSED(error)
+        return true;
+    }
+    qreal filter(int axis, qreal value){
+        Q_UNUSED(axis)
+        return value;
+    }
+};
+
+/**
+ * @brief The HighPass class is a Butterworth high-pass filter of the given order on each axis.
+ * Options: "samplerate" (Hz) and "cutoff" (Hz), which must be above 0 and at most half the sample rate.
+ */
+template<int Order>
+class HighPass
+{
+public:
+    bool config(const QMap<QString, qreal> &config, QString &error){
+        if(!config.contains("samplerate") || !config.contains("cutoff")){
+            error = "The high-pass filter needs a sample rate and a cutoff frequency";
+            return false;
+        }
+        const qreal samplerate = config.value("samplerate");
+        const qreal cutoff = config.value("cutoff");
+        // cutoff frequency must be at most half of the sample rate or Nyquist frequency
+        if(cutoff > (samplerate * 0.5) || cutoff == 0){
+            error = "The cutoff frequency must be above 0 and at most half the sample rate";
+            return false;
+        }
+        for(int axis=0; axis<3; axis++){
+            filters[axis].setup(samplerate, cutoff);
+            filters[axis].reset();
+        }
+        return true;
+    }
+    qreal filter(int axis, qreal value){
+        return filters[axis].filter(value);
+    }
+
+private:
+    Iir::Butterworth::HighPass<Order> filters[3];
+};
+
+/**
+ * @brief The Max class takes the largest of the axes, sign included
+ */
+class Max
+{
+public:
+    static qreal reduce(qreal x, qreal y, qreal z){
+        return qMax(x, qMax(y, z));
+    }
+};
+
+/**
+ * @brief The MaxAbs class takes the largest magnitude of the axes
+ */
+class MaxAbs
+{
+public:
+    static qreal reduce(qreal x, qreal y, qreal z){
+        return qMax(qAbs(x), qMax(qAbs(y), qAbs(z)));
+    }
+};
+
+/**
+ * @brief The Magnitude class takes the length of the vector of the axes
+ */
+class Magnitude
+{
+public:
+    static qreal reduce(qreal x, qreal y, qreal z){
+        return qSqrt(x*x + y*y + z*z);
+    }
+};
+
+/**
+ * @brief The Threshold class decides that a sample is above the threshold when it exceeds it.
+ * Options: "thresh".
+ */
+class Threshold
+{
+public:
+    bool config(const QMap<QString, qreal> &config, QString &error){
+        if(!config.contains("thresh")){
+            error = "No threshold given";
+            return false;
+        }
+        thresh = config.value("thresh");
+        return true;
+    }
+    bool decide(qreal value) const{
+        return value > thresh;
+    }
+
+private:
+    qreal thresh;
+};
+
+/**
+ * @brief The DelayHold class turns active once samples have been above the threshold for longer than the delay time,
+ * and inactive once they have been below it for longer than the hold time:
+ *  1. Defaults to "Inactive"
+ *  2. When samples exceed the threshold for more than the "delay time", state is now "Active"
+ *  3. When a sample does not exceed the threshold, the "hold time" counter begins counting down.
+ *  4. Hold Time counter continues counting down unless threshold is exceeded, which resets timer.
+ *  5. When Hold Time counter reaches zero, state is once again "Inactive"
+ * Options: "samplerate" (Hz), "delaytime" and "holdtime" (s).
+ */
+class DelayHold
+{
+public:
+    bool config(const QMap<QString, qreal> &config, QString &error){
+        if(!config.contains("samplerate") || !config.contains("holdtime") || !config.contains("delaytime")){
+            error = "The delay and hold times need a sample rate, a delay time and a hold time";
+            return false;
+        }
+        const qreal samplerate = config.value("samplerate");
+        holdTimeSet = int(samplerate * config.value("holdtime"));
+        holdTimeCounter = holdTimeSet;
+        delayTimeSet = int(samplerate * config.value("delaytime"));
+        delayTimeCounter = delayTimeSet;
+        active = false;
+        return true;
+    }
+    bool next(bool above){
+        if(above){
+            if(delayTimeCounter == 0)
+                active = true;
+            else
+                delayTimeCounter--;
+            holdTimeCounter = holdTimeSet;
+        }
+        else{
+            if(holdTimeCounter == 0)
+                active = false;
+            else
+                holdTimeCounter--;
+            delayTimeCounter = delayTimeSet;
+        }
+        return active;
+    }
+
+private:
+    int holdTimeSet;
+    int holdTimeCounter;
+    int delayTimeSet;
+    int delayTimeCounter;
+    bool active;
+};
+
+}
+
+/**
+ * @brief The Pipeline class is an activity detector on the three acceleration axes, composed at compile time of a
+ * filter, a reduction of the axes to one value, a decision on that value and a hysteresis on the decisions, e.g.
+ * Pipeline<Stage::HighPass<4>, Stage::MaxAbs, Stage::Threshold, Stage::DelayHold>. See the Stage namespace for what
+ * each stage provides. process() runs all of them in one inlined loop over a block.
+ */
+template<class Filter, class Reduction, class Decision, class Hysteresis>
+class Pipeline : public ActivityDetector
+{
+public:
+    explicit Pipeline(QObject *parent = nullptr) : ActivityDetector(parent), active(false) {}
+
+    bool config(QMap<QString, qreal> config) override{
+        errorString.clear();
+        active = false;
+        return filterStage.config(config, errorString) && decisionStage.config(config, errorString) &&
+                hysteresisStage.config(config, errorString);
+    }
+
+    bool next(QMap<QString, qreal> sample) override{
+        if(!sample.contains("X") || !sample.contains("Y") || !sample.contains("Z")){
+            errorString = "No valid data with labels \"X\", \"Y\", and \"Z\" received";
+            return false;
+        }
+        step(sample.value("X"), sample.value("Y"), sample.value("Z"));
+        return true;
+    }
+
+    bool isActive() override{
+        return active;
+    }
+
+    QString getErrorString() override{
+        return errorString;
+    }
+
+    QStringList requiredColumns() override{
+        return QStringList() << "X" << "Y" << "Z";
+    }
+
+    QList<Channel::Role> requiredChannels() override{
+        return QList<Channel::Role>() << Channel::AccelX << Channel::AccelY << Channel::AccelZ;
+    }
+
+    // values holds the acceleration along X, Y and Z, as listed by requiredChannels()
+    bool nextChannels(const qreal *values) override{
+        step(values[0], values[1], values[2]);
+        return true;
+    }
+
+    // The block holds the acceleration along X, Y and Z, as listed by requiredChannels()
+    bool process(const ChannelBlock &block, StateSink &sink) override{
+        if(block.values.size() != 3){
+            errorString = "Expected blocks of acceleration along X, Y and Z";
+            return false;
+        }
+        const qreal *x = block.values.at(0);
+        const qreal *y = block.values.at(1);
+        const qreal *z = block.values.at(2);
+        for(int i=0; i<block.count; ++i){
+            const bool wasActive = active;
+            step(x[i], y[i], z[i]);
+            if(active != wasActive)
+                sink.stateChanged(block.first + i, active);
+        }
+        return true;
+    }
+
+protected:
+    inline void step(qreal x, qreal y, qreal z){
+        const qreal reduced = Reduction::reduce(filterStage.filter(0, x), filterStage.filter(1, y), filterStage.filter(2, z));
+        active = hysteresisStage.next(decisionStage.decide(reduced));
+    }
+
+    Filter filterStage;
+    Decision decisionStage;
+    Hysteresis hysteresisStage;
+    bool active;
+    QString errorString;
+};
+
+#endif // DETECTORPIPELINE_H
@@ -0,0 +1,71 @@
+#include "frameoccupancy.h"
+#include <algorithm>
+#include <iterator>
+
+FrameOccupancy::FrameOccupancy()
+{
+    prefix.append(0);
+    dirty = 0;
+}
+
+/**
+ * @brief FrameOccupancy::update Brings the index up to date with the paths. Paths that kept their frames cost nothing.
+ */
+void FrameOccupancy::update(const QList<MotionPath *> &paths){
+    QVector<QPair<int, int>> current;
+    for(MotionPath *p: paths){
+        const int start = qMax(0, p->start);
+        if(p->end > start)
+            current.append(qMakePair(start, p->end));
+    }
+    std::sort(current.begin(), current.end());
+
+    QVector<QPair<int, int>> removed;
+    QVector<QPair<int, int>> added;
+    std::set_difference(ranges.constBegin(), ranges.constEnd(), current.constBegin(), current.constEnd(), std::back_inserter(removed));
+    std::set_difference(current.constBegin(), current.constEnd(), ranges.constBegin(), ranges.constEnd(), std::back_inserter(added));
+    for(const QPair<int, int> &range: removed){
+        cover(range.first, range.second, -1);
+    }
+    for(const QPair<int, int> &range: added){
+        cover(range.first, range.second, 1);
+    }
+    ranges = current;
+
+    for(int frame=dirty; frame<depth.size(); ++frame){
+        prefix[frame + 1] = prefix.at(frame) + ((depth.at(frame) > 0) ? 1 : 0);
+    }
+    dirty = depth.size();
+}
+
+// Adds delta to the number of paths over the frames [start, end)
+void FrameOccupancy::cover(int start, int end, int delta){
+    if(end > depth.size()){
+        dirty = qMin(dirty, depth.size());
+        depth.resize(end);
+        prefix.resize(end + 1);
+    }
+    for(int frame=start; frame<end; ++frame){
+        depth[frame] += delta;
+    }
+    dirty = qMin(dirty, start);
+}
+
+/**
+ * @brief FrameOccupancy::annotatedFrames Number of the frames [first, end) that any path annotates
+ */
+int FrameOccupancy::annotatedFrames(int first, int end) const{
+    first = qBound(0, first, depth.size());
+    end = qBound(first, end, depth.size());
+    return prefix.at(end) - prefix.at(first);
+}
+
+/**
+ * @brief FrameOccupancy::annotatedPercent Percentage of the frames [first, end) that any path annotates, or 0 if the
+ * range is empty
+ */
+double FrameOccupancy::annotatedPercent(int first, int end) const{
+    if(end <= first)
+        return 0;
+    return double(100*annotatedFrames(first, end))/(end - first);
+}
@@ -0,0 +1,31 @@
+#ifndef FRAMEOCCUPANCY_H
+#define FRAMEOCCUPANCY_H
+
+#include <QList>
+#include <QPair>
+#include <QVector>
+#include "motionpath.h"
+
+/**
+ * @brief The FrameOccupancy class indexes which video frames are annotated by any MotionPath, so that the number of
+ * annotated frames in a range is a lookup in prefix sums rather than a scan over frames and paths. update() only
+ * touches the frames of the paths that changed since the last update.
+ */
+class FrameOccupancy
+{
+public:
+    FrameOccupancy();
+    void update(const QList<MotionPath *> &paths);
+    int annotatedFrames(int first, int end) const;
+    double annotatedPercent(int first, int end) const;
+
+private:
+    void cover(int start, int end, int delta);
+
+    QVector<int> depth;                 // Paths over each frame
+    QVector<int> prefix;                // Annotated frames before each frame, up to depth.size()
+    QVector<QPair<int, int>> ranges;    // Frames [start, end) of the paths as of the last update, sorted
+    int dirty;                          // First frame whose prefix sum is out of date
+};
+
+#endif // FRAMEOCCUPANCY_H
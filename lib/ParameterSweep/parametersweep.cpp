@@ -0,0 +1,170 @@
+#include "parametersweep.h"
+#include <QStringList>
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+ParameterSweep::ParameterSweep(const SimulationInput &input) : input(input)
+{
+}
+
+ParameterSweep::~ParameterSweep()
+{
+}
+
+/**
+ * @brief ParameterSweep::prepare Reads the data and annotations to be swept
+ * @param values Every value each parameter will take
+ * @return false on error. Call getErrorString() for more details.
+ */
+bool ParameterSweep::prepare(const QVector<QVector<double>> &values){
+    errorString.clear();
+    if(!stats.prepare(input)){
+        errorString = stats.getErrorString();
+        return false;
+    }
+    return prepareData(values);
+}
+
+int ParameterSweep::numEvents() const{
+    return stats.numEvents();
+}
+
+/**
+ * @brief ParameterSweep::getErrorString Why prepare() failed, or why the data could not be read during the sweep
+ */
+QString ParameterSweep::getErrorString() const{
+    if(errorString.isEmpty() && input.data != nullptr)
+        return input.data->getErrorString();
+    return errorString;
+}
+
+/**
+ * @brief ParameterSweep::readFed Reads the samples of a column that a detector is fed when it takes every
+ * [downSample]th one
+ * @param first, count Range of fed samples to read
+ */
+void ParameterSweep::readFed(const TimeSeriesColumn *column, int downSample, int first, int count, double *out) const{
+    column->readStrided(first*downSample, count, downSample, out);
+}
+
+/**
+ * @brief ParameterSweep::simulatedSamples Samples the simulator views step through: all but the last
+ */
+int ParameterSweep::simulatedSamples() const{
+    return qMax(0, input.data->numRows() - 1);
+}
+
+/**
+ * @brief ParameterSweep::check Simulates a configuration the way its simulator view would (see simulate), and compares
+ * the result with the counts run() gave for it. A sweep must give exactly what the view shows for the same
+ * configuration, so any difference is a bug in the sweep. Safe to call from a worker thread.
+ * @param mismatch Receives a description of the difference, if there is one
+ * @return true if the counts are the same
+ */
+bool ParameterSweep::check(const QVector<double> &config, const ActivityCounts &counts, QString &mismatch) const{
+    const ActivityCounts expected = stats.count(simulate(config));
+    if(expected.samples == counts.samples && expected.activeSamples == counts.activeSamples &&
+            expected.wakeups == counts.wakeups && expected.coveredEvents == counts.coveredEvents &&
+            expected.falsePositiveEvents == counts.falsePositiveEvents && expected.correctSamples == counts.correctSamples &&
+            expected.falsePositiveSamples == counts.falsePositiveSamples &&
+            expected.falseNegativeSamples == counts.falseNegativeSamples){
+        return true;
+    }
+    QStringList values;
+    for(double value: config){
+        values << QString::number(value);
+    }
+    mismatch = QString("The sweep does not match the simulator for the configuration (%1): it gives %2 active samples, "
+                       "%3 wakeups and %4 covered events, where the simulator gives %5, %6 and %7. Please report this.")
+            .arg(values.join(", ")).arg(counts.activeSamples).arg(counts.wakeups).arg(counts.coveredEvents)
+            .arg(expected.activeSamples).arg(expected.wakeups).arg(expected.coveredEvents);
+    return false;
+}
+
+/**
+ * @brief ParameterSweep::steps Values from first to last (inclusive) in steps of step. A step of 0 gives first only.
+ */
+QVector<double> ParameterSweep::steps(double first, double last, double step){
+    QVector<double> values;
+    if(!(step > 0) || last < first)
+        return values << first;
+    const int n = int(std::floor((last - first)/step + 1e-9)) + 1;
+    values.reserve(n);
+    for(int i=0; i<n; i++){
+        values.append(first + i*step);
+    }
+    return values;
+}
+
+/**
+ * @brief ParameterSweep::grid Every combination of the given values of each parameter. The first parameter varies the
+ * slowest.
+ */
+QVector<QVector<double>> ParameterSweep::grid(const QVector<QVector<double>> &values){
+    QVector<QVector<double>> configs;
+    qint64 total = values.isEmpty() ? 0 : 1;
+    for(const QVector<double> &v: values){
+        total *= v.size();
+    }
+    if(total == 0 || total > std::numeric_limits<int>::max())
+        return configs;
+
+    configs.reserve(int(total));
+    QVector<int> index(values.size(), 0);
+    QVector<double> config(values.size());
+    for(qint64 n=0; n<total; n++){
+        for(int p=0; p<values.size(); p++){
+            config[p] = values.at(p).at(index.at(p));
+        }
+        configs.append(config);
+        // Count up, the last parameter fastest
+        for(int p=values.size() - 1; p>=0; p--){
+            if(++index[p] < values.at(p).size())
+                break;
+            index[p] = 0;
+        }
+    }
+    return configs;
+}
+
+/**
+ * @brief ParameterSweep::paretoFront Results that no other result beats on energy, covered events and false positive
+ * events all at once
+ * @return Indices of those results, by increasing energy
+ */
+QVector<int> ParameterSweep::paretoFront(const QVector<SweepResult> &results){
+    QVector<int> order(results.size());
+    for(int i=0; i<order.size(); i++){
+        order[i] = i;
+    }
+    // A result can only be dominated by one before it in this order
+    std::sort(order.begin(), order.end(), [&results](int a, int b){
+        const SweepResult &ra = results.at(a);
+        const SweepResult &rb = results.at(b);
+        if(ra.energy != rb.energy)
+            return ra.energy < rb.energy;
+        if(ra.counts.coveredEvents != rb.counts.coveredEvents)
+            return ra.counts.coveredEvents > rb.counts.coveredEvents;
+        return ra.counts.falsePositiveEvents < rb.counts.falsePositiveEvents;
+    });
+
+    QVector<int> front;
+    for(int i: order){
+        const ActivityCounts &r = results.at(i).counts;
+        const double energy = results.at(i).energy;
+        bool dominated = false;
+        for(int j: front){
+            const ActivityCounts &f = results.at(j).counts;
+            const double frontEnergy = results.at(j).energy;
+            if(frontEnergy <= energy && f.coveredEvents >= r.coveredEvents && f.falsePositiveEvents <= r.falsePositiveEvents &&
+                    (frontEnergy < energy || f.coveredEvents > r.coveredEvents || f.falsePositiveEvents < r.falsePositiveEvents)){
+                dominated = true;
+                break;
+            }
+        }
+        if(!dominated)
+            front.append(i);
+    }
+    return front;
+}
@@ -0,0 +1,96 @@
+#ifndef PARAMETERSWEEP_H
+#define PARAMETERSWEEP_H
+
+#include <QList>
+#include <QString>
+#include <QVector>
+#include "activitystats.h"
+#include "timeseries.h"
+
+// Samples decoded at a time while preparing a sweep
+#define SWEEP_BLOCK_SAMPLES 65536
+
+/**
+ * @brief The SweepParameter struct describes one parameter of a sweep, and the range it is swept over by default
+ */
+struct SweepParameter
+{
+    QString name;
+    double minimum;
+    double maximum;
+    int decimals;       // 0 for whole numbers
+    double from;
+    double to;
+    double step;
+};
+
+/**
+ * @brief The SweepResult struct holds the statistics of one configuration of a sweep
+ */
+struct SweepResult
+{
+    QVector<double> config; // One value per parameter
+    ActivityCounts counts;
+    double energy;          // mAh
+    QString mismatch;       // Set if the configuration was checked against its simulator and differs (see check)
+};
+
+/**
+ * @brief The ParameterSweep class is the interface of a parameter sweep: a detector run over the same data with many
+ * configurations, each scored the way its simulator view would score it.
+ *
+ * prepare() is called once on the GUI thread, with every value each parameter will take. It reads whatever the
+ * configurations share (decoded or filtered data, the statistics window and the annotated events), so that run() can
+ * be called for many configurations at once from a thread pool without touching the data.
+ */
+class ParameterSweep
+{
+public:
+    explicit ParameterSweep(const SimulationInput &input);
+    virtual ~ParameterSweep();
+
+    /**
+     * @brief parameters Describes the parameters of a configuration, in order
+     * @param current The simulator view's configuration, which the default ranges are based on
+     */
+    virtual QList<SweepParameter> parameters(const QVector<double> &current) const = 0;
+
+    /**
+     * @brief run Simulates one configuration. Must be safe to call from several threads at once.
+     * @param config One value per parameter, each of them one of those passed to prepare()
+     */
+    virtual ActivityCounts run(const QVector<double> &config) const = 0;
+
+    /**
+     * @brief simulate Simulates one configuration the way the simulator view does, feeding the detector itself one
+     * sample at a time. Much slower than run(), but it takes none of run()'s shortcuts, so it serves to check them
+     * (see check). Must be safe to call from a worker thread.
+     * @param config As for run()
+     */
+    virtual ActivityTimeline simulate(const QVector<double> &config) const = 0;
+
+    bool prepare(const QVector<QVector<double>> &values);
+    bool check(const QVector<double> &config, const ActivityCounts &counts, QString &mismatch) const;
+    int numEvents() const;
+    QString getErrorString() const;
+
+    static QVector<double> steps(double first, double last, double step);
+    static QVector<QVector<double>> grid(const QVector<QVector<double>> &values);
+    static QVector<int> paretoFront(const QVector<SweepResult> &results);
+
+protected:
+    /**
+     * @brief prepareData Reads what the configurations share. Called by prepare(), once the statistics are set up.
+     * @return false on error, with errorString set
+     */
+    virtual bool prepareData(const QVector<QVector<double>> &values) = 0;
+
+    void readFed(const TimeSeriesColumn *column, int downSample, int first, int count, double *out) const;
+    int simulatedSamples() const;
+
+    SimulationInput input;
+    ActivityStats stats;
+    QString errorString;
+};
+
+#endif // PARAMETERSWEEP_H
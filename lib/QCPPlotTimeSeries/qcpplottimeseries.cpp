@@ -1,23 +1,102 @@
 #include "qcpplottimeseries.h"
 
+namespace {
+// Rows read at a time when building graph data
+const int plotBlockRows = 65536;
+
+// Builds graph data straight from the columns, without an intermediate copy of either of them
+QVector<QCPGraphData> graphData(const TimeSeriesColumn *time, const TimeSeriesColumn *values){
+    const int rows = values->size();
+    QVector<QCPGraphData> out(rows);
+    ColumnReader timeReader(time), valueReader(values);
+    for(int start=0; start<rows; start+=plotBlockRows){
+        const int n = qMin(plotBlockRows, rows - start);
+        const double *t = timeReader.block(start, n);
+        const double *v = valueReader.block(start, n);
+        QCPGraphData *points = out.data() + start;
+        for(int i=0; i<n; i++){
+            points[i] = QCPGraphData(t[i], v[i]);
+        }
+    }
+    return out;
+}
+
+/**
+ * Reduces a column to at most PLOT_MAX_POINTS points by keeping the minimum and maximum of each bucket of rows,
+ * in time order. Spikes stay visible, which they would not with plain subsampling.
+ */
+QVector<QCPGraphData> envelope(const TimeSeriesColumn *time, const TimeSeriesColumn *values){
+    const int rows = values->size();
+    const int bucket = (rows + PLOT_MAX_POINTS/2 - 1) / (PLOT_MAX_POINTS/2);
+    QVector<QCPGraphData> out;
+    out.reserve(2 * (rows/bucket + 1));
+    ColumnReader timeReader(time), valueReader(values);
+    for(int start=0; start<rows; start+=bucket){
+        const int n = qMin(bucket, rows - start);
+        const double *t = timeReader.block(start, n);
+        const double *v = valueReader.block(start, n);
+        int lo = 0, hi = 0;
+        for(int i=1; i<n; i++){
+            if(v[i] < v[lo]) lo = i;
+            if(v[i] > v[hi]) hi = i;
+        }
+        out << QCPGraphData(t[qMin(lo, hi)], v[qMin(lo, hi)]);
+        if(lo != hi){
+            out << QCPGraphData(t[qMax(lo, hi)], v[qMax(lo, hi)]);
+        }
+    }
+    return out;
+}
+}
+
 /**
  * @brief plotData Plots data on provided QCustomPlot widget
  * @param plot The QCustomPlot widget
- * @param ts The TimeSeries from which to derive data
+ * @param ts The TimeSeries from which to derive data. Columns that were left out when it was loaded are not plotted.
  * @return The number of graphs plotted
  */
 int QCPPlotTimeSeries::plotData(QCustomPlot *plot, TimeSeries *ts){
-    int currentGraph = 0; // Keep track of graph index
+    return plotColumns(plot, ts, 0, QString());
+}
+
+/**
+ * @brief plotStreams Plots every stream of a StreamSet on provided QCustomPlot widget. Each stream is plotted
+ * against its own time column, so streams of different rates are shown together without resampling.
+ * @param firstGraph Index of the first graph to add, e.g. after the graphs of the main data
+ * @return The number of graphs plotted
+ */
+int QCPPlotTimeSeries::plotStreams(QCustomPlot *plot, const StreamSet *streams, int firstGraph){
+    int numGraphs = 0;
+    for(int s=0; s<streams->numStreams(); ++s){
+        numGraphs += plotColumns(plot, streams->stream(s), firstGraph + numGraphs, streams->streamName(s) + "/");
+    }
+    return numGraphs;
+}
+
+/**
+ * @brief plotColumns Adds one graph per loaded data column of a TimeSeries
+ * @param firstGraph Index of the first graph to add
+ * @param prefix Put in front of each column name to make the graph name
+ * @return The number of graphs added
+ */
+int QCPPlotTimeSeries::plotColumns(QCustomPlot *plot, TimeSeries *ts, int firstGraph, const QString &prefix){
+    int currentGraph = firstGraph; // Keep track of graph index
     for(int col=0; col<ts->numColumns(); ++col){
-        if (col != ts->getTimeColumn()){
+        if (col != ts->getTimeColumn() && ts->isLoaded(col)){
             plot->addGraph();
-            plot->graph(currentGraph)->setData(ts->timeColumnData()->toVector(), ts->getColumn(col)->toVector());
+            if(ts->isPaged() && ts->numRows() > PLOT_MAX_POINTS){
+                // Paged data sets can be far larger than memory; only plot their envelope
+                plot->graph(currentGraph)->data()->set(envelope(ts->timeColumnData(), ts->getColumn(col)), true);
+            }
+            else{
+                plot->graph(currentGraph)->data()->set(graphData(ts->timeColumnData(), ts->getColumn(col)));
+            }
             plot->graph(currentGraph)->setPen(getPenStyle(currentGraph));
-            plot->graph(currentGraph)->setName(ts->columnName(col));
+            plot->graph(currentGraph)->setName(prefix + ts->columnName(col));
             ++currentGraph;
         }
     }
-    return currentGraph;
+    return currentGraph - firstGraph;
 }
 
 /**
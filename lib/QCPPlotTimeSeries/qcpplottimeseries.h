@@ -2,6 +2,7 @@
 #define QCPPLOTTIMESERIES_H
 #include <qcustomplot.h>
 #include <timeseries.h>
+#include <streamset.h>
 #include <QList>
 #include <QColor>
 #include <QPen>
@@ -15,6 +16,8 @@
   5 = dash-dot-dot line
   */
 #define NUM_QPEN_STYLES 5
+// Paged data sets with more rows than this are plotted as a min/max envelope
+#define PLOT_MAX_POINTS (2*1024*1024)
 
 namespace QCPPlotTimeSeries{
     const QList<QColor> colors = {QColor(255, 0, 0),     //  Red
@@ -25,6 +28,8 @@ namespace QCPPlotTimeSeries{
                                   QColor(255, 0, 255)};   //  Magenta
 
     int plotData(QCustomPlot *plot, TimeSeries *ts);
+    int plotStreams(QCustomPlot *plot, const StreamSet *streams, int firstGraph = 0);
+    int plotColumns(QCustomPlot *plot, TimeSeries *ts, int firstGraph, const QString &prefix);
     QPen getPenStyle(int i);
 }
 
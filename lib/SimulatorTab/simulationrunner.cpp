@@ -0,0 +1,113 @@
+#include "simulationrunner.h"
+#include <QtConcurrent>
+
+/**
+ * @brief SimulationJob::run Simulates and scores as asked. Runs on a worker thread.
+ * @return false if the run failed, with result.error set, or was canceled
+ */
+bool SimulationJob::run(SimulationResult &result, LoadProgress &progress){
+    result.hasTimeline = simulate;
+    result.hasCounts = count;
+    if(simulate){
+        if(!simulateTimeline(result.timeline, progress, result.error))
+            return false;
+    }
+    else{
+        result.timeline = timeline;
+    }
+    if(count && !progress.isCanceled()){
+        result.stats = stats;
+        result.counts = stats.count(result.timeline, eventCoverage ? &result.coverage : nullptr,
+                                    eventCoverage ? &result.regions : nullptr);
+    }
+    return !progress.isCanceled();
+}
+
+SimulationRunner::SimulationRunner(QObject *parent) : QObject(parent)
+{
+    generation = 0;
+    progressTimer.setInterval(SIMULATION_PROGRESS_INTERVAL);
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(pollProgress()));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(workerFinished()));
+}
+
+SimulationRunner::~SimulationRunner(){
+    cancel();
+    wait();
+}
+
+/**
+ * @brief SimulationRunner::start Cancels the run in progress, if any, and starts the job. Emits finished once it is done.
+ */
+void SimulationRunner::start(QSharedPointer<SimulationJob> job){
+    cancel();
+    ++generation;
+    progress = QSharedPointer<LoadProgress>(new LoadProgress());
+    watcher.setFuture(QtConcurrent::run(&SimulationRunner::run, generation, job, progress));
+    progressTimer.start();
+}
+
+/**
+ * @brief SimulationRunner::cancel Cancels the run in progress, if any, and throws away its result. Does not wait for
+ * it: it returns at its next check for cancellation.
+ * @return true if a run was canceled
+ */
+bool SimulationRunner::cancel(){
+    progressTimer.stop();
+    if(!watcher.isRunning())
+        return false;
+    progress->cancel();
+    canceled.append(watcher.future());
+    // Forget the old future, along with any signals it has pending
+    watcher.setFuture(QFuture<SimulationResult>());
+    // Only the runs that have not returned yet are kept track of
+    for(int i=canceled.size() - 1; i>=0; i--){
+        if(canceled.at(i).isFinished())
+            canceled.removeAt(i);
+    }
+    return true;
+}
+
+/**
+ * @brief SimulationRunner::wait Waits for every run, including canceled ones, to return. Called before the data they
+ * read is deleted.
+ */
+void SimulationRunner::wait(){
+    for(QFuture<SimulationResult> &future: canceled){
+        future.waitForFinished();
+    }
+    canceled.clear();
+    watcher.waitForFinished();
+}
+
+bool SimulationRunner::isRunning() const{
+    return watcher.isRunning();
+}
+
+void SimulationRunner::pollProgress(){
+    if(!progress.isNull()){
+        emit progressChanged(progress->percent());
+    }
+}
+
+void SimulationRunner::workerFinished(){
+    progressTimer.stop();
+    if(watcher.future().resultCount() == 0){
+        return;
+    }
+    SimulationResult result = watcher.result();
+    watcher.setFuture(QFuture<SimulationResult>());
+    // Results of superseded runs are dropped
+    if(result.generation != generation || progress->isCanceled()){
+        return;
+    }
+    emit finished(result);
+}
+
+// Runs on a worker thread
+SimulationResult SimulationRunner::run(int generation, QSharedPointer<SimulationJob> job, QSharedPointer<LoadProgress> progress){
+    SimulationResult result;
+    result.generation = generation;
+    job->run(result, *progress);
+    return result;
+}
@@ -0,0 +1,103 @@
+#ifndef SIMULATIONRUNNER_H
+#define SIMULATIONRUNNER_H
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QPair>
+#include <QSharedPointer>
+#include <QTimer>
+#include <QVector>
+#include "activitystats.h"
+#include "activitytimeline.h"
+#include "loadprogress.h"
+
+// Quiet time after the last change of a setting before the simulation is updated, in ms
+#define SIMULATION_DEBOUNCE_MS 80
+// Time into a run before its progress is first shown, then between progress updates, in ms
+#define SIMULATION_PROGRESS_INTERVAL 100
+
+/**
+ * @brief The SimulationResult struct is what a run of a simulator tab publishes back to it
+ */
+struct SimulationResult
+{
+    int generation;                     // Which run this is (see SimulationRunner)
+    bool hasTimeline;                   // Whether the run simulated a new timeline
+    ActivityTimeline timeline;
+    bool hasCounts;                     // Whether the run scored the timeline
+    ActivityStats stats;                // What it was scored against
+    ActivityCounts counts;
+    QVector<double> coverage;           // See ActivityStats::count
+    QList<QPair<double, bool>> regions;
+    QString error;                      // Empty unless the run failed
+};
+
+/**
+ * @brief The SimulationJob class is one run of a simulator tab: it simulates the detector's timeline if its settings
+ * changed, then scores the timeline over the statistics window. The tab fills in everything the job reads on the GUI
+ * thread, binding the data's columns there, so that run() touches nothing the GUI thread may change.
+ */
+class SimulationJob
+{
+public:
+    SimulationJob() : simulate(false), count(false), eventCoverage(false) {}
+    virtual ~SimulationJob() {}
+    bool run(SimulationResult &result, LoadProgress &progress);
+
+    bool simulate;              // Simulate a new timeline, rather than score [timeline]
+    ActivityTimeline timeline;
+    bool count;                 // Score the timeline with [stats], which is prepared
+    bool eventCoverage;         // Also find the coverage of each event and the active regions
+    ActivityStats stats;
+
+protected:
+    /**
+     * @brief simulateTimeline Runs the detector over the data. Runs on a worker thread.
+     * @param progress Reports the samples simulated, and says when to give up
+     * @return false if the run failed, with error set, or was canceled
+     */
+    virtual bool simulateTimeline(ActivityTimeline &timeline, LoadProgress &progress, QString &error) = 0;
+};
+
+/**
+ * @brief The SimulationRunner class runs the jobs of a simulator tab on a worker thread, so that the video and the
+ * plot stay responsive while the detector is simulated. Only the latest job counts: starting one cancels the run in
+ * progress without waiting for it, and its result is thrown away by generation once it finishes. Progress is only
+ * reported for runs that take longer than SIMULATION_PROGRESS_INTERVAL.
+ *
+ * Canceled runs may still be reading the data for a moment. Call wait() before the data they were bound to is
+ * deleted.
+ */
+class SimulationRunner : public QObject
+{
+    Q_OBJECT
+public:
+    explicit SimulationRunner(QObject *parent = nullptr);
+    ~SimulationRunner();
+    void start(QSharedPointer<SimulationJob> job);
+    bool cancel();
+    void wait();
+    bool isRunning() const;
+
+signals:
+    void progressChanged(int percent);
+    // Not emitted for runs that were canceled
+    void finished(SimulationResult result);
+
+private slots:
+    void pollProgress();
+    void workerFinished();
+
+private:
+    static SimulationResult run(int generation, QSharedPointer<SimulationJob> job, QSharedPointer<LoadProgress> progress);
+
+    QFutureWatcher<SimulationResult> watcher;
+    QTimer progressTimer;
+    QSharedPointer<LoadProgress> progress;
+    int generation;
+    // Canceled runs that may not have returned yet
+    QList<QFuture<SimulationResult>> canceled;
+};
+
+#endif // SIMULATIONRUNNER_H
@@ -0,0 +1,41 @@
+#ifndef SIMULATIONSTAGE_H
+#define SIMULATIONSTAGE_H
+
+#include <QVariantList>
+
+/**
+ * @brief The SimulationStage class tracks the inputs a stage of a simulation was last computed from, so that the stage
+ * is only recomputed when one of them changes. A stage that depends on an earlier one lists the earlier stage's
+ * generation() among its inputs, so that it is recomputed whenever the earlier stage is.
+ */
+class SimulationStage
+{
+public:
+    SimulationStage() : count(0), valid(false) {}
+
+    /**
+     * @brief update Records the inputs the stage is about to be computed from
+     * @return true if they differ from those of the last computation, i.e. if the stage must be recomputed
+     */
+    bool update(const QVariantList &inputs){
+        if(valid && inputs == last)
+            return false;
+        last = inputs;
+        valid = true;
+        ++count;
+        return true;
+    }
+
+    // Forces the next update() to recompute, e.g. when the computation failed or its output was thrown away
+    void invalidate(){ valid = false; }
+
+    // Changes every time the stage is recomputed
+    int generation() const { return count; }
+
+private:
+    QVariantList last;
+    int count;
+    bool valid;
+};
+
+#endif // SIMULATIONSTAGE_H
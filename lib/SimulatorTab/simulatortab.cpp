@@ -4,3 +4,11 @@ SimulatorTab::SimulatorTab(QWidget *parent) : QFrame(parent)
 {
 
 }
+
+/**
+ * @brief SimulatorTab::attachStreams Hands over the data files recorded at other rates than the main data, or null if
+ * there are none. Tabs that only simulate on the main data ignore them.
+ */
+void SimulatorTab::attachStreams(StreamSet *streams){
+    Q_UNUSED(streams)
+}
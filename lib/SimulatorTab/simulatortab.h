@@ -6,9 +6,13 @@
 #include <QFrame>
 #include <opencv2/opencv.hpp>
 #include <opencv2/videoio.hpp>
+#include "streamset.h"
 #include "timeseries.h"
 #include "motionpath.h"
 
+// Distance in pixels within which a press on the plot grabs a statistics marker
+#define STAT_MARKER_GRAB_PIXELS 4
+
 class SimulatorTab : public QFrame
 {
     Q_OBJECT
@@ -16,6 +20,7 @@ public:
     explicit SimulatorTab(QWidget *parent = nullptr);
     virtual void attachCap(cv::VideoCapture *cap) = 0;
     virtual void attachTimeSeries(TimeSeries *ts) = 0;
+    virtual void attachStreams(StreamSet *streams);
     virtual void attachPath(QList<MotionPath *> *paths) = 0;
     virtual void init() = 0;
 
@@ -0,0 +1,243 @@
+#include "binaryreader.h"
+#include <QFileInfo>
+#include <QSettings>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <cstring>
+
+namespace {
+struct TypeName{
+    const char *name;
+    RecordField::Type type;
+};
+
+const TypeName typeNames[] = {{"int8", RecordField::Int8}, {"uint8", RecordField::UInt8},
+                              {"int16", RecordField::Int16}, {"uint16", RecordField::UInt16},
+                              {"int32", RecordField::Int32}, {"uint32", RecordField::UInt32},
+                              {"int64", RecordField::Int64}, {"uint64", RecordField::UInt64},
+                              {"float32", RecordField::Float32}, {"float64", RecordField::Float64}};
+
+// Field types that are stored as raw counts in an Int16 column
+bool fitsInt16(RecordField::Type type){
+    return type == RecordField::Int8 || type == RecordField::UInt8 || type == RecordField::Int16;
+}
+
+// Loads a value of type T stored with the given byte order. Floats are loaded through their bit pattern.
+template<typename T, typename Bits, bool bigEndian>
+inline T load(const uchar *p){
+    const Bits bits = bigEndian ? qFromBigEndian<Bits>(p) : qFromLittleEndian<Bits>(p);
+    T value;
+    memcpy(&value, &bits, sizeof(T));
+    return value;
+}
+
+template<typename T, typename Bits, bool bigEndian>
+void decodeDoubleOrdered(const uchar *p, int stride, int count, double scale, double bias, double *out){
+    if(scale == 1 && bias == 0){
+        // Keep values exactly as stored, including the sign of zero
+        for(int i=0; i<count; i++, p+=stride){
+            out[i] = double(load<T, Bits, bigEndian>(p));
+        }
+    }
+    else{
+        for(int i=0; i<count; i++, p+=stride){
+            out[i] = double(load<T, Bits, bigEndian>(p)) * scale + bias;
+        }
+    }
+}
+
+template<typename T, typename Bits, bool bigEndian>
+void decodeInt16Ordered(const uchar *p, int stride, int count, qint16 *out){
+    for(int i=0; i<count; i++, p+=stride){
+        out[i] = qint16(load<T, Bits, bigEndian>(p));
+    }
+}
+
+template<typename T, typename Bits>
+void decodeDouble(const uchar *p, int stride, int count, const RecordField &field, double *out){
+    if(field.bigEndian)
+        decodeDoubleOrdered<T, Bits, true>(p, stride, count, field.scale, field.bias, out);
+    else
+        decodeDoubleOrdered<T, Bits, false>(p, stride, count, field.scale, field.bias, out);
+}
+
+template<typename T, typename Bits>
+void decodeInt16(const uchar *p, int stride, int count, const RecordField &field, qint16 *out){
+    if(field.bigEndian)
+        decodeInt16Ordered<T, Bits, true>(p, stride, count, out);
+    else
+        decodeInt16Ordered<T, Bits, false>(p, stride, count, out);
+}
+
+// A run of consecutive records, decoded independently of the others
+struct Chunk{
+    const uchar *records;
+    int first;
+    int count;
+};
+}
+
+int RecordField::size() const{
+    switch(type){
+    case Int8: case UInt8: return 1;
+    case Int16: case UInt16: return 2;
+    case Int32: case UInt32: case Float32: return 4;
+    default: return 8;
+    }
+}
+
+RecordLayout::RecordLayout()
+{
+    recordSize = 0;
+    headerSize = 0;
+}
+
+/**
+ * @brief RecordLayout::load Reads a layout from an INI file
+ * @return true if the layout is usable. Call getErrorString() for the reason if not.
+ */
+bool RecordLayout::load(const QString &fileName){
+    if(!QFileInfo(fileName).isReadable()){
+        errorString = QString("Layout file '%1' cannot be read.").arg(fileName);
+        return false;
+    }
+    QSettings settings(fileName, QSettings::IniFormat);
+
+    settings.beginGroup("record");
+    recordSize = settings.value("size", 0).toInt();
+    headerSize = settings.value("header", 0).toInt();
+    const QString byteOrder = settings.value("byteorder", "little").toString().toLower();
+    settings.endGroup();
+    if(recordSize <= 0 || headerSize < 0){
+        errorString = "Record size must be positive, and header size must not be negative.";
+        return false;
+    }
+
+    fields.clear();
+    const int numFields = settings.beginReadArray("fields");
+    for(int i=0; i<numFields; i++){
+        settings.setArrayIndex(i);
+        RecordField field;
+        field.name = settings.value("name", QString("Field %1").arg(i+1)).toString();
+        field.offset = settings.value("offset", -1).toInt();
+        field.bigEndian = settings.value("byteorder", byteOrder).toString().toLower() == "big";
+        field.scale = settings.value("scale", 1.0).toDouble();
+        field.bias = settings.value("bias", 0.0).toDouble();
+        field.role = settings.value("role", QString()).toString();
+        field.unit = settings.value("unit", QString()).toString();
+
+        const QString typeName = settings.value("type", "float64").toString().toLower();
+        bool knownType = false;
+        for(const TypeName &t: typeNames){
+            if(typeName == t.name){
+                field.type = t.type;
+                knownType = true;
+            }
+        }
+        if(!knownType){
+            errorString = QString("Field '%1' has unknown type '%2'.").arg(field.name).arg(typeName);
+            settings.endArray();
+            return false;
+        }
+        if(field.offset < 0 || field.offset + field.size() > recordSize){
+            errorString = QString("Field '%1' does not fit within a %2-byte record.").arg(field.name).arg(recordSize);
+            settings.endArray();
+            return false;
+        }
+        fields.append(field);
+    }
+    settings.endArray();
+
+    if(fields.isEmpty()){
+        errorString = "Layout has no fields.";
+        return false;
+    }
+    return true;
+}
+
+QString RecordLayout::getErrorString() const{
+    return errorString;
+}
+
+/**
+ * @brief BinaryReader::decodeRecords Decodes [numRecords] consecutive records starting at [begin] into one column per
+ * layout field, spreading runs of BINARY_CHUNK_RECORDS records across all cores.
+ * @param columns Replaced with the decoded columns
+ * @param progress If given, receives the number of records decoded, and can stop decoding early
+ * @return false if decoding was canceled before the end
+ */
+bool BinaryReader::decodeRecords(const uchar *begin, int numRecords, const RecordLayout &layout, std::vector<TimeSeriesColumn> &columns,
+                                 LoadProgress *progress){
+    const int numFields = layout.fields.size();
+    columns.clear();
+    columns.resize(numFields);
+
+    // Every column is sized up front, so chunks can write their own rows without any locking
+    QVector<double *> doubleOut(numFields, nullptr);
+    QVector<qint16 *> int16Out(numFields, nullptr);
+    for(int f=0; f<numFields; f++){
+        const RecordField &field = layout.fields.at(f);
+        if(fitsInt16(field.type))
+            int16Out[f] = columns[f].resizeInt16(numRecords, field.scale, field.bias);
+        else
+            doubleOut[f] = columns[f].resize(numRecords);
+    }
+
+    QVector<Chunk> chunks;
+    for(int first=0; first<numRecords; first+=BINARY_CHUNK_RECORDS){
+        Chunk chunk;
+        chunk.records = begin + qint64(first) * layout.recordSize;
+        chunk.first = first;
+        chunk.count = qMin(BINARY_CHUNK_RECORDS, numRecords - first);
+        chunks.append(chunk);
+    }
+
+    const int stride = layout.recordSize;
+    QtConcurrent::blockingMap(chunks, [&](const Chunk &chunk){
+        if(progress != nullptr && progress->isCanceled())
+            return;
+        for(int f=0; f<numFields; f++){
+            const RecordField &field = layout.fields.at(f);
+            const uchar *p = chunk.records + field.offset;
+            const int n = chunk.count;
+            // Only one of these is set for any field
+            double *d = doubleOut.at(f);
+            qint16 *r = int16Out.at(f);
+            switch(field.type){
+            case RecordField::Int8:    decodeInt16<qint8, quint8>(p, stride, n, field, r + chunk.first); break;
+            case RecordField::UInt8:   decodeInt16<quint8, quint8>(p, stride, n, field, r + chunk.first); break;
+            case RecordField::Int16:   decodeInt16<qint16, quint16>(p, stride, n, field, r + chunk.first); break;
+            case RecordField::UInt16:  decodeDouble<quint16, quint16>(p, stride, n, field, d + chunk.first); break;
+            case RecordField::Int32:   decodeDouble<qint32, quint32>(p, stride, n, field, d + chunk.first); break;
+            case RecordField::UInt32:  decodeDouble<quint32, quint32>(p, stride, n, field, d + chunk.first); break;
+            case RecordField::Int64:   decodeDouble<qint64, quint64>(p, stride, n, field, d + chunk.first); break;
+            case RecordField::UInt64:  decodeDouble<quint64, quint64>(p, stride, n, field, d + chunk.first); break;
+            case RecordField::Float32: decodeDouble<float, quint32>(p, stride, n, field, d + chunk.first); break;
+            case RecordField::Float64: decodeDouble<double, quint64>(p, stride, n, field, d + chunk.first); break;
+            }
+        }
+        if(progress != nullptr)
+            progress->add(chunk.count);
+    });
+    return progress == nullptr || !progress->isCanceled();
+}
+
+/**
+ * @brief BinaryReader::decodeField Decodes one field of [count] records (or [count] packed values, if stride is the
+ * field size) to doubles, whatever the field's type. Used by importers of other formats that store raw arrays.
+ * @param begin First byte of the field in the first record
+ */
+void BinaryReader::decodeField(const uchar *begin, int stride, int count, const RecordField &field, double *out){
+    switch(field.type){
+    case RecordField::Int8:    decodeDouble<qint8, quint8>(begin, stride, count, field, out); break;
+    case RecordField::UInt8:   decodeDouble<quint8, quint8>(begin, stride, count, field, out); break;
+    case RecordField::Int16:   decodeDouble<qint16, quint16>(begin, stride, count, field, out); break;
+    case RecordField::UInt16:  decodeDouble<quint16, quint16>(begin, stride, count, field, out); break;
+    case RecordField::Int32:   decodeDouble<qint32, quint32>(begin, stride, count, field, out); break;
+    case RecordField::UInt32:  decodeDouble<quint32, quint32>(begin, stride, count, field, out); break;
+    case RecordField::Int64:   decodeDouble<qint64, quint64>(begin, stride, count, field, out); break;
+    case RecordField::UInt64:  decodeDouble<quint64, quint64>(begin, stride, count, field, out); break;
+    case RecordField::Float32: decodeDouble<float, quint32>(begin, stride, count, field, out); break;
+    case RecordField::Float64: decodeDouble<double, quint64>(begin, stride, count, field, out); break;
+    }
+}
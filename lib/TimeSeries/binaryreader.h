@@ -0,0 +1,84 @@
+#ifndef BINARYREADER_H
+#define BINARYREADER_H
+
+#include <QList>
+#include <QString>
+#include <vector>
+#include "loadprogress.h"
+#include "timeseriescolumn.h"
+
+// Records decoded by one task when a dump is imported in parallel
+#define BINARY_CHUNK_RECORDS (64*1024)
+
+/**
+ * @brief The RecordField struct describes one field of a fixed-size binary record. Its value is raw*scale + bias.
+ */
+struct RecordField
+{
+    enum Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Int64, UInt64, Float32, Float64 };
+
+    QString name;
+    int offset;
+    Type type;
+    bool bigEndian;
+    double scale;
+    double bias;
+    // Channel role (see Channel::roleName) and unit, if the layout gives them
+    QString role;
+    QString unit;
+
+    int size() const;
+};
+
+/**
+ * @brief The RecordLayout class describes the fixed-size records of a binary logger dump. Layouts are INI files:
+ *
+ *     [record]
+ *     size=12             ; bytes per record
+ *     header=0            ; bytes to skip at the start of the file
+ *     byteorder=little    ; little or big, may be overridden per field
+ *
+ *     [fields]
+ *     size=2
+ *     1\name=Time
+ *     1\offset=0
+ *     1\type=uint32       ; int8/16/32/64, uint8/16/32/64, float32 or float64
+ *     1\scale=0.001
+ *     2\name=X
+ *     2\offset=4
+ *     2\type=int16
+ *     2\scale=0.0039
+ *     2\bias=0
+ *     2\role=accelx       ; optional, see Channel::roleName. Guessed from the name if not given.
+ *     2\unit=g            ; optional
+ *
+ * Each field becomes one TimeSeries column, in the order listed.
+ */
+class RecordLayout
+{
+public:
+    RecordLayout();
+    bool load(const QString &fileName);
+    QString getErrorString() const;
+
+    int recordSize;
+    int headerSize;
+    QList<RecordField> fields;
+
+private:
+    QString errorString;
+};
+
+/**
+ * BinaryReader decodes fixed-size records straight into columns, one field at a time over a run of records, so each
+ * inner loop is a simple strided load, conversion and scale. Integer fields of up to 16 bits are kept as raw counts
+ * in Int16 columns rather than being widened to doubles. Wider ones are compacted afterwards with the field's scale
+ * and bias (see TimeSeries::fromBinary), e.g. uint16 counts to Int16 and timestamps to Delta16.
+ */
+namespace BinaryReader{
+    bool decodeRecords(const uchar *begin, int numRecords, const RecordLayout &layout, std::vector<TimeSeriesColumn> &columns,
+                       LoadProgress *progress = nullptr);
+    void decodeField(const uchar *begin, int stride, int count, const RecordField &field, double *out);
+}
+
+#endif // BINARYREADER_H
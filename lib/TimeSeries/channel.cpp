@@ -0,0 +1,100 @@
+#include "channel.h"
+#include <QRegExp>
+#include <QStringList>
+
+namespace {
+struct RoleName{
+    Channel::Role role;
+    const char *name;
+};
+
+const RoleName roleNames[] = {
+    {Channel::Other, "other"},
+    {Channel::Time, "time"},
+    {Channel::AccelX, "accelx"},
+    {Channel::AccelY, "accely"},
+    {Channel::AccelZ, "accelz"},
+    {Channel::GyroX, "gyrox"},
+    {Channel::GyroY, "gyroy"},
+    {Channel::GyroZ, "gyroz"},
+    {Channel::MagX, "magx"},
+    {Channel::MagY, "magy"},
+    {Channel::MagZ, "magz"},
+    {Channel::Pressure, "pressure"},
+    {Channel::Temperature, "temperature"}
+};
+
+// Unit in brackets at the end of a column name, as in "X [g]" or "Pressure (hPa)"
+const QRegExp unitSuffix("\\s*[\\[(]([^\\])]*)[\\])]\\s*$");
+
+// Column name without its unit, lower case, with separators removed ("Acc_X [g]" becomes "accx")
+QString normalise(const QString &columnName){
+    QString name = columnName;
+    name.remove(unitSuffix);
+    return name.toLower().remove(QRegExp("[^a-z0-9]"));
+}
+
+// Axis of a name ending in x, y or z after one of the prefixes, or 0
+int axisOf(const QString &name, const QStringList &prefixes){
+    for(const QString &prefix: prefixes){
+        if(name.size() == prefix.size() + 1 && name.startsWith(prefix)){
+            const QChar axis = name.at(name.size() - 1);
+            if(axis == 'x' || axis == 'y' || axis == 'z')
+                return axis.toLatin1();
+        }
+    }
+    return 0;
+}
+}
+
+// Name of a role, as written in record layouts
+QString Channel::roleName(Role role){
+    for(const RoleName &r: roleNames){
+        if(r.role == role)
+            return r.name;
+    }
+    return QString();
+}
+
+// Role of a name written by roleName, or Other if it is unknown
+Channel::Role Channel::roleFromName(const QString &name){
+    const QString lower = name.trimmed().toLower();
+    for(const RoleName &r: roleNames){
+        if(lower == r.name)
+            return r.role;
+    }
+    return Other;
+}
+
+/**
+ * @brief Channel::guessRole Guesses the role of a column from its name. Bare axis names ("X", "Y", "Z") are taken to
+ * be acceleration, as that is what most loggers record.
+ */
+Channel::Role Channel::guessRole(const QString &columnName){
+    const QString name = normalise(columnName);
+    if(name == "time" || name == "timestamp" || name == "t")
+        return Time;
+    if(name == "pressure" || name == "press" || name == "baro")
+        return Pressure;
+    if(name == "temperature" || name == "temp")
+        return Temperature;
+
+    const Role accel[] = {AccelX, AccelY, AccelZ};
+    const Role gyro[] = {GyroX, GyroY, GyroZ};
+    const Role mag[] = {MagX, MagY, MagZ};
+    int axis;
+    const Role *roles = nullptr;
+    if((axis = axisOf(name, QStringList() << "" << "a" << "acc" << "accel" << "acceleration")) != 0)
+        roles = accel;
+    else if((axis = axisOf(name, QStringList() << "g" << "gyr" << "gyro")) != 0)
+        roles = gyro;
+    else if((axis = axisOf(name, QStringList() << "m" << "mag")) != 0)
+        roles = mag;
+    return (roles == nullptr) ? Other : roles[axis - 'x'];
+}
+
+// Unit in brackets at the end of a column name, or an empty string
+QString Channel::guessUnit(const QString &columnName){
+    QRegExp suffix(unitSuffix);
+    return (suffix.indexIn(columnName) >= 0) ? suffix.cap(1).trimmed() : QString();
+}
@@ -0,0 +1,43 @@
+#ifndef CHANNEL_H
+#define CHANNEL_H
+
+#include <QString>
+#include "timeseriescolumn.h"
+
+/**
+ * Channel describes what a TimeSeries column measures (its role) and in which unit, independently of what the
+ * column happens to be called in the data file. Roles and units are guessed from column names on import (e.g. "X",
+ * "AccX" or "acc_x [g]" are acceleration along X, in g), and can be set explicitly by record layouts.
+ */
+namespace Channel{
+    enum Role { Other, Time, AccelX, AccelY, AccelZ, GyroX, GyroY, GyroZ, MagX, MagY, MagZ, Pressure, Temperature };
+
+    QString roleName(Role role);
+    Role roleFromName(const QString &name);
+    Role guessRole(const QString &columnName);
+    QString guessUnit(const QString &columnName);
+}
+
+/**
+ * @brief The ColumnHandle class is a column of a TimeSeries that has been looked up once (by name or by role), so
+ * that loops over samples read values straight from the column rather than looking it up again for every sample.
+ * A handle stays valid until columns are added to its TimeSeries or the TimeSeries is destroyed.
+ */
+class ColumnHandle
+{
+public:
+    ColumnHandle() : col(-1), values(nullptr) {}
+    ColumnHandle(int column, const TimeSeriesColumn *values) : col(column), values(values) {}
+
+    // False if no column matched
+    bool isValid() const { return values != nullptr; }
+    int column() const { return col; }
+    const TimeSeriesColumn *data() const { return values; }
+    qreal at(int row) const { return values->at(row); }
+
+private:
+    int col;
+    const TimeSeriesColumn *values;
+};
+
+#endif // CHANNEL_H
@@ -0,0 +1,148 @@
+#include "columnpager.h"
+#include <QDebug>
+#include <QMutexLocker>
+#include <cstring>
+#include <limits>
+
+ColumnPager::ColumnPager(const QString &fileName, qint64 dataOffset, qint64 numRows, int numColumns, int blockRows, qint64 budget):
+    file(fileName)
+{
+    this->dataOffset = dataOffset;
+    this->rows = numRows;
+    this->numColumns = numColumns;
+    this->blockRows = blockRows;
+    // Always allow at least one block per column, so that reading a row never thrashes
+    maxMappedBlocks = int(qMax(qint64(numColumns), budget / (qint64(sizeof(double)) * blockRows)));
+    recent = QVector<RecentBlock>(numColumns, RecentBlock{-1, nullptr});
+}
+
+ColumnPager::~ColumnPager(){
+    for(const MappedBlock &m: mapped){
+        file.unmap(m.address);
+    }
+}
+
+/**
+ * @brief ColumnPager::open Opens the cache file
+ * @return false if it cannot be opened, or is too short to hold every block. Call getErrorString() for details.
+ */
+bool ColumnPager::open(){
+    if(!file.open(QFile::ReadOnly)){
+        errorString = QString("'%1' cannot be opened.").arg(file.fileName());
+        return false;
+    }
+    // Blocks past the end of the file could never be mapped
+    if(file.size() < dataOffset + qint64(sizeof(double)) * rows * numColumns){
+        errorString = QString("'%1' is truncated.").arg(file.fileName());
+        file.close();
+        return false;
+    }
+    return true;
+}
+
+qint64 ColumnPager::numRows() const{
+    return rows;
+}
+
+/**
+ * @brief ColumnPager::hasError True once a block could not be read. Its values read as NaN.
+ */
+bool ColumnPager::hasError() const{
+    return failed.load() != 0;
+}
+
+/**
+ * @brief ColumnPager::getErrorString Describes why the file could not be opened, or a block could not be read
+ */
+QString ColumnPager::getErrorString(){
+    QMutexLocker locker(&mutex);
+    return errorString;
+}
+
+/**
+ * @brief ColumnPager::value Returns a single value, mapping in its block if needed.
+ */
+qreal ColumnPager::value(int column, qint64 row){
+    QMutexLocker locker(&mutex);
+    const qint64 blockIndex = row / blockRows;
+    const RecentBlock &r = recent.at(column);
+    if(r.block == blockIndex){
+        return r.values[row - blockIndex*blockRows];
+    }
+    return block(column, blockIndex)[row - blockIndex*blockRows];
+}
+
+/**
+ * @brief ColumnPager::read Copies [count] consecutive values of one column, starting at row [start], to [out].
+ * Safe to call from several threads at once.
+ */
+void ColumnPager::read(int column, qint64 start, qint64 count, qreal *out){
+    QMutexLocker locker(&mutex);
+    while(count > 0){
+        const qint64 blockIndex = start / blockRows;
+        const qint64 offset = start - blockIndex*blockRows;
+        const qint64 n = qMin(count, qMin(qint64(blockRows), rows - blockIndex*blockRows) - offset);
+        memcpy(out, block(column, blockIndex) + offset, size_t(n) * sizeof(double));
+        out += n;
+        start += n;
+        count -= n;
+    }
+}
+
+// Returns the values of a column block, mapping it in if necessary. Caller must hold the mutex.
+const double *ColumnPager::block(int column, qint64 blockIndex){
+    const qint64 key = blockIndex * numColumns + column;
+    auto it = mapped.find(key);
+    if(it == mapped.end()){
+        if(mapped.size() >= maxMappedBlocks){
+            evictOldest();
+        }
+        MappedBlock m;
+        m.address = mapBlock(column, blockIndex);
+        if(m.address == nullptr && !mapped.isEmpty()){
+            // Possibly out of address space: give back every other block, and try once more
+            while(!mapped.isEmpty()){
+                evictOldest();
+            }
+            m.address = mapBlock(column, blockIndex);
+        }
+        if(m.address == nullptr){
+            // Never make up values: the block reads as NaN, and the failure is reported through getErrorString
+            qWarning() << "ColumnPager: could not map block" << blockIndex << "of column" << column << "from" << file.fileName();
+            if(failed.testAndSetOrdered(0, 1)){
+                errorString = QString("Part of the data could not be read from '%1'. Open the data file again.").arg(file.fileName());
+            }
+            missingBlock.fill(std::numeric_limits<double>::quiet_NaN(), blockRows);
+            return missingBlock.constData();
+        }
+        recency.push_front(key);
+        m.use = recency.begin();
+        it = mapped.insert(key, m);
+    }
+    else{
+        recency.splice(recency.begin(), recency, it->use);
+    }
+    const double *values = reinterpret_cast<const double *>(it->address);
+    recent[column] = RecentBlock{blockIndex, values};
+    return values;
+}
+
+// Maps a column block into memory, or returns nullptr if it cannot be
+uchar *ColumnPager::mapBlock(int column, qint64 blockIndex){
+    // All blocks but the last are full, so the layout of a block only depends on its own row count
+    const qint64 rowsInBlock = qMin(qint64(blockRows), rows - blockIndex*blockRows);
+    const qint64 offset = dataOffset + qint64(sizeof(double)) * (blockIndex*blockRows*numColumns + column*rowsInBlock);
+    return file.map(offset, qint64(sizeof(double)) * rowsInBlock);
+}
+
+// Unmaps the least recently used block. Caller must hold the mutex.
+void ColumnPager::evictOldest(){
+    auto oldest = mapped.find(recency.back());
+    recency.pop_back();
+    const int column = int(oldest.key() % numColumns);
+    if(recent.at(column).values == reinterpret_cast<const double *>(oldest->address)){
+        recent[column] = RecentBlock{-1, nullptr};
+    }
+    file.unmap(oldest->address);
+    mapped.erase(oldest);
+}
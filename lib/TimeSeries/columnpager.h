@@ -0,0 +1,66 @@
+#ifndef COLUMNPAGER_H
+#define COLUMNPAGER_H
+
+#include <QAtomicInt>
+#include <QFile>
+#include <QHash>
+#include <QMutex>
+#include <QVector>
+#include <list>
+
+// Default limit on the amount of column data mapped into memory at once
+#define PAGER_DEFAULT_BUDGET (Q_INT64_C(256)*1024*1024)
+
+/**
+ * @brief The ColumnPager class gives access to the columns of a TimeSeriesCache file without loading them.
+ * Columns are stored block by block, and blocks are memory-mapped only when a value inside them is requested.
+ * Once more than [budget] bytes are mapped, the least recently used blocks are unmapped, so resident memory
+ * stays bounded no matter how large the file is.
+ *
+ * A block that cannot be mapped reads as NaN, and the pager remembers the failure (see hasError). Callers that hand
+ * results to the user check it, so that values that were never read are not mistaken for data.
+ */
+class ColumnPager
+{
+public:
+    ColumnPager(const QString &fileName, qint64 dataOffset, qint64 numRows, int numColumns, int blockRows,
+                qint64 budget = PAGER_DEFAULT_BUDGET);
+    ~ColumnPager();
+    bool open();
+    qint64 numRows() const;
+    qreal value(int column, qint64 row);
+    void read(int column, qint64 start, qint64 count, qreal *out);
+    bool hasError() const;
+    QString getErrorString();
+
+private:
+    struct MappedBlock{
+        uchar *address;
+        std::list<qint64>::iterator use; // Position in the recency list
+    };
+    // Most recently used block for each column, for fast sequential access
+    struct RecentBlock{
+        qint64 block;
+        const double *values;
+    };
+
+    const double *block(int column, qint64 block);
+    uchar *mapBlock(int column, qint64 block);
+    void evictOldest();
+
+    QFile file;
+    QMutex mutex;
+    qint64 dataOffset;
+    qint64 rows;
+    int numColumns;
+    int blockRows;
+    int maxMappedBlocks;
+    QHash<qint64, MappedBlock> mapped;
+    std::list<qint64> recency; // Keys of the mapped blocks, most recently used first
+    QVector<RecentBlock> recent;
+    QVector<double> missingBlock;
+    QAtomicInt failed;
+    QString errorString;
+};
+
+#endif // COLUMNPAGER_H
@@ -0,0 +1,302 @@
+#include "csvreader.h"
+#include <QThread>
+#include <QtConcurrent>
+#include <climits>
+#include <cstring>
+#include <utility>
+
+namespace {
+// Whitespace removed by QString::trimmed() and matched by "\s", restricted to ASCII
+inline bool isSpace(char c){
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+// Powers of ten that are exactly representable as a double
+const double exactPowersOfTen[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+                                   1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+const int maxExactPowerOfTen = 22;
+const quint64 maxExactMantissa = Q_UINT64_C(1) << 53;
+
+// A newline-aligned slice of the file, parsed independently of the others
+struct Chunk{
+    const char *begin;
+    const char *end;
+    std::vector<TimeSeriesColumn> columns;
+    LoadProgress *progress;
+    const QVector<bool> *selected;
+};
+
+void parseChunk(Chunk &chunk){
+    CSVReader::parseRows(chunk.begin, chunk.end, chunk.columns, chunk.progress, *chunk.selected);
+}
+}
+
+/**
+ * @brief CSVReader::nextLine Finds the start of the line following the one starting at begin
+ * @return Pointer to the first byte after the next newline, or end if there is none
+ */
+const char *CSVReader::nextLine(const char *begin, const char *end){
+    const void *newline = memchr(begin, '\n', size_t(end - begin));
+    return (newline != nullptr) ? static_cast<const char *>(newline) + 1 : end;
+}
+
+/**
+ * @brief CSVReader::toDouble Converts a single trimmed field to a double.
+ * Plain decimal numbers ([-]digits[.digits][e[+-]digits]) with at most 19 significant digits are converted
+ * exactly using only one multiplication or division by an exact power of ten. Anything else is handed to
+ * QString::toDouble(), so results (including 0 for invalid fields) are identical to the QString based parser.
+ */
+qreal CSVReader::toDouble(const char *begin, const char *end){
+    if(begin == end)
+        return 0;
+
+    const char *p = begin;
+    bool negative = false;
+    if(*p == '-'){
+        negative = true;
+        ++p;
+    }
+
+    quint64 mantissa = 0;
+    int significantDigits = 0;
+    int exponent = 0;
+    bool valid = true;
+
+    // Integer part
+    const char *intStart = p;
+    while(p != end && *p >= '0' && *p <= '9'){
+        int digit = *p - '0';
+        if(mantissa != 0 || digit != 0){
+            if(++significantDigits > 19){
+                valid = false;
+                break;
+            }
+            mantissa = mantissa*10 + quint64(digit);
+        }
+        ++p;
+    }
+    if(p == intStart)
+        valid = false;
+
+    // Fractional part
+    if(valid && p != end && *p == '.'){
+        ++p;
+        const char *fracStart = p;
+        while(p != end && *p >= '0' && *p <= '9'){
+            int digit = *p - '0';
+            if(mantissa != 0 || digit != 0){
+                if(++significantDigits > 19){
+                    valid = false;
+                    break;
+                }
+                mantissa = mantissa*10 + quint64(digit);
+            }
+            --exponent;
+            ++p;
+        }
+        if(p == fracStart)
+            valid = false;
+    }
+
+    // Exponent
+    if(valid && p != end && (*p == 'e' || *p == 'E')){
+        ++p;
+        bool negativeExponent = false;
+        if(p != end && (*p == '+' || *p == '-')){
+            negativeExponent = (*p == '-');
+            ++p;
+        }
+        const char *expStart = p;
+        int expValue = 0;
+        while(p != end && *p >= '0' && *p <= '9' && (p - expStart) < 4){
+            expValue = expValue*10 + (*p - '0');
+            ++p;
+        }
+        if(p == expStart)
+            valid = false;
+        exponent += negativeExponent ? -expValue : expValue;
+    }
+
+    if(valid && p == end && mantissa <= maxExactMantissa && !(negative && mantissa == 0)){
+        double value = double(mantissa);
+        if(mantissa == 0 || exponent == 0){
+            return negative ? -value : value;
+        }
+        if(exponent > 0 && exponent <= maxExactPowerOfTen){
+            value *= exactPowersOfTen[exponent];
+            return negative ? -value : value;
+        }
+        if(exponent < 0 && -exponent <= maxExactPowerOfTen){
+            value /= exactPowersOfTen[-exponent];
+            return negative ? -value : value;
+        }
+    }
+
+    // Uncommon format (signs, hex, inf/nan, long mantissas, etc.): defer to Qt.
+    // toDouble is intrinsically safe i.e. it always returns a valid double (0 in case of failure)
+    return QString::fromUtf8(begin, int(end - begin)).toDouble();
+}
+
+/**
+ * @brief CSVReader::estimateRows Guesses the number of lines in a block of CSV text from the average length of
+ * its first few lines. Used only to reserve column storage.
+ */
+int CSVReader::estimateRows(const char *begin, const char *end){
+    const int sampleLines = 64;
+    const char *p = begin;
+    int lines = 0;
+    while(p < end && lines < sampleLines){
+        p = nextLine(p, end);
+        ++lines;
+    }
+    if(p >= end || p == begin)
+        return lines;
+    qint64 estimate = qint64(end - begin) * lines / qint64(p - begin);
+    return int(qMin(estimate, qint64(INT_MAX/2)));
+}
+
+/**
+ * @brief CSVReader::selectColumns Makes the mask of fields to parse
+ * @param selectedColumns Names of the columns to parse, or empty for all of them
+ * @param timeColumn Always parsed, whether it is selected or not
+ */
+QVector<bool> CSVReader::selectColumns(const QStringList &header, const QStringList &selectedColumns, int timeColumn){
+    QVector<bool> selected(header.size(), selectedColumns.isEmpty());
+    for(int i=0; i<header.size(); i++){
+        if(i == timeColumn || selectedColumns.contains(header.at(i)))
+            selected[i] = true;
+    }
+    return selected;
+}
+
+/**
+ * @brief CSVReader::parseRows Parses every line in [begin, end) and appends one value per line to each column.
+ * Missing fields in short rows are filled with 0, and extra fields in long rows are ignored. Blank lines
+ * produce a row of zeros, just as they do when read line by line.
+ * @param columns One list per header column. Values are appended to the existing contents.
+ * @param progress If given, receives the number of bytes parsed, and can stop parsing early
+ * @param selected If not empty, one flag per header column. Only columns whose flag is set are filled in.
+ * @return false if parsing was canceled before the end
+ */
+bool CSVReader::parseRows(const char *begin, const char *end, std::vector<TimeSeriesColumn> &columns, LoadProgress *progress,
+                          const QVector<bool> &selected){
+    // Fields past the last selected one are never looked at
+    int numColumns = int(columns.size());
+    if(!selected.isEmpty()){
+        numColumns = qMin(numColumns, selected.lastIndexOf(true) + 1);
+    }
+    const bool skipping = !selected.isEmpty() && selected.indexOf(false) >= 0;
+
+    const int rows = estimateRows(begin, end);
+    for(int col=0; col<numColumns; col++){
+        if(!skipping || selected.at(col))
+            columns[col].reserve(columns[col].size() + rows);
+    }
+
+    const char *line = begin;
+    const char *reported = begin;
+    int linesSinceReport = 0;
+    while(line < end){
+        if(progress != nullptr && ++linesSinceReport == CSV_PROGRESS_LINES){
+            progress->add(line - reported);
+            reported = line;
+            linesSinceReport = 0;
+            if(progress->isCanceled())
+                return false;
+        }
+        const char *next = nextLine(line, end);
+
+        // Trim the line, including the newline character(s)
+        const char *field = line;
+        const char *lineEnd = next;
+        while(field < lineEnd && isSpace(*field))
+            ++field;
+        while(lineEnd > field && isSpace(lineEnd[-1]))
+            --lineEnd;
+
+        int col = 0;
+        while(col < numColumns){
+            const void *comma = memchr(field, ',', size_t(lineEnd - field));
+            const char *fieldEnd = (comma != nullptr) ? static_cast<const char *>(comma) : lineEnd;
+
+            if(!skipping || selected.at(col)){
+                // Whitespace around the separator is not part of the field
+                const char *valueStart = field;
+                const char *valueEnd = fieldEnd;
+                while(valueStart < valueEnd && isSpace(*valueStart))
+                    ++valueStart;
+                while(valueEnd > valueStart && isSpace(valueEnd[-1]))
+                    --valueEnd;
+
+                columns[col].append(toDouble(valueStart, valueEnd));
+            }
+            ++col;
+
+            if(comma == nullptr)
+                break;
+            field = fieldEnd + 1;
+        }
+        // Short row: give the remaining columns a zero
+        for(; col < numColumns; ++col){
+            if(!skipping || selected.at(col))
+                columns[col].append(0);
+        }
+        line = next;
+    }
+    if(progress != nullptr){
+        progress->add(end - reported);
+        return !progress->isCanceled();
+    }
+    return true;
+}
+
+/**
+ * @brief CSVReader::parseRowsParallel Same as parseRows, but splits [begin, end) into newline-aligned chunks that
+ * are parsed on all available cores. Chunks are stitched back together in file order, so the result is identical
+ * to that of parseRows.
+ * @return false if parsing was canceled before the end
+ */
+bool CSVReader::parseRowsParallel(const char *begin, const char *end, std::vector<TimeSeriesColumn> &columns, LoadProgress *progress,
+                                  const QVector<bool> &selected){
+    const qint64 length = end - begin;
+    // A few chunks per core keeps the load balanced when some lines are longer than others
+    const qint64 numChunks = qMin(qint64(QThread::idealThreadCount()) * 4, length / CSV_MIN_CHUNK_BYTES);
+    if(numChunks <= 1){
+        return parseRows(begin, end, columns, progress, selected);
+    }
+
+    std::vector<Chunk> chunks;
+    const char *chunkStart = begin;
+    for(qint64 i=1; i<=numChunks && chunkStart < end; i++){
+        // Move each boundary forward to the start of the next line
+        const char *chunkEnd = (i == numChunks) ? end : nextLine(qMax(chunkStart, begin + length * i / numChunks), end);
+        Chunk chunk;
+        chunk.begin = chunkStart;
+        chunk.end = chunkEnd;
+        chunk.columns.resize(columns.size());
+        chunk.progress = progress;
+        chunk.selected = &selected;
+        chunks.push_back(std::move(chunk));
+        chunkStart = chunkEnd;
+    }
+
+    QtConcurrent::blockingMap(chunks, parseChunk);
+    if(progress != nullptr && progress->isCanceled())
+        return false;
+
+    // Stitch the chunks together in their original order
+    for(size_t col=0; col<columns.size(); col++){
+        if(!selected.isEmpty() && (int(col) >= selected.size() || !selected.at(int(col))))
+            continue;
+        int totalRows = columns[col].size();
+        for(const Chunk &chunk: chunks){
+            totalRows += chunk.columns[col].size();
+        }
+        columns[col].reserve(totalRows);
+        for(Chunk &chunk: chunks){
+            columns[col].append(chunk.columns[col].constData(), chunk.columns[col].size());
+            chunk.columns[col] = TimeSeriesColumn(); // Release each piece as soon as it has been copied
+        }
+    }
+    return true;
+}
@@ -0,0 +1,36 @@
+#ifndef CSVREADER_H
+#define CSVREADER_H
+
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+#include "loadprogress.h"
+#include "timeseriescolumn.h"
+
+// Files smaller than this are parsed on a single thread
+#define CSV_MIN_CHUNK_BYTES (4*1024*1024)
+// Lines parsed between progress reports (and checks for cancellation)
+#define CSV_PROGRESS_LINES 65536
+
+/**
+ * CSVReader works directly on the raw bytes of a (usually memory-mapped) CSV file, without building a QString
+ * for every line. Values produced are the same as those from splitting each trimmed line with REGEX_COMMASEP and
+ * calling QString::toDouble() on every field. Only ASCII whitespace is treated as a separator.
+ *
+ * The parsers can be given a mask of the fields to keep. Fields that are not selected are stepped over without
+ * being trimmed or converted, their columns are left untouched, and the rest of a line is not scanned at all once
+ * the last selected field has been read.
+ */
+namespace CSVReader{
+    const char *nextLine(const char *begin, const char *end);
+    qreal toDouble(const char *begin, const char *end);
+    int estimateRows(const char *begin, const char *end);
+    QVector<bool> selectColumns(const QStringList &header, const QStringList &selectedColumns, int timeColumn);
+    bool parseRows(const char *begin, const char *end, std::vector<TimeSeriesColumn> &columns, LoadProgress *progress = nullptr,
+                   const QVector<bool> &selected = QVector<bool>());
+    bool parseRowsParallel(const char *begin, const char *end, std::vector<TimeSeriesColumn> &columns, LoadProgress *progress = nullptr,
+                           const QVector<bool> &selected = QVector<bool>());
+}
+
+#endif // CSVREADER_H
@@ -0,0 +1,443 @@
+#include "hdf5reader.h"
+#include "binaryreader.h"
+#include "csvreader.h"
+#include <QFile>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent>
+#include <QtEndian>
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <utility>
+#include <vector>
+#ifdef QVALIDATA_HAVE_HDF5
+#include <hdf5.h>
+#endif
+
+namespace {
+const char hdf5Signature[8] = {'\x89', 'H', 'D', 'F', '\r', '\n', '\x1a', '\n'};
+
+#ifdef QVALIDATA_HAVE_HDF5
+// Closes an HDF5 object when it goes out of scope
+class Handle{
+public:
+    Handle(hid_t id, herr_t (*closer)(hid_t)) : id(id), closer(closer) {}
+    ~Handle(){ if(id >= 0) closer(id); }
+    operator hid_t() const { return id; }
+    bool isValid() const { return id >= 0; }
+private:
+    Q_DISABLE_COPY(Handle)
+    hid_t id;
+    herr_t (*closer)(hid_t);
+};
+
+// Describes the values stored in a dataset as a RecordField, so that BinaryReader can convert them
+bool fieldOf(hid_t type, RecordField &field){
+    const size_t size = H5Tget_size(type);
+    field.offset = 0;
+    field.scale = 1;
+    field.bias = 0;
+    field.bigEndian = (H5Tget_order(type) == H5T_ORDER_BE);
+    switch(H5Tget_class(type)){
+    case H5T_FLOAT:
+        if(size == 4)
+            field.type = RecordField::Float32;
+        else if(size == 8)
+            field.type = RecordField::Float64;
+        else
+            return false;
+        return true;
+    case H5T_INTEGER:{
+        const bool isSigned = (H5Tget_sign(type) == H5T_SGN_2);
+        switch(size){
+        case 1: field.type = isSigned ? RecordField::Int8 : RecordField::UInt8; return true;
+        case 2: field.type = isSigned ? RecordField::Int16 : RecordField::UInt16; return true;
+        case 4: field.type = isSigned ? RecordField::Int32 : RecordField::UInt32; return true;
+        case 8: field.type = isSigned ? RecordField::Int64 : RecordField::UInt64; return true;
+        default: return false;
+        }
+    }
+    default:
+        return false;
+    }
+}
+
+// How the chunks of a dataset were stored
+struct Pipeline{
+    QVector<H5Z_filter_t> filters; // In the order they were applied when writing
+    qint64 chunkRows;
+    RecordField field;
+    int valueSize;
+};
+
+// One stored chunk of a dataset, and where the rows wanted from it go
+struct ChunkJob{
+    QByteArray data;    // As stored in the file, i.e. usually compressed
+    quint32 filterMask; // Filters that were skipped for this chunk
+    int skip;           // Rows at the start of the chunk that are not wanted
+    int count;          // Rows wanted
+    double *out;
+};
+
+// Undoes the shuffle filter, which stores the first byte of every value, then the second byte of every value, etc.
+QByteArray unshuffle(const QByteArray &in, int valueSize){
+    const int n = in.size() / valueSize;
+    QByteArray out(in.size(), '\0');
+    const char *src = in.constData();
+    char *dst = out.data();
+    for(int b=0; b<valueSize; b++){
+        for(int i=0; i<n; i++){
+            dst[i*valueSize + b] = src[b*n + i];
+        }
+    }
+    // Bytes of an incomplete last value are not shuffled
+    memcpy(dst + n*valueSize, src + n*valueSize, size_t(in.size() - n*valueSize));
+    return out;
+}
+
+// Decompresses a chunk and converts the wanted rows. Runs on any thread.
+bool decodeChunk(const ChunkJob &job, const Pipeline &pipeline){
+    QByteArray data = job.data;
+    for(int i=pipeline.filters.size()-1; i>=0; i--){
+        if(job.filterMask & (1u << i))
+            continue;
+        if(pipeline.filters.at(i) == H5Z_FILTER_DEFLATE){
+            // qUncompress expects the uncompressed size in front of the zlib stream
+            QByteArray framed(4, '\0');
+            qToBigEndian<quint32>(quint32(pipeline.chunkRows * pipeline.valueSize), reinterpret_cast<uchar *>(framed.data()));
+            framed.append(data);
+            data = qUncompress(framed);
+        }
+        else{
+            data = unshuffle(data, pipeline.valueSize);
+        }
+    }
+    if(data.size() < qint64(job.skip + job.count) * pipeline.valueSize)
+        return false;
+    const uchar *values = reinterpret_cast<const uchar *>(data.constData()) + qint64(job.skip) * pipeline.valueSize;
+    BinaryReader::decodeField(values, pipeline.valueSize, job.count, pipeline.field, job.out);
+    return true;
+}
+
+// Reads rows through the HDF5 library, which converts them to doubles
+bool readSlab(hid_t dataset, qint64 first, qint64 count, double *out){
+    Handle space(H5Dget_space(dataset), H5Sclose);
+    hsize_t start[1] = {hsize_t(first)};
+    hsize_t n[1] = {hsize_t(count)};
+    if(!space.isValid() || H5Sselect_hyperslab(space, H5S_SELECT_SET, start, nullptr, n, nullptr) < 0)
+        return false;
+    Handle memory(H5Screate_simple(1, n, nullptr), H5Sclose);
+    return memory.isValid() && H5Dread(dataset, H5T_NATIVE_DOUBLE, memory, space, H5P_DEFAULT, out) >= 0;
+}
+
+// Finds out whether the chunks of a dataset can be decompressed here
+bool directPipeline(hid_t dataset, Pipeline &pipeline){
+#if H5_VERSION_GE(1, 10, 2)
+    Handle type(H5Dget_type(dataset), H5Tclose);
+    Handle plist(H5Dget_create_plist(dataset), H5Pclose);
+    hsize_t chunkDims[1];
+    if(!type.isValid() || !plist.isValid() || !fieldOf(type, pipeline.field) ||
+            H5Pget_layout(plist) != H5D_CHUNKED || H5Pget_chunk(plist, 1, chunkDims) != 1)
+        return false;
+    pipeline.chunkRows = qint64(chunkDims[0]);
+    pipeline.valueSize = pipeline.field.size();
+    const int numFilters = H5Pget_nfilters(plist);
+    for(int i=0; i<numFilters; i++){
+        unsigned int flags;
+        size_t numValues = 0;
+        unsigned int config;
+        const H5Z_filter_t filter = H5Pget_filter2(plist, unsigned(i), &flags, &numValues, nullptr, 0, nullptr, &config);
+        if(filter != H5Z_FILTER_DEFLATE && filter != H5Z_FILTER_SHUFFLE)
+            return false;
+        pipeline.filters.append(filter);
+    }
+    return pipeline.chunkRows > 0 && pipeline.chunkRows * pipeline.valueSize <= INT_MAX;
+#else
+    Q_UNUSED(dataset)
+    Q_UNUSED(pipeline)
+    return false;
+#endif
+}
+#endif
+}
+
+HDF5Reader::HDF5Reader()
+{
+    file = -1;
+    numRows = 0;
+}
+
+HDF5Reader::~HDF5Reader(){
+    close();
+}
+
+/**
+ * @brief HDF5Reader::isHDF5 Checks for the HDF5 signature at the start of a file. Works without HDF5 support.
+ */
+bool HDF5Reader::isHDF5(const QString &fileName){
+    QFile f(fileName);
+    return f.open(QFile::ReadOnly) && f.read(sizeof(hdf5Signature)) == QByteArray(hdf5Signature, sizeof(hdf5Signature));
+}
+
+// True if this build can read HDF5 files
+bool HDF5Reader::available(){
+#ifdef QVALIDATA_HAVE_HDF5
+    return true;
+#else
+    return false;
+#endif
+}
+
+void HDF5Reader::close(){
+#ifdef QVALIDATA_HAVE_HDF5
+    if(file >= 0)
+        H5Fclose(hid_t(file));
+#endif
+    file = -1;
+    names.clear();
+    numRows = 0;
+}
+
+/**
+ * @brief HDF5Reader::open Opens an HDF5 file and finds the datasets that can be read as columns
+ * @return false if the file cannot be opened or has no usable datasets. Call getErrorString() for details.
+ */
+bool HDF5Reader::open(const QString &fileName){
+    close();
+    this->fileName = fileName;
+#ifdef QVALIDATA_HAVE_HDF5
+    // Errors are reported through getErrorString rather than printed by the library
+    H5Eset_auto2(H5E_DEFAULT, nullptr, nullptr);
+    file = H5Fopen(QFile::encodeName(fileName).constData(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    H5G_info_t info;
+    if(file < 0 || H5Gget_info(hid_t(file), &info) < 0){
+        errorString = "The file cannot be opened as an HDF5 file.";
+        return false;
+    }
+
+    QStringList candidates;
+    QList<qint64> sizes;
+    for(hsize_t i=0; i<info.nlinks; i++){
+        const ssize_t length = H5Lget_name_by_idx(hid_t(file), ".", H5_INDEX_NAME, H5_ITER_INC, i, nullptr, 0, H5P_DEFAULT);
+        if(length <= 0)
+            continue;
+        QByteArray name(int(length) + 1, '\0');
+        H5Lget_name_by_idx(hid_t(file), ".", H5_INDEX_NAME, H5_ITER_INC, i, name.data(), size_t(length) + 1, H5P_DEFAULT);
+        name.truncate(int(length));
+
+        // Groups and other objects fail to open as datasets, and are skipped
+        Handle dataset(H5Dopen2(hid_t(file), name.constData(), H5P_DEFAULT), H5Dclose);
+        if(!dataset.isValid())
+            continue;
+        Handle type(H5Dget_type(dataset), H5Tclose);
+        Handle space(H5Dget_space(dataset), H5Sclose);
+        RecordField field;
+        hsize_t dims[1];
+        if(!fieldOf(type, field) || H5Sget_simple_extent_ndims(space) != 1 || H5Sget_simple_extent_dims(space, dims, nullptr) < 0)
+            continue;
+        candidates.append(QString::fromUtf8(name));
+        sizes.append(qint64(dims[0]));
+    }
+    if(candidates.isEmpty()){
+        errorString = "The file has no one-dimensional numeric datasets.";
+        return false;
+    }
+
+    int timeDataset = 0;
+    for(int i=0; i<candidates.size(); i++){
+        if(candidates.at(i).compare("time", Qt::CaseInsensitive) == 0)
+            timeDataset = i;
+    }
+    numRows = sizes.at(timeDataset);
+    if(numRows > INT_MAX){
+        errorString = "The datasets have too many rows.";
+        return false;
+    }
+    names.append(candidates.at(timeDataset));
+    for(int i=0; i<candidates.size(); i++){
+        if(i != timeDataset && sizes.at(i) == numRows)
+            names.append(candidates.at(i));
+    }
+    return true;
+#else
+    errorString = "This build of QValiData cannot read HDF5 files. Build it with CONFIG+=hdf5.";
+    return false;
+#endif
+}
+
+/**
+ * @brief HDF5Reader::columnNames Names of the datasets that are read as columns. The first holds the time.
+ */
+QStringList HDF5Reader::columnNames() const{
+    return names;
+}
+
+/**
+ * @brief HDF5Reader::read Reads the open file into a TimeSeries
+ * @param ts An empty TimeSeries to fill. Its time column is the first.
+ * @param selectedColumns Names of the datasets to read now, or empty for all of them. The others are read if they
+ * are used later on, as in TimeSeries::fromCSV.
+ * @param rangeStart Rows before this time are not read
+ * @param rangeEnd Rows after this time are not read
+ * @param progress If given, follows the import and can cancel it
+ * @param maxRows If not negative, only this many rows from the start are read, whatever the range
+ * @return false if the datasets cannot be read or the import was canceled
+ */
+bool HDF5Reader::read(TimeSeries *ts, const QStringList &selectedColumns, double rangeStart, double rangeEnd,
+                      LoadProgress *progress, int maxRows){
+    if(file < 0){
+        errorString = "No HDF5 file is open.";
+        return false;
+    }
+    const QVector<bool> selected = CSVReader::selectColumns(names, selectedColumns, 0);
+    if(progress != nullptr){
+        progress->setTotal(numRows * selected.count(true));
+    }
+
+    std::vector<TimeSeriesColumn> columns(names.size());
+    qint64 firstRow;
+    if(!readTime(rangeStart, rangeEnd, maxRows, progress, columns[0], firstRow)){
+        return false;
+    }
+    const int rows = columns[0].size();
+    for(int col=1; col<names.size(); col++){
+        if(!selected.at(col))
+            continue;
+        double *out = columns[col].resize(rows);
+        if(!readRows(names.at(col), firstRow, rows, progress, out)){
+            return false;
+        }
+    }
+
+    for(int col=0; col<names.size(); col++){
+        if(selected.at(col))
+            ts->addColumn(names.at(col), std::move(columns[col]));
+        else
+            ts->addColumn(names.at(col));
+    }
+    ts->setSourceFiles(QStringList(fileName));
+    ts->setTimeColumn(0);
+    ts->compact();
+    return true;
+}
+
+/**
+ * Reads the rows of the time dataset that lie within [rangeStart, rangeEnd]. The time is sorted, so it is scanned
+ * block by block from the start, and the scan stops as soon as the range has been passed.
+ */
+bool HDF5Reader::readTime(double rangeStart, double rangeEnd, int maxRows, LoadProgress *progress, TimeSeriesColumn &time, qint64 &firstRow){
+    const qint64 limit = (maxRows >= 0) ? qMin(numRows, qint64(maxRows)) : numRows;
+    QVector<double> block;
+    firstRow = -1;
+    for(qint64 start=0; start<limit; start+=HDF5_READ_ROWS){
+        const int n = int(qMin(qint64(HDF5_READ_ROWS), limit - start));
+        block.resize(n);
+        if(!readRows(names.first(), start, n, progress, block.data()))
+            return false;
+        const double *begin = block.constData();
+        const double *first = begin;
+        if(firstRow < 0){
+            first = std::lower_bound(begin, begin + n, rangeStart);
+            if(first == begin + n)
+                continue;
+            firstRow = start + (first - begin);
+        }
+        const double *last = std::upper_bound(first, begin + n, rangeEnd);
+        time.append(first, int(last - first));
+        if(last != begin + n)
+            break;
+    }
+    if(firstRow < 0){
+        firstRow = 0;
+    }
+    return true;
+}
+
+// Reads [count] rows of a dataset, starting at [firstRow], as doubles
+bool HDF5Reader::readRows(const QString &name, qint64 firstRow, int count, LoadProgress *progress, double *out){
+#ifdef QVALIDATA_HAVE_HDF5
+    Handle dataset(H5Dopen2(hid_t(file), name.toUtf8().constData(), H5P_DEFAULT), H5Dclose);
+    if(!dataset.isValid()){
+        errorString = QString("Dataset '%1' cannot be read.").arg(name);
+        return false;
+    }
+    errorString = QString("Dataset '%1' cannot be read or decompressed.").arg(name);
+
+    Pipeline pipeline;
+    const qint64 endRow = firstRow + count;
+    if(!directPipeline(dataset, pipeline)){
+        for(qint64 row=firstRow; row<endRow; row+=HDF5_READ_ROWS){
+            const qint64 n = qMin(qint64(HDF5_READ_ROWS), endRow - row);
+            if(!readSlab(dataset, row, n, out + (row - firstRow)))
+                return false;
+            if(progress != nullptr){
+                progress->add(n);
+                if(progress->isCanceled())
+                    return false;
+            }
+        }
+        return true;
+    }
+
+#if H5_VERSION_GE(1, 10, 2)
+    // Fetch a batch of compressed chunks in file order, then decompress and convert all of them at once
+    const int batchSize = QThread::idealThreadCount() * HDF5_CHUNKS_PER_THREAD;
+    qint64 row = firstRow;
+    qint64 reported = firstRow;
+    while(row < endRow){
+        QVector<ChunkJob> batch;
+        while(row < endRow && batch.size() < batchSize){
+            const qint64 chunkStart = (row / pipeline.chunkRows) * pipeline.chunkRows;
+            const int n = int(qMin(chunkStart + pipeline.chunkRows, endRow) - row);
+            hsize_t offset[1] = {hsize_t(chunkStart)};
+            hsize_t storedBytes = 0;
+            if(H5Dget_chunk_storage_size(dataset, offset, &storedBytes) < 0 || storedBytes == 0){
+                // Chunk never written: the library fills in the dataset's fill value
+                if(!readSlab(dataset, row, n, out + (row - firstRow)))
+                    return false;
+            }
+            else{
+                ChunkJob job;
+                job.data.resize(int(storedBytes));
+                uint32_t filterMask = 0;
+                if(H5Dread_chunk(dataset, H5P_DEFAULT, offset, &filterMask, job.data.data()) < 0)
+                    return false;
+                job.filterMask = filterMask;
+                job.skip = int(row - chunkStart);
+                job.count = n;
+                job.out = out + (row - firstRow);
+                batch.append(job);
+            }
+            row += n;
+        }
+
+        QAtomicInt failed(0);
+        QtConcurrent::blockingMap(batch, [&](const ChunkJob &job){
+            if(!decodeChunk(job, pipeline))
+                failed.store(1);
+        });
+        if(failed.load() != 0)
+            return false;
+        if(progress != nullptr){
+            progress->add(row - reported);
+            reported = row;
+            if(progress->isCanceled())
+                return false;
+        }
+    }
+#endif
+    return true;
+#else
+    Q_UNUSED(name)
+    Q_UNUSED(firstRow)
+    Q_UNUSED(count)
+    Q_UNUSED(progress)
+    Q_UNUSED(out)
+    return false;
+#endif
+}
+
+QString HDF5Reader::getErrorString() const{
+    return errorString;
+}
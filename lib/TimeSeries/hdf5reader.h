@@ -0,0 +1,56 @@
+#ifndef HDF5READER_H
+#define HDF5READER_H
+
+#include <QString>
+#include <QStringList>
+#include <limits>
+#include "loadprogress.h"
+#include "timeseries.h"
+
+// Rows read at a time when a dataset cannot be read chunk by chunk
+#define HDF5_READ_ROWS (1024*1024)
+// Compressed chunks read before they are decompressed together, per core
+#define HDF5_CHUNKS_PER_THREAD 4
+
+/**
+ * @brief The HDF5Reader class imports HDF5 files whose root group holds one 1-D numeric dataset per column, all of
+ * the same length. The dataset named "time" (in any case) holds the time; if there is none, the first dataset in
+ * name order does. Other datasets (groups, 2-D arrays, datasets of another length) are ignored.
+ *
+ * Only the datasets and time range asked for are read. Chunked datasets compressed with deflate (optionally after
+ * shuffle) are read chunk by chunk: the compressed chunks are fetched from the file in order, and then
+ * decompressed and converted on all cores at once. Any other layout is read through the HDF5 library.
+ *
+ * HDF5 support is optional. Without it (build without CONFIG+=hdf5), HDF5 files are recognised but cannot be opened.
+ */
+class HDF5Reader
+{
+public:
+    HDF5Reader();
+    ~HDF5Reader();
+    static bool isHDF5(const QString &fileName);
+    static bool available();
+
+    bool open(const QString &fileName);
+    QStringList columnNames() const;
+    bool read(TimeSeries *ts, const QStringList &selectedColumns = QStringList(),
+              double rangeStart = -std::numeric_limits<double>::infinity(),
+              double rangeEnd = std::numeric_limits<double>::infinity(),
+              LoadProgress *progress = nullptr, int maxRows = -1);
+    QString getErrorString() const;
+
+private:
+    Q_DISABLE_COPY(HDF5Reader)
+    void close();
+    bool readTime(double rangeStart, double rangeEnd, int maxRows, LoadProgress *progress, TimeSeriesColumn &time, qint64 &firstRow);
+    bool readRows(const QString &name, qint64 firstRow, int count, LoadProgress *progress, double *out);
+
+    QString fileName;
+    qint64 file; // hid_t of the open file, or -1
+    // Usable datasets, time first
+    QStringList names;
+    qint64 numRows;
+    QString errorString;
+};
+
+#endif // HDF5READER_H
@@ -0,0 +1,32 @@
+#ifndef LOADPROGRESS_H
+#define LOADPROGRESS_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+/**
+ * @brief The LoadProgress class is shared between a thread loading data and the thread that started it. The loader
+ * reports how much of the input it has processed and checks whether it should give up; the other side polls the
+ * progress and may ask it to stop. All members are safe to use from any thread.
+ */
+class LoadProgress
+{
+public:
+    LoadProgress(): done(0), total(0), canceled(0) {}
+
+    void setTotal(qint64 total) { this->total.store(total); done.store(0); }
+    void add(qint64 amount) { done.fetchAndAddRelaxed(amount); }
+    int percent() const {
+        const qint64 t = total.load();
+        return (t > 0) ? int(qBound(qint64(0), done.load() * 100 / t, qint64(100))) : 0;
+    }
+    void cancel() { canceled.store(1); }
+    bool isCanceled() const { return canceled.load() != 0; }
+
+private:
+    QAtomicInteger<qint64> done;
+    QAtomicInteger<qint64> total;
+    QAtomicInt canceled;
+};
+
+#endif // LOADPROGRESS_H
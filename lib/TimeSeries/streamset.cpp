@@ -0,0 +1,193 @@
+#include "streamset.h"
+
+StreamSet::StreamSet()
+{
+}
+
+/**
+ * @brief StreamSet::addStream Adds a stream. Its time column must already be set.
+ * @return Index of the stream
+ */
+int StreamSet::addStream(const QString &name, QSharedPointer<TimeSeries> data){
+    names.append(name);
+    streams.append(data);
+    return streams.size() - 1;
+}
+
+int StreamSet::numStreams() const{
+    return streams.size();
+}
+
+QString StreamSet::streamName(int stream) const{
+    return names.at(stream);
+}
+
+// Returns -1 if there is no stream of that name
+int StreamSet::indexOfStream(const QString &name) const{
+    return names.indexOf(name);
+}
+
+TimeSeries *StreamSet::stream(int stream) const{
+    return streams.at(stream).data();
+}
+
+/**
+ * @brief StreamSet::handle Looks up the first stream that has a column of the given role. Streams without samples are
+ * skipped, as they have nothing to hold. Must be called on the thread that owns the streams, as it may read in the
+ * column.
+ */
+StreamHandle StreamSet::handle(Channel::Role role) const{
+    for(int s=0; s<streams.size(); s++){
+        if(streams.at(s)->numRows() == 0)
+            continue;
+        const ColumnHandle column = streams.at(s)->handle(role);
+        if(column.isValid())
+            return StreamHandle{s, column};
+    }
+    return StreamHandle();
+}
+
+/**
+ * @brief StreamSet::handle Looks up a column by name, either as "stream/column" or by column name alone, in which case
+ * the first stream that has it is taken. See handle(Channel::Role).
+ */
+StreamHandle StreamSet::handle(const QString &columnName) const{
+    const int slash = columnName.indexOf('/');
+    const int named = (slash > 0) ? indexOfStream(columnName.left(slash)) : -1;
+    for(int s=0; s<streams.size(); s++){
+        if((named >= 0 && s != named) || streams.at(s)->numRows() == 0)
+            continue;
+        const ColumnHandle column = streams.at(s)->handle((named >= 0) ? columnName.mid(slash + 1) : columnName);
+        if(column.isValid())
+            return StreamHandle{s, column};
+    }
+    return StreamHandle();
+}
+
+// Time of the earliest sample of any stream, or 0 if there are none
+double StreamSet::startTime() const{
+    bool found = false;
+    double start = 0;
+    for(const QSharedPointer<TimeSeries> &s: streams){
+        if(s->numRows() > 0 && (!found || s->timeColumnData()->first() < start)){
+            start = s->timeColumnData()->first();
+            found = true;
+        }
+    }
+    return start;
+}
+
+// Time of the latest sample of any stream, or 0 if there are none
+double StreamSet::endTime() const{
+    bool found = false;
+    double end = 0;
+    for(const QSharedPointer<TimeSeries> &s: streams){
+        if(s->numRows() > 0 && (!found || s->timeColumnData()->last() > end)){
+            end = s->timeColumnData()->last();
+            found = true;
+        }
+    }
+    return end;
+}
+
+/**
+ * @brief StreamSet::iterator Returns an iterator whose first call to next() moves to the first sample at or after a
+ * given time. Streams must not be added while it is in use.
+ */
+StreamIterator StreamSet::iterator(double from) const{
+    return StreamIterator(this, from);
+}
+
+StreamIterator::StreamIterator(const StreamSet *set, double from) : set(set)
+{
+    currentTime = from;
+    currentStream = -1;
+    const int numStreams = set->numStreams();
+    current.fill(-1, numStreams);
+
+    for(int s=0; s<numStreams; s++){
+        TimeSeries *ts = set->stream(s);
+        if(ts->numRows() == 0)
+            continue;
+        // Start just before the first sample at or after from
+        int row = (from > ts->timeColumnData()->first()) ? ts->indexOfLEQ(from, 0, ts->numRows() - 1) : -1;
+        while(row >= 0 && ts->timeColumnData()->at(row) >= from){
+            --row;
+        }
+        current[s] = row;
+        push(s);
+    }
+}
+
+// Queues the sample of a stream that follows its current one, if there is one
+void StreamIterator::push(int stream){
+    TimeSeries *ts = set->stream(stream);
+    const int nextRow = current.at(stream) + 1;
+    if(nextRow < ts->numRows()){
+        heads.push(Head(ts->timeColumnData()->at(nextRow), stream));
+    }
+}
+
+/**
+ * @brief StreamIterator::next Moves to the next sample of any stream
+ * @return false once every sample of every stream has been visited
+ */
+bool StreamIterator::next(){
+    if(heads.empty()){
+        currentStream = -1;
+        return false;
+    }
+    const Head head = heads.top();
+    heads.pop();
+    currentTime = head.first;
+    currentStream = head.second;
+    ++current[currentStream];
+    push(currentStream);
+    return true;
+}
+
+/**
+ * @brief StreamIterator::advanceTo Moves every stream to its latest sample at or before a time, as if next() had been
+ * called until then. Times must not decrease from one call to the next. Afterwards there is no current sample
+ * (stream() is -1), but rowOf and value give the held sample of each stream.
+ */
+void StreamIterator::advanceTo(double time){
+    while(!heads.empty() && heads.top().first <= time){
+        const int s = heads.top().second;
+        heads.pop();
+        ++current[s];
+        push(s);
+    }
+    currentTime = time;
+    currentStream = -1;
+}
+
+// Time of the current sample
+double StreamIterator::time() const{
+    return currentTime;
+}
+
+// Stream of the current sample
+int StreamIterator::stream() const{
+    return currentStream;
+}
+
+// Row of the current sample in its stream
+int StreamIterator::row() const{
+    return current.at(currentStream);
+}
+
+/**
+ * @brief StreamIterator::rowOf Latest row of a stream at or before the current time, or -1 if it has not started
+ */
+int StreamIterator::rowOf(int stream) const{
+    return current.at(stream);
+}
+
+/**
+ * @brief StreamIterator::value Latest value of a stream's column at or before the current time. Before the stream's
+ * first sample, that first sample is held instead, so that detectors are never fed a value from nowhere.
+ */
+qreal StreamIterator::value(const StreamHandle &handle) const{
+    return handle.column.at(qMax(current.at(handle.stream), 0));
+}
@@ -0,0 +1,89 @@
+#ifndef STREAMSET_H
+#define STREAMSET_H
+
+#include <QSharedPointer>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+#include "timeseries.h"
+
+class StreamSet;
+
+/**
+ * @brief The StreamHandle struct is a column of one stream of a StreamSet, looked up once (see StreamSet::handle) so
+ * that it can be read at every step of a StreamIterator without looking it up again.
+ */
+struct StreamHandle
+{
+    int stream;
+    ColumnHandle column;
+
+    // False if no stream has the column
+    bool isValid() const { return stream >= 0 && column.isValid(); }
+};
+
+/**
+ * @brief The StreamIterator class walks through the samples of every stream of a StreamSet in time order, as if
+ * they had been merged into a single table, without building that table. At each step it points at one sample of
+ * one stream, and keeps track of the latest sample of every other stream, so slower streams can be read alongside
+ * faster ones (sample and hold) without being resampled. Samples at the same time are visited in stream order.
+ *
+ * Nothing is copied: values are read straight from the streams' columns through StreamHandles. A detector fed at one
+ * stream's rate can call advanceTo() with the time of each of its samples, and read the held values of the others.
+ */
+class StreamIterator
+{
+public:
+    explicit StreamIterator(const StreamSet *set, double from = -std::numeric_limits<double>::infinity());
+    bool next();
+    void advanceTo(double time);
+    double time() const;
+    int stream() const;
+    int row() const;
+    int rowOf(int stream) const;
+    qreal value(const StreamHandle &handle) const;
+
+private:
+    void push(int stream);
+
+    typedef std::pair<double, int> Head;
+    const StreamSet *set;
+    // Next sample of each stream that has any left, earliest first
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    // Latest row of each stream at or before the current time, or -1 if the stream has not started yet
+    QVector<int> current;
+    double currentTime;
+    int currentStream;
+};
+
+/**
+ * @brief The StreamSet class holds sensor streams that were recorded at different rates (e.g. 100 Hz acceleration,
+ * 1 Hz pressure and irregular GPS fixes). Each stream is a TimeSeries with its own time column, so none of them
+ * has to be resampled onto a common grid. Use a StreamIterator to go through all of them together.
+ */
+class StreamSet
+{
+public:
+    StreamSet();
+    int addStream(const QString &name, QSharedPointer<TimeSeries> data);
+    int numStreams() const;
+    QString streamName(int stream) const;
+    int indexOfStream(const QString &name) const;
+    TimeSeries *stream(int stream) const;
+    StreamHandle handle(Channel::Role role) const;
+    StreamHandle handle(const QString &columnName) const;
+    double startTime() const;
+    double endTime() const;
+    StreamIterator iterator(double from = -std::numeric_limits<double>::infinity()) const;
+
+private:
+    QStringList names;
+    QVector<QSharedPointer<TimeSeries>> streams;
+};
+
+#endif // STREAMSET_H
@@ -0,0 +1,175 @@
+#include "timeindex.h"
+#include <cmath>
+
+namespace {
+// Rows read at a time while building the index
+const int indexBlockRows = 65536;
+
+TimeSegment makeSegment(int first, int last, double start, double end){
+    TimeSegment s;
+    s.first = first;
+    s.last = last;
+    s.start = start;
+    s.end = end;
+    s.period = (last > first) ? (end - start) / (last - first) : 0;
+    return s;
+}
+}
+
+TimeIndex::TimeIndex()
+{
+    mainSegment = -1;
+}
+
+void TimeIndex::clear(){
+    segmentList.clear();
+    mainSegment = -1;
+}
+
+/**
+ * @brief TimeIndex::build Splits a time column into uniformly sampled segments. Runs in a single pass over the column.
+ */
+void TimeIndex::build(const TimeSeriesColumn *time){
+    clear();
+    const int rows = time->size();
+    if(rows == 0)
+        return;
+
+    ColumnReader reader(time);
+    int first = 0;
+    double start = time->at(0);
+    double previous = start;
+    double sumDeltas = 0; // Sum of the time steps in the current segment
+    for(int blockStart=0; blockStart<rows; blockStart+=indexBlockRows){
+        const int n = qMin(indexBlockRows, rows - blockStart);
+        const double *t = reader.block(blockStart, n);
+        for(int j=(blockStart == 0) ? 1 : 0; j<n; j++){
+            const int i = blockStart + j;
+            const double delta = t[j] - previous;
+            const int steps = i - 1 - first;
+            // Compare each step to the mean of the ones before it. A segment needs one step to know its rate.
+            const double mean = (steps > 0) ? sumDeltas / steps : delta;
+            if(delta > TIME_GAP_FACTOR * mean || delta * TIME_GAP_FACTOR < mean || delta < 0){
+                segmentList.append(makeSegment(first, i - 1, start, previous));
+                first = i;
+                start = t[j];
+                sumDeltas = 0;
+            }
+            else{
+                sumDeltas += delta;
+            }
+            previous = t[j];
+        }
+    }
+    segmentList.append(makeSegment(first, rows - 1, start, previous));
+
+    mainSegment = 0;
+    for(int s=1; s<segmentList.size(); s++){
+        if(segmentList.at(s).size() > segmentList.at(mainSegment).size())
+            mainSegment = s;
+    }
+}
+
+/**
+ * @brief TimeIndex::indexOfLEQ Finds the last sample at or before a given time
+ * @param time The column the index was built from
+ * @return Index of the sample, or -1 if value comes before the first sample
+ */
+int TimeIndex::indexOfLEQ(const TimeSeriesColumn *time, double value) const{
+    if(segmentList.isEmpty() || !(value >= segmentList.first().start))
+        return -1;
+
+    // Last segment starting at or before value. There are usually only a handful.
+    int lo = 0, hi = segmentList.size() - 1;
+    while(lo < hi){
+        const int mid = (lo + hi + 1) / 2;
+        if(segmentList.at(mid).start > value)
+            hi = mid - 1;
+        else
+            lo = mid;
+    }
+    const TimeSegment &s = segmentList.at(lo);
+    if(value >= s.end || s.period <= 0)
+        return s.last;
+
+    // Estimate from the segment's rate, then step to the exact answer
+    int i = s.first + int(std::floor((value - s.start) / s.period));
+    i = qBound(s.first, i, s.last);
+    for(int step=0; step<TIME_INDEX_MAX_WALK; step++){
+        if(time->at(i) > value){
+            --i;
+        }
+        else if(i < s.last && time->at(i + 1) <= value){
+            ++i;
+        }
+        else{
+            return i;
+        }
+    }
+
+    // Irregular segment: finish with a binary search around the estimate
+    lo = s.first;
+    hi = s.last;
+    while(lo < hi){
+        const int mid = (lo + hi + 1) / 2;
+        if(time->at(mid) > value)
+            hi = mid - 1;
+        else
+            lo = mid;
+    }
+    return lo;
+}
+
+const QVector<TimeSegment> &TimeIndex::segments() const{
+    return segmentList;
+}
+
+/**
+ * @brief TimeIndex::gaps Returns the gaps between consecutive segments
+ */
+QVector<TimeGap> TimeIndex::gaps() const{
+    QVector<TimeGap> out;
+    for(int s=1; s<segmentList.size(); s++){
+        TimeGap g;
+        g.before = segmentList.at(s-1).last;
+        g.start = segmentList.at(s-1).end;
+        g.end = segmentList.at(s).start;
+        out.append(g);
+    }
+    return out;
+}
+
+int TimeIndex::segmentIndexOf(int index) const{
+    int lo = 0, hi = segmentList.size() - 1;
+    while(lo < hi){
+        const int mid = (lo + hi + 1) / 2;
+        if(segmentList.at(mid).first > index)
+            hi = mid - 1;
+        else
+            lo = mid;
+    }
+    return lo;
+}
+
+/**
+ * @brief TimeIndex::segmentOf Returns the segment containing a sample, or nullptr if the index is empty
+ */
+const TimeSegment *TimeIndex::segmentOf(int index) const{
+    return segmentList.isEmpty() ? nullptr : &segmentList.at(segmentIndexOf(index));
+}
+
+/**
+ * @brief TimeIndex::samplePeriod Time covered by one sample at the given index, i.e. its segment's period
+ */
+double TimeIndex::samplePeriod(int index) const{
+    const TimeSegment *s = segmentOf(index);
+    return (s != nullptr && s->period > 0) ? s->period : (mainSegment >= 0 ? segmentList.at(mainSegment).period : 0);
+}
+
+/**
+ * @brief TimeIndex::sampleRate Nominal sample rate of the data: that of the longest segment. Unlike the number of
+ * samples divided by the total duration, this is not thrown off by gaps.
+ */
+double TimeIndex::sampleRate() const{
+    return (mainSegment >= 0) ? segmentList.at(mainSegment).sampleRate() : 0;
+}
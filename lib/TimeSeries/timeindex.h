@@ -0,0 +1,65 @@
+#ifndef TIMEINDEX_H
+#define TIMEINDEX_H
+
+#include <QVector>
+#include "timeseriescolumn.h"
+
+// Consecutive samples further apart than this many sample periods are separated by a gap
+#define TIME_GAP_FACTOR 2.0
+// Steps taken from the estimated index before falling back to a binary search
+#define TIME_INDEX_MAX_WALK 8
+
+/**
+ * @brief The TimeSegment struct is a run of samples taken at a steady rate, without gaps
+ */
+struct TimeSegment
+{
+    int first;      // Index of the first sample
+    int last;       // Index of the last sample
+    double start;   // Time of the first sample
+    double end;     // Time of the last sample
+    double period;  // Mean time between samples
+
+    int size() const { return last - first + 1; }
+    double sampleRate() const { return (period > 0) ? 1.0/period : 0; }
+};
+
+/**
+ * @brief The TimeGap struct is a stretch of time in which the logger recorded nothing
+ */
+struct TimeGap
+{
+    int before;     // Index of the last sample before the gap
+    double start;   // Time of the last sample before the gap
+    double end;     // Time of the first sample after the gap
+};
+
+/**
+ * @brief The TimeIndex class maps times to sample indices of a sorted time column. The column is split into
+ * uniformly sampled segments at every gap (or change of sample rate). Within a segment, the index of a time is
+ * estimated from the segment's period and then corrected by a step or two, so lookups take constant time rather
+ * than a binary search over the whole column. Results are always identical to those of a binary search.
+ */
+class TimeIndex
+{
+public:
+    TimeIndex();
+    void build(const TimeSeriesColumn *time);
+    void clear();
+
+    int indexOfLEQ(const TimeSeriesColumn *time, double value) const;
+    const QVector<TimeSegment> &segments() const;
+    QVector<TimeGap> gaps() const;
+    const TimeSegment *segmentOf(int index) const;
+    double samplePeriod(int index) const;
+    double sampleRate() const;
+
+private:
+    int segmentIndexOf(int index) const;
+
+    QVector<TimeSegment> segmentList;
+    // Segment covering the most samples; its rate is the nominal rate of the data
+    int mainSegment;
+};
+
+#endif // TIMEINDEX_H
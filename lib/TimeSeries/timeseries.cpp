@@ -1,16 +1,57 @@
 #include "timeseries.h"
-#include <QtMath>
+#include "binaryreader.h"
+#include "csvreader.h"
+#include "hdf5reader.h"
+#include "timeseriescache.h"
+#include "timeseriesmerge.h"
 #include <QDebug>
 #include <QPoint>
+#include <QtConcurrent>
+#include <algorithm>
+#include <climits>
+#include <limits>
+#include <utility>
 
 TimeSeries::TimeSeries()
 {
-    data = new QList<QPair<QString, QList<qreal>>>();
     timeColumn = -1;
 }
 
-// Get a time series from CSV data
-bool TimeSeries::fromCSV(QFile *csv, int timeColumn){
+/**
+ * @brief TimeSeries::fromCSV Gets a time series from CSV data
+ * @param progress If given, follows the parse and can cancel it
+ * @param selectedColumns Names of the columns to parse now, or empty for all of them. The time column is always
+ * parsed. Other columns are skipped by the tokenizer and only read, one at a time, if they are used later on.
+ */
+bool TimeSeries::fromCSV(QFile *csv, int timeColumn, LoadProgress *progress, const QStringList &selectedColumns){
+    QStringList header;
+    std::vector<TimeSeriesColumn> parsed;
+    QVector<bool> selected;
+    if(!readCSV(csv, selectedColumns, timeColumn, progress, header, parsed, selected)){
+        return false;
+    }
+
+    for(int i=0; i<header.size(); i++){
+        if(selected.at(i))
+            addColumn(header.at(i), std::move(parsed[i]));
+        else
+            addColumn(header.at(i));
+    }
+    setSourceFiles(QStringList(csv->fileName()));
+    setTimeColumn(timeColumn);
+    compact();
+    return true;
+}
+
+/**
+ * @brief TimeSeries::readCSV Parses the selected columns of a CSV file
+ * @param header Receives the names of all columns in the file
+ * @param columns Receives one column per header column. Unselected ones are left empty.
+ * @param selected Receives the flag of each header column
+ * @return false if the file cannot be read or is empty, or if parsing was canceled
+ */
+bool TimeSeries::readCSV(QFile *csv, const QStringList &selectedColumns, int timeColumn, LoadProgress *progress,
+                         QStringList &header, std::vector<TimeSeriesColumn> &columns, QVector<bool> &selected){
     if(!csv->isOpen()){
         bool openResult = csv->open(QFile::ReadOnly); // Try to open the file if not already open
         if(!openResult){
@@ -18,45 +59,212 @@ bool TimeSeries::fromCSV(QFile *csv, int timeColumn){
         }
     }
     // Empty file check
-    if(csv->atEnd()){
+    const qint64 offset = csv->pos();
+    qint64 length = csv->size() - offset;
+    if(length <= 0){
         return false;
     }
 
-    QList<QString> header = QString(csv->readLine().trimmed()).split(REGEX_COMMASEP, QString::KeepEmptyParts);
-    QList<QList<qreal>* > data;
-    // Make the columns
-    for(int i=0; i<header.size(); i++){
-        data.append(new QList<qreal>());
-    }
-    while(!csv->atEnd()){
-        QList<QString> line = QString(csv->readLine().trimmed()).split(REGEX_COMMASEP, QString::KeepEmptyParts);
-        for(int i=0; i<header.size(); i++){
-            // Try to fill in valid numerical data, otherwise, give it a zero.
-            if(line.size() > i){
-                // toDouble is intrinsically safe i.e. it always returns a valid double (0 in case of failure)
-                data.at(i)->append(line.at(i).toDouble());
-            }
-            else{
-                data.at(i)->append(0);
-            }
+    // Parse straight out of the page cache rather than reading line by line
+    QByteArray buffer;
+    uchar *mapped = csv->map(offset, length);
+    const char *begin = reinterpret_cast<const char *>(mapped);
+    if(mapped == nullptr){
+        // Not every device can be mapped, so fall back to reading the whole thing
+        buffer = csv->readAll();
+        begin = buffer.constData();
+        length = buffer.size();
+    }
+    const char *end = begin + length;
+    const char *body = CSVReader::nextLine(begin, end);
+    if(progress != nullptr){
+        progress->setTotal(end - body);
+    }
+
+    header = QString(QByteArray::fromRawData(begin, int(body - begin))).trimmed().split(REGEX_COMMASEP, QString::KeepEmptyParts);
+    selected = CSVReader::selectColumns(header, selectedColumns, timeColumn);
+    // Make the columns. They are parsed in place and then handed over, never copied.
+    columns.resize(header.size());
+    const bool complete = CSVReader::parseRowsParallel(body, end, columns, progress, selected);
+
+    if(mapped != nullptr){
+        csv->unmap(mapped);
+    }
+    return complete;
+}
+
+/**
+ * @brief TimeSeries::fromBinary Reads a raw binary logger dump made of fixed-size records
+ * @param file The dump
+ * @param layout Layout of the records. Each field becomes a column.
+ * @param timeColumn Index of the field that holds the time
+ * @param progress If given, follows the decode and can cancel it
+ * @return true if at least one record was read
+ */
+bool TimeSeries::fromBinary(QFile *file, const RecordLayout &layout, int timeColumn, LoadProgress *progress){
+    if(!file->isOpen()){
+        bool openResult = file->open(QFile::ReadOnly); // Try to open the file if not already open
+        if(!openResult){
+            return false;
         }
     }
-    for(int i=0; i<header.size(); i++){
-        addColumn(header.at(i), *(data.at(i)));
+    // A partial record at the end (e.g. from a logger that lost power) is ignored
+    const qint64 numRecords = (file->size() - layout.headerSize) / layout.recordSize;
+    if(numRecords <= 0 || numRecords > INT_MAX){
+        return false;
+    }
+    const qint64 length = numRecords * layout.recordSize;
+
+    QByteArray buffer;
+    uchar *mapped = file->map(layout.headerSize, length);
+    const uchar *begin = mapped;
+    if(mapped == nullptr){
+        file->seek(layout.headerSize);
+        buffer = file->read(length);
+        if(buffer.size() != length){
+            return false;
+        }
+        begin = reinterpret_cast<const uchar *>(buffer.constData());
+    }
+
+    if(progress != nullptr){
+        progress->setTotal(numRecords);
+    }
+    std::vector<TimeSeriesColumn> columns;
+    const bool complete = BinaryReader::decodeRecords(begin, int(numRecords), layout, columns, progress);
+
+    if(mapped != nullptr){
+        file->unmap(mapped);
+    }
+    if(!complete){
+        return false;
     }
+
+    for(int i=0; i<layout.fields.size(); i++){
+        const RecordField &field = layout.fields.at(i);
+        addColumn(field.name, std::move(columns[i]));
+        // The layout knows better than the field name
+        if(!field.role.isEmpty())
+            setChannel(i, Channel::roleFromName(field.role), field.unit.isEmpty() ? channelUnit(i) : field.unit);
+        else if(!field.unit.isEmpty())
+            setChannel(i, channelRole(i), field.unit);
+    }
+    // Integer fields are fixed-point with the layout's scale and bias, which the values alone may not give away
+    QVector<int> fixedPoint;
+    for(int i=0; i<layout.fields.size(); i++){
+        const RecordField::Type type = layout.fields.at(i).type;
+        if(type != RecordField::Float32 && type != RecordField::Float64)
+            fixedPoint.append(i);
+    }
+    QtConcurrent::blockingMap(fixedPoint, [this, &layout](int field){
+        columns[field].compact(layout.fields.at(field).scale, layout.fields.at(field).bias);
+    });
     setTimeColumn(timeColumn);
+    compact();
     return true;
 }
 
 void TimeSeries::addColumn(QString header, QList<qreal> data){
-    addColumn(QPair<QString, QList<qreal>>(header, data));
+    addColumn(header, TimeSeriesColumn(data));
 }
 void TimeSeries::addColumn(QPair<QString, QList<qreal>> column){
-    data->append(column);
+    addColumn(column.first, TimeSeriesColumn(column.second));
+}
+void TimeSeries::addColumn(QString header, TimeSeriesColumn &&column){
+    names.append(header);
+    columns.push_back(std::move(column));
+    loaded.append(true);
+    roles.append(Channel::guessRole(header));
+    units.append(Channel::guessUnit(header));
+}
+
+/**
+ * @brief TimeSeries::addColumn Adds a column that has not been read yet. It is read from the source file the first
+ * time it is used.
+ */
+void TimeSeries::addColumn(QString header){
+    names.append(header);
+    columns.push_back(TimeSeriesColumn());
+    loaded.append(false);
+    roles.append(Channel::guessRole(header));
+    units.append(Channel::guessUnit(header));
+}
+
+// The data file (CSV, or the CSV behind a cache) that columns left out of the initial load are read from, or the
+// files that were merged into this series
+void TimeSeries::setSourceFiles(const QStringList &fileNames){
+    sourceFileNames = fileNames;
+}
+
+// False if the column was left out when the data was loaded, and has not been used since
+bool TimeSeries::isLoaded(int column){
+    return loaded.at(column);
+}
+
+/**
+ * @brief TimeSeries::loadColumn Reads a column that was left out of the initial load, from the cache of the source
+ * file if it has one and from the file itself otherwise. HDF5 files have no cache and are read directly. Merged
+ * files are merged again, which puts the column's rows in the same order as before. If a source file has gone or
+ * changed, the column reads as NaN rather than with values that do not match the rest of the data, and the
+ * failure is reported through getErrorString.
+ */
+void TimeSeries::loadColumn(int column){
+    TimeSeriesColumn values;
+    bool result = false;
+    if(sourceFileNames.size() > 1){
+        TimeSeries merged;
+        result = TimeSeriesMerge::merge(sourceFileNames, timeColumn, &merged, nullptr, QStringList(names.at(column))) &&
+                merged.names == names;
+        if(result){
+            values = std::move(merged.columns[column]);
+        }
+    }
+    else if(sourceFileNames.size() == 1 && HDF5Reader::isHDF5(sourceFileNames.first())){
+        // Read the same time range as the initial load
+        const TimeSeriesColumn &time = columns[timeColumn];
+        HDF5Reader reader;
+        TimeSeries read;
+        result = time.size() > 0 && reader.open(sourceFileNames.first()) &&
+                reader.read(&read, QStringList(names.at(column)), time.first(), time.last()) && read.names == names;
+        if(result){
+            values = std::move(read.columns[column]);
+        }
+    }
+    else if(sourceFileNames.size() == 1){
+        result = TimeSeriesCache::loadColumn(sourceFileNames.first(), timeColumn, names.at(column), &values);
+    }
+    if(!result && sourceFileNames.size() == 1 && !HDF5Reader::isHDF5(sourceFileNames.first())){
+        QFile csv(sourceFileNames.first());
+        QStringList header;
+        std::vector<TimeSeriesColumn> parsed;
+        QVector<bool> selected;
+        result = readCSV(&csv, QStringList(names.at(column)), -1, nullptr, header, parsed, selected) && header == names;
+        if(result){
+            values = std::move(parsed[column]);
+        }
+    }
+    if(!result || values.size() != numRows()){
+        qWarning() << "Could not read column" << names.at(column) << "from" << sourceFileNames;
+        if(errorString.isEmpty())
+            errorString = QString("Column '%1' could not be read, as its data file has gone or changed. Open the data file again.").arg(names.at(column));
+        values = TimeSeriesColumn();
+        double *v = values.resize(numRows());
+        std::fill(v, v + numRows(), std::numeric_limits<double>::quiet_NaN());
+    }
+    values.compact();
+    columns[column] = std::move(values);
+    loaded[column] = true;
 }
 
 void TimeSeries::setTimeColumn(int col){
     timeColumn = col;
+    if(col >= 0 && col < numColumns()){
+        index.build(&columns[col]);
+        roles[col] = Channel::Time;
+    }
+    else{
+        index.clear();
+    }
 }
 
 int TimeSeries::getTimeColumn(){
@@ -64,47 +272,118 @@ int TimeSeries::getTimeColumn(){
 }
 
 int TimeSeries::numColumns(){
-    return data->size();
+    return int(columns.size());
 }
 
 int TimeSeries::numDataColumns(){ //Returns number of data (non-time) columns
-    return data->size() - 1;
+    return int(columns.size()) - 1;
 }
 
 QString TimeSeries::columnName(int column){
-    return data->at(column).first;
+    return names.at(column);
 }
 
-const QList<qreal>* TimeSeries::getColumn(const QString &colname){
-    for(int i=0; i<data->size(); i++){
-        if(data->at(i).first.compare(colname) == 0){
-            return &data->at(i).second;
-        }
-    }
-    return nullptr;
+// What a column measures, as guessed from its name on import or set with setChannel
+Channel::Role TimeSeries::channelRole(int column){
+    return roles.at(column);
+}
+
+// Unit of a column's values, or an empty string if it is not known
+QString TimeSeries::channelUnit(int column){
+    return units.at(column);
+}
+
+void TimeSeries::setChannel(int column, Channel::Role role, const QString &unit){
+    roles[column] = role;
+    units[column] = unit;
+}
+
+// Index of the first column with a role, or -1 if there is none
+int TimeSeries::columnOfRole(Channel::Role role){
+    return roles.indexOf(role);
 }
 
-const QList<qreal>* TimeSeries::getColumn(int column){
-    return &data->at(column).second;
+/**
+ * @brief TimeSeries::handle Looks up a column by name once, for loops that read it sample by sample. The column is
+ * read in if it was left out of the initial load.
+ * @return The column, or an invalid handle if there is no column of that name
+ */
+ColumnHandle TimeSeries::handle(const QString &colname){
+    const int i = names.indexOf(colname);
+    return (i < 0) ? ColumnHandle() : ColumnHandle(i, getColumn(i));
 }
 
-const QList<qreal>* TimeSeries::timeColumnData(){
+/**
+ * @brief TimeSeries::handle Looks up the first column with a role, e.g. acceleration along X whatever the data file
+ * calls it. See handle(const QString &).
+ */
+ColumnHandle TimeSeries::handle(Channel::Role role){
+    const int i = columnOfRole(role);
+    return (i < 0) ? ColumnHandle() : ColumnHandle(i, getColumn(i));
+}
+
+const TimeSeriesColumn* TimeSeries::getColumn(const QString &colname){
+    const int i = names.indexOf(colname);
+    return (i < 0) ? nullptr : getColumn(i);
+}
+
+// Columns that were left out of the initial load are read in here, the first time they are asked for
+const TimeSeriesColumn* TimeSeries::getColumn(int column){
+    if(!loaded.at(column)){
+        loadColumn(column);
+    }
+    return &columns[column];
+}
+
+const TimeSeriesColumn* TimeSeries::timeColumnData(){
     return getColumn(timeColumn);
 }
 
+/**
+ * @brief TimeSeries::compact Stores in-memory columns in the smallest encoding that holds them without loss. Values
+ * read back are unchanged; only the memory they take up shrinks. Loops over whole columns read them in decoded
+ * blocks (see TimeSeriesColumn::readStrided and ColumnReader), so every column is compacted, the time and
+ * acceleration columns included.
+ */
+void TimeSeries::compact(){
+    QtConcurrent::blockingMap(columns, [](TimeSeriesColumn &column){ column.compact(); });
+}
+
+// True if columns are paged in from a cache file rather than held in memory
+bool TimeSeries::isPaged(){
+    return !columns.empty() && columns.front().isPaged();
+}
+
+/**
+ * @brief TimeSeries::getErrorString Empty unless part of the data could not be read after it was loaded, in which case
+ * the values that are missing read as NaN. Check it before showing or saving results computed from the data.
+ */
+QString TimeSeries::getErrorString(){
+    if(!errorString.isEmpty())
+        return errorString;
+    for(const TimeSeriesColumn &column: columns){
+        const QString error = column.getErrorString();
+        if(!error.isEmpty())
+            return error;
+    }
+    return QString();
+}
+
 int TimeSeries::numRows(){ //Returns length of time series, as the number of rows of the current time column.
-    return data->at(timeColumn).second.size();
+    return columns[timeColumn].size();
 }
 
 //Makes a list comprised of points representing a single row of the time series.
 QList<QPair<QString, QPointF>> TimeSeries::rowAt(int i){
-    qreal timeAt = data->at(timeColumn).second.at(i); //Gets the time at row i.
+    qreal timeAt;
+    columns[timeColumn].read(i, 1, &timeAt); //Gets the time at row i.
     QList<QPair<QString, QPointF>> out = QList<QPair<QString, QPointF>>();
 
     for(int col=0; col<numDataColumns() + 1; col++){ //Cycle through all the columns
         if(col != timeColumn){
-            out.append(QPair<QString, QPointF>(data->at(col).first,
-                                                 QPointF(timeAt, data->at(col).second.at(i))));
+            qreal value;
+            getColumn(col)->read(i, 1, &value);
+            out.append(QPair<QString, QPointF>(names.at(col), QPointF(timeAt, value)));
         }
     }
     return out;
@@ -113,7 +392,9 @@ QList<QPair<QString, QPointF>> TimeSeries::rowAt(int i){
 QList<qreal> TimeSeries::rowData(int i){
     QList<qreal> out = QList<qreal>();
     for(int col=0; col<numColumns(); col++){
-        out.append(data->at(col).second.at(i));
+        qreal value;
+        getColumn(col)->read(i, 1, &value);
+        out.append(value);
     }
     return out;
 }
@@ -122,45 +403,40 @@ QList<QPair<QString, QPointF>> TimeSeries::linearInterpolate(qreal t, int indexS
     QList<QPair<QString, QPointF>> out = QList<QPair<QString, QPointF>>();
 
     int indexBefore = indexOfLEQ(t, indexStart, indexEnd);
-    QList<QPair<QString, QPointF>> rowBefore = rowAt(indexBefore);
-
     if(indexBefore == (numRows() - 1))
-        out = rowBefore;
-    else{
-        int indexAfter = indexBefore + 1;
-        QList<QPair<QString, QPointF>> rowAfter = rowAt(indexAfter);
-        //Time difference between the two points
-        qreal dTimePoints = data->at(timeColumn).second.at(indexAfter) - data->at(timeColumn).second.at(indexBefore);
-        //Time difference between first point and t
-        qreal dT = t - data->at(timeColumn).second.at(indexBefore);
-        for(int i=0; i<rowBefore.size(); i++){ //Iterate through all data columns
-            QPointF pointBefore = rowBefore.at(i).second;
-            QPointF pointAfter = rowAfter.at(i).second;
+        return rowAt(indexBefore);
+
+    // Both rows are read with one call per column, rather than one per value
+    qreal time[2];
+    columns[timeColumn].read(indexBefore, 2, time);
+    //Time difference between the two points
+    qreal dTimePoints = time[1] - time[0];
+    //Time difference between first point and t
+    qreal dT = t - time[0];
+    for(int col=0; col<numDataColumns() + 1; col++){ //Iterate through all data columns
+        if(col != timeColumn){
+            qreal value[2];
+            getColumn(col)->read(indexBefore, 2, value);
             //Append a point with the column label and new interpolated coordinates
-            out.append(QPair<QString, QPointF>(rowBefore.at(i).first, QPointF(t, pointBefore.y() + (pointAfter.y() - pointBefore.y()) / dTimePoints * dT)));
+            out.append(QPair<QString, QPointF>(names.at(col), QPointF(t, value[0] + (value[1] - value[0]) / dTimePoints * dT)));
         }
     }
     return out;
 }
 
 int TimeSeries::indexOfLEQ(qreal value, int indexStart, int indexEnd){
-    int _start = indexStart;
-    int _end = indexEnd;
-    int _mid;
-    const QList<qreal> *column = &(data->at(timeColumn).second);
+    const TimeSeriesColumn *column = &(columns[timeColumn]);
 
-    if(column->at(_start) > value){
+    if(column->at(indexStart) > value){
         return -1;
     }
+    // The time column is sorted, so the answer within [indexStart, indexEnd] follows from the one for the whole column
+    return qMin(index.indexOfLEQ(column, value), indexEnd);
+}
 
-    while(_start != _end){
-        if(_start == _end)
-            return _start;
-        _mid = qCeil((_start + _end) / 2.0);
-        if(column->at(_mid) > value)
-            _end = _mid - 1;
-        else
-            _start = _mid;
-    }
-    return _start;
+/**
+ * @brief TimeSeries::timeIndex Segments, gaps and sample rates of the time column
+ */
+const TimeIndex *TimeSeries::timeIndex(){
+    return &index;
 }
@@ -4,6 +4,15 @@
 #include <QList>
 #include <QPair>
 #include <QFile>
+#include <QStringList>
+#include <QVector>
+#include <vector>
+#include "channel.h"
+#include "loadprogress.h"
+#include "timeindex.h"
+#include "timeseriescolumn.h"
+
+class RecordLayout;
 
 // Comma separation regex
 #define REGEX_COMMASEP QRegExp("\\s*,\\s*")
@@ -12,25 +21,55 @@ class TimeSeries
 {
 public:
     TimeSeries();
-    bool fromCSV(QFile *csv, int timeColumn);
+    bool fromCSV(QFile *csv, int timeColumn, LoadProgress *progress = nullptr, const QStringList &selectedColumns = QStringList());
+    bool fromBinary(QFile *file, const RecordLayout &layout, int timeColumn, LoadProgress *progress = nullptr);
     void addColumn(QPair<QString, QList<qreal>> column);
     void addColumn(QString header, QList<qreal> data);
+    void addColumn(QString header, TimeSeriesColumn &&column);
+    void addColumn(QString header);
+    void setSourceFiles(const QStringList &fileNames);
+    bool isLoaded(int column);
     void setTimeColumn(int col);
     int getTimeColumn();
     int numDataColumns();
     int numRows();
     int numColumns();
     QString columnName(int column);
-    const QList<qreal> *timeColumnData();
-    const QList<qreal> *getColumn(int column);
-    const QList<qreal> *getColumn(const QString &colname);
+    Channel::Role channelRole(int column);
+    QString channelUnit(int column);
+    void setChannel(int column, Channel::Role role, const QString &unit);
+    int columnOfRole(Channel::Role role);
+    ColumnHandle handle(const QString &colname);
+    ColumnHandle handle(Channel::Role role);
+    const TimeSeriesColumn *timeColumnData();
+    const TimeSeriesColumn *getColumn(int column);
+    const TimeSeriesColumn *getColumn(const QString &colname);
+    bool isPaged();
+    QString getErrorString();
+    void compact();
     QList<QPair<QString, QPointF>> rowAt(int i);
     QList<qreal> rowData(int i);
     QList<QPair<QString, QPointF>> linearInterpolate(qreal t, int indexStart, int indexEnd);
     int indexOfLEQ(qreal value, int indexStart, int indexEnd);
+    const TimeIndex *timeIndex();
 private:
+    Q_DISABLE_COPY(TimeSeries)
+    static bool readCSV(QFile *csv, const QStringList &selectedColumns, int timeColumn, LoadProgress *progress,
+                        QStringList &header, std::vector<TimeSeriesColumn> &columns, QVector<bool> &selected);
+    void loadColumn(int column);
+
     int timeColumn;
-    QList<QPair<QString, QList<qreal>>> *data;
+    QStringList names;
+    std::vector<TimeSeriesColumn> columns;
+    // What each column measures, and in which unit (empty if unknown)
+    QVector<Channel::Role> roles;
+    QStringList units;
+    // Columns left out of the initial load are read from the source file the first time they are used
+    QVector<bool> loaded;
+    QStringList sourceFileNames;
+    TimeIndex index;
+    // Set if a column could not be read after the initial load
+    QString errorString;
 };
 
 #endif // TIMESERIES_H
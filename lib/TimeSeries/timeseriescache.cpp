@@ -0,0 +1,377 @@
+#include "timeseriescache.h"
+#include "csvreader.h"
+#include <QBuffer>
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStringList>
+#include <QVector>
+#include <climits>
+#include <utility>
+
+namespace {
+const quint32 cacheMagic = 0x51564443; // "QVDC"
+const quint32 cacheVersion = 1;
+const qint64 dataAlignment = 64;
+
+// Hashing every byte of a multi-gigabyte file takes almost as long as parsing it, so only this many evenly
+// spaced blocks are hashed. Together with the file size and modification time this is enough to detect changes.
+const int hashSampleBlocks = 16;
+const qint64 hashBlockSize = 64*1024;
+
+struct CacheHeader{
+    qint64 sourceSize;
+    qint64 sourceModified;
+    QByteArray sourceHash;
+    qint32 timeColumn;
+    QStringList columnNames;
+    qint64 numRows;
+    qint32 blockRows;
+    qint64 dataOffset;
+};
+
+QByteArray sourceHash(QFile &source){
+    QCryptographicHash hash(QCryptographicHash::Sha1);
+    const qint64 size = source.size();
+    if(size <= hashSampleBlocks * hashBlockSize){
+        hash.addData(source.readAll());
+    }
+    else{
+        for(int i=0; i<hashSampleBlocks; i++){
+            source.seek((size - hashBlockSize) * i / (hashSampleBlocks - 1));
+            hash.addData(source.read(hashBlockSize));
+        }
+    }
+    return hash.result();
+}
+
+// Fills in the part of the header that identifies the data file
+bool sourceKey(const QString &dataFileName, CacheHeader &header){
+    QFile source(dataFileName);
+    if(!source.open(QFile::ReadOnly))
+        return false;
+    QFileInfo info(dataFileName);
+    header.sourceSize = info.size();
+    header.sourceModified = info.lastModified().toMSecsSinceEpoch();
+    header.sourceHash = sourceHash(source);
+    return true;
+}
+
+void setupStream(QDataStream &stream){
+    stream.setVersion(QDataStream::Qt_5_0);
+    stream.setByteOrder(QDataStream::LittleEndian);
+}
+
+void writeHeader(QDataStream &out, const CacheHeader &header){
+    // Column data is stored in native byte order, which must match when the cache is read back
+    out << cacheMagic << cacheVersion << quint8(Q_BYTE_ORDER == Q_LITTLE_ENDIAN);
+    out << header.sourceSize << header.sourceModified << header.sourceHash;
+    out << header.timeColumn << header.columnNames << header.numRows << header.blockRows << header.dataOffset;
+}
+
+bool readHeader(QDataStream &in, CacheHeader &header){
+    quint32 magic, version;
+    quint8 littleEndian;
+    in >> magic >> version >> littleEndian;
+    if(in.status() != QDataStream::Ok || magic != cacheMagic || version != cacheVersion ||
+            littleEndian != quint8(Q_BYTE_ORDER == Q_LITTLE_ENDIAN))
+        return false;
+    in >> header.sourceSize >> header.sourceModified >> header.sourceHash;
+    in >> header.timeColumn >> header.columnNames >> header.numRows >> header.blockRows >> header.dataOffset;
+    return in.status() == QDataStream::Ok && header.blockRows > 0 && header.numRows >= 0 && header.numRows <= INT_MAX;
+}
+
+// Offset of the first value of one column within one block, relative to the start of the column data
+qint64 blockOffset(const CacheHeader &header, qint64 block, int column){
+    const qint64 numColumns = header.columnNames.size();
+    const qint64 rowsInBlock = qMin(qint64(header.blockRows), header.numRows - block*header.blockRows);
+    return qint64(sizeof(double)) * (block*header.blockRows*numColumns + column*rowsInBlock);
+}
+
+// Opens the cache of a data file and reads its header, as long as the cache is still up to date
+bool openCache(QFile &cacheFile, const QString &dataFileName, int timeColumn, CacheHeader &header){
+    cacheFile.setFileName(TimeSeriesCache::cacheFileName(dataFileName));
+    if(!cacheFile.open(QFile::ReadOnly))
+        return false;
+
+    QDataStream in(&cacheFile);
+    setupStream(in);
+    if(!readHeader(in, header) || header.timeColumn != timeColumn)
+        return false;
+
+    // Rebuild the cache whenever the data file changes
+    CacheHeader source;
+    if(!sourceKey(dataFileName, source) || source.sourceSize != header.sourceSize ||
+            source.sourceModified != header.sourceModified || source.sourceHash != header.sourceHash)
+        return false;
+
+    const qint64 dataBytes = qint64(sizeof(double)) * header.numRows * header.columnNames.size();
+    return !header.columnNames.isEmpty() && cacheFile.size() == header.dataOffset + dataBytes;
+}
+
+// Sets the data offset so that column data starts on an aligned boundary right after the header
+void placeData(CacheHeader &header){
+    QBuffer measure;
+    measure.open(QBuffer::WriteOnly);
+    QDataStream measureStream(&measure);
+    setupStream(measureStream);
+    header.dataOffset = 0;
+    writeHeader(measureStream, header);
+    header.dataOffset = ((measure.size() + dataAlignment - 1) / dataAlignment) * dataAlignment;
+}
+
+void writeBlock(QIODevice *out, const double *values, int count){
+    out->write(reinterpret_cast<const char *>(values), qint64(sizeof(double)) * count);
+}
+}
+
+QString TimeSeriesCache::cacheFileName(const QString &dataFileName){
+    return dataFileName + CACHE_SUFFIX;
+}
+
+/**
+ * @brief TimeSeriesCache::load Fills a TimeSeries from the cache of a data file
+ * @param dataFileName The original data file (not the cache)
+ * @param timeColumn Expected time column. Caches made with a different time column are not used.
+ * @param ts An empty TimeSeries to fill
+ * @param selectedColumns Names of the columns to load now, or empty for all of them. The others are read from the
+ * cache when they are first used, as in TimeSeries::fromCSV.
+ * @return true if a valid, up-to-date cache was found and loaded. ts is left untouched otherwise.
+ */
+bool TimeSeriesCache::load(const QString &dataFileName, int timeColumn, TimeSeries *ts, const QStringList &selectedColumns){
+    QFile cacheFile;
+    CacheHeader header;
+    if(!openCache(cacheFile, dataFileName, timeColumn, header))
+        return false;
+
+    const int numColumns = header.columnNames.size();
+    const qint64 dataBytes = qint64(sizeof(double)) * header.numRows * numColumns;
+
+    const QVector<bool> selected = CSVReader::selectColumns(header.columnNames, selectedColumns, header.timeColumn);
+    std::vector<TimeSeriesColumn> columns(numColumns);
+    for(int col=0; col<numColumns; col++){
+        if(selected.at(col))
+            columns[col].reserve(int(header.numRows));
+    }
+
+    if(dataBytes > 0){
+        uchar *mapped = cacheFile.map(header.dataOffset, dataBytes);
+        if(mapped == nullptr)
+            return false;
+        const qint64 numBlocks = (header.numRows + header.blockRows - 1) / header.blockRows;
+        for(qint64 block=0; block<numBlocks; block++){
+            const int rowsInBlock = int(qMin(qint64(header.blockRows), header.numRows - block*header.blockRows));
+            for(int col=0; col<numColumns; col++){
+                if(selected.at(col))
+                    columns[col].append(reinterpret_cast<const double *>(mapped + blockOffset(header, block, col)), rowsInBlock);
+            }
+        }
+        cacheFile.unmap(mapped);
+    }
+
+    for(int col=0; col<numColumns; col++){
+        if(selected.at(col))
+            ts->addColumn(header.columnNames.at(col), std::move(columns[col]));
+        else
+            ts->addColumn(header.columnNames.at(col));
+    }
+    ts->setSourceFiles(QStringList(dataFileName));
+    ts->setTimeColumn(header.timeColumn);
+    ts->compact();
+    return true;
+}
+
+/**
+ * @brief TimeSeriesCache::loadColumn Reads a single column from the cache of a data file
+ * @param column Receives the values
+ * @return true if a valid, up-to-date cache with that column was found
+ */
+bool TimeSeriesCache::loadColumn(const QString &dataFileName, int timeColumn, const QString &columnName, TimeSeriesColumn *column){
+    QFile cacheFile;
+    CacheHeader header;
+    if(!openCache(cacheFile, dataFileName, timeColumn, header))
+        return false;
+    const int col = header.columnNames.indexOf(columnName);
+    if(col < 0)
+        return false;
+
+    TimeSeriesColumn values;
+    values.reserve(int(header.numRows));
+    const qint64 numBlocks = (header.numRows + header.blockRows - 1) / header.blockRows;
+    for(qint64 block=0; block<numBlocks; block++){
+        // Only this column's part of each block is mapped
+        const int rowsInBlock = int(qMin(qint64(header.blockRows), header.numRows - block*header.blockRows));
+        const qint64 bytes = qint64(sizeof(double)) * rowsInBlock;
+        uchar *mapped = cacheFile.map(header.dataOffset + blockOffset(header, block, col), bytes);
+        if(mapped == nullptr)
+            return false;
+        values.append(reinterpret_cast<const double *>(mapped), rowsInBlock);
+        cacheFile.unmap(mapped);
+    }
+    *column = std::move(values);
+    return true;
+}
+
+/**
+ * @brief TimeSeriesCache::save Writes the cache for a data file that has just been loaded into ts
+ * @return true if the cache was written. Failure (e.g. a read-only data directory, or columns that were left out
+ * of the load) is harmless; the data file will simply be parsed again next time.
+ */
+bool TimeSeriesCache::save(const QString &dataFileName, TimeSeries *ts){
+    CacheHeader header;
+    if(ts->numColumns() == 0 || !sourceKey(dataFileName, header))
+        return false;
+    // A cache has to hold every column, and reading the missing ones here would undo the point of leaving them out
+    for(int col=0; col<ts->numColumns(); col++){
+        if(!ts->isLoaded(col))
+            return false;
+    }
+
+    header.timeColumn = ts->getTimeColumn();
+    for(int col=0; col<ts->numColumns(); col++){
+        header.columnNames.append(ts->columnName(col));
+    }
+    header.numRows = ts->getColumn(0)->size();
+    header.blockRows = CACHE_BLOCK_ROWS;
+
+    placeData(header);
+
+    QSaveFile cacheFile(cacheFileName(dataFileName));
+    if(!cacheFile.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&cacheFile);
+    setupStream(out);
+    writeHeader(out, header);
+    cacheFile.write(QByteArray(int(header.dataOffset - cacheFile.pos()), '\0'));
+
+    std::vector<ColumnReader> readers;
+    for(int col=0; col<ts->numColumns(); col++){
+        readers.push_back(ColumnReader(ts->getColumn(col)));
+    }
+    const qint64 numBlocks = (header.numRows + header.blockRows - 1) / header.blockRows;
+    for(qint64 block=0; block<numBlocks; block++){
+        const int firstRow = int(block*header.blockRows);
+        const int rowsInBlock = int(qMin(qint64(header.blockRows), header.numRows - firstRow));
+        for(ColumnReader &reader: readers){
+            writeBlock(&cacheFile, reader.block(firstRow, rowsInBlock), rowsInBlock);
+        }
+    }
+    return cacheFile.commit();
+}
+
+/**
+ * @brief TimeSeriesCache::open Like load, but leaves the column data on disk. Columns of the resulting TimeSeries
+ * are paged in on demand by a shared ColumnPager, so data sets larger than memory can be used.
+ * @return true if a valid, up-to-date cache was found. ts is left untouched otherwise.
+ */
+bool TimeSeriesCache::open(const QString &dataFileName, int timeColumn, TimeSeries *ts){
+    QFile cacheFile;
+    CacheHeader header;
+    if(!openCache(cacheFile, dataFileName, timeColumn, header))
+        return false;
+
+    QSharedPointer<ColumnPager> pager(new ColumnPager(cacheFile.fileName(), header.dataOffset, header.numRows,
+                                                      header.columnNames.size(), header.blockRows));
+    if(!pager->open())
+        return false;
+
+    for(int col=0; col<header.columnNames.size(); col++){
+        ts->addColumn(header.columnNames.at(col), TimeSeriesColumn(pager, col));
+    }
+    ts->setTimeColumn(header.timeColumn);
+    return true;
+}
+
+/**
+ * @brief TimeSeriesCache::build Converts a CSV data file straight into its cache, without ever holding more than
+ * a window of the file and a block of rows in memory. Produces the same cache as fromCSV followed by save.
+ * @param progress If given, follows the conversion and can cancel it
+ * @return true if the cache was written
+ */
+bool TimeSeriesCache::build(QFile *csv, const QString &dataFileName, int timeColumn, LoadProgress *progress){
+    if(!csv->isOpen() && !csv->open(QFile::ReadOnly))
+        return false;
+    const qint64 size = csv->size();
+    CacheHeader header;
+    if(size == 0 || !sourceKey(dataFileName, header))
+        return false;
+    if(progress != nullptr)
+        progress->setTotal(size);
+    header.timeColumn = timeColumn;
+    header.numRows = 0;
+    header.blockRows = CACHE_BLOCK_ROWS;
+
+    QSaveFile cacheFile(cacheFileName(dataFileName));
+    if(!cacheFile.open(QIODevice::WriteOnly))
+        return false;
+    QDataStream out(&cacheFile);
+    setupStream(out);
+
+    std::vector<TimeSeriesColumn> pending;
+    qint64 offset = 0;
+    qint64 window = CACHE_BUILD_WINDOW;
+    bool haveHeader = false;
+
+    while(offset < size){
+        const qint64 windowSize = qMin(window, size - offset);
+        uchar *mapped = csv->map(offset, windowSize);
+        if(mapped == nullptr)
+            return false;
+        const char *begin = reinterpret_cast<const char *>(mapped);
+        const char *end = begin + windowSize;
+
+        // Only whole lines are parsed; a partial line at the end is left for the next window
+        if(offset + windowSize < size){
+            while(end > begin && end[-1] != '\n')
+                --end;
+            if(end == begin){
+                // Line longer than the window: try again with a larger one
+                csv->unmap(mapped);
+                window *= 2;
+                continue;
+            }
+        }
+
+        const char *body = begin;
+        if(!haveHeader){
+            body = CSVReader::nextLine(begin, end);
+            header.columnNames = QString(QByteArray::fromRawData(begin, int(body - begin))).trimmed().split(REGEX_COMMASEP, QString::KeepEmptyParts);
+            pending.resize(header.columnNames.size());
+            placeData(header);
+            writeHeader(out, header);
+            cacheFile.write(QByteArray(int(header.dataOffset - cacheFile.pos()), '\0'));
+            haveHeader = true;
+        }
+        const bool complete = CSVReader::parseRowsParallel(body, end, pending, progress);
+        offset += end - begin;
+        csv->unmap(mapped);
+        if(!complete)
+            return false; // Canceled; the unfinished cache is discarded
+
+        // Write out every complete block, and keep the remainder for the next window
+        const bool lastWindow = (offset >= size);
+        const int parsedRows = pending.empty() ? 0 : pending.front().size();
+        int written = 0;
+        while(parsedRows - written >= header.blockRows || (lastWindow && written < parsedRows)){
+            const int rowsInBlock = qMin(header.blockRows, parsedRows - written);
+            for(const TimeSeriesColumn &column: pending){
+                writeBlock(&cacheFile, column.constData() + written, rowsInBlock);
+            }
+            written += rowsInBlock;
+            header.numRows += rowsInBlock;
+        }
+        for(TimeSeriesColumn &column: pending){
+            TimeSeriesColumn remainder;
+            remainder.append(column.constData() + written, parsedRows - written);
+            column = std::move(remainder);
+        }
+    }
+
+    // Now that the number of rows is known, rewrite the header. Its size does not change.
+    cacheFile.seek(0);
+    writeHeader(out, header);
+    return cacheFile.commit();
+}
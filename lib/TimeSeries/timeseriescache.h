@@ -0,0 +1,38 @@
+#ifndef TIMESERIESCACHE_H
+#define TIMESERIESCACHE_H
+
+#include <QFile>
+#include <QString>
+#include <QStringList>
+#include "timeseries.h"
+
+// Appended to the data file name to get the name of its cache
+#define CACHE_SUFFIX ".qvdcache"
+// Number of rows stored contiguously for each column. Columns are stored block by block.
+#define CACHE_BLOCK_ROWS (1 << 16)
+// Data files at least this large are paged in from their cache instead of being loaded into memory
+#define OUT_OF_CORE_BYTES (Q_INT64_C(1024)*1024*1024)
+// Amount of a CSV file mapped at once while converting it into a cache
+#define CACHE_BUILD_WINDOW (Q_INT64_C(64)*1024*1024)
+
+/**
+ * TimeSeriesCache stores a loaded TimeSeries in a binary columnar file next to the data file it came from, so that
+ * the data file does not have to be parsed again the next time it is opened.
+ *
+ * The cache starts with a header (column names, time column, row count) and a key describing the data file (size,
+ * modification time and a hash of its contents). Column data follows as raw doubles in blocks of CACHE_BLOCK_ROWS
+ * rows, one block per column in turn. A cache is only used if its key still matches the data file.
+ *
+ * Very large data files can be converted directly into a cache (build) and then used without loading them into
+ * memory at all (open).
+ */
+namespace TimeSeriesCache{
+    QString cacheFileName(const QString &dataFileName);
+    bool load(const QString &dataFileName, int timeColumn, TimeSeries *ts, const QStringList &selectedColumns = QStringList());
+    bool loadColumn(const QString &dataFileName, int timeColumn, const QString &columnName, TimeSeriesColumn *column);
+    bool save(const QString &dataFileName, TimeSeries *ts);
+    bool open(const QString &dataFileName, int timeColumn, TimeSeries *ts);
+    bool build(QFile *csv, const QString &dataFileName, int timeColumn, LoadProgress *progress = nullptr);
+}
+
+#endif // TIMESERIESCACHE_H
@@ -0,0 +1,565 @@
+#include "timeseriescolumn.h"
+#include <climits>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace {
+// Rows decoded at a time when checking that an encoding is lossless
+const int verifyBlockRows = 4096;
+// Relative error allowed in a step between values, see TimeSeriesColumn::levelStep
+const double stepTolerance = 1e-9;
+
+// Greatest common divisor of two positive steps, treating remainders within [tolerance] of 0 or of the divisor as 0
+double commonStep(double a, double b, double tolerance){
+    if(a < b)
+        std::swap(a, b);
+    while(b > tolerance){
+        const double r = std::fmod(a, b);
+        a = b;
+        b = (r > b - tolerance) ? 0 : r;
+    }
+    return a;
+}
+}
+
+TimeSeriesColumn::TimeSeriesColumn()
+{
+    values = nullptr;
+    packed = nullptr;
+    type = Double;
+    scale = 1;
+    offset = 0;
+    divisor = 1;
+    zero = 0;
+    count = 0;
+    capacity = 0;
+    pagedColumn = -1;
+}
+
+TimeSeriesColumn::TimeSeriesColumn(const QList<qreal> &values): TimeSeriesColumn(){
+    reserve(values.size());
+    for(qreal v: values){
+        this->values[count++] = v;
+    }
+}
+
+TimeSeriesColumn::TimeSeriesColumn(QSharedPointer<ColumnPager> pager, int pagedColumn): TimeSeriesColumn(){
+    this->pager = pager;
+    this->pagedColumn = pagedColumn;
+}
+
+TimeSeriesColumn::TimeSeriesColumn(TimeSeriesColumn &&other) Q_DECL_NOEXCEPT: TimeSeriesColumn(){
+    *this = std::move(other);
+}
+
+TimeSeriesColumn &TimeSeriesColumn::operator=(TimeSeriesColumn &&other) Q_DECL_NOEXCEPT{
+    if(this != &other){
+        release();
+        values = other.values;
+        packed = other.packed;
+        type = other.type;
+        scale = other.scale;
+        offset = other.offset;
+        divisor = other.divisor;
+        zero = other.zero;
+        blockBase.swap(other.blockBase);
+        count = other.count;
+        capacity = other.capacity;
+        pager = other.pager;
+        pagedColumn = other.pagedColumn;
+        other.values = nullptr;
+        other.packed = nullptr;
+        other.release();
+        other.pager.clear();
+        other.pagedColumn = -1;
+    }
+    return *this;
+}
+
+TimeSeriesColumn::~TimeSeriesColumn(){
+    release();
+}
+
+// Frees all in-memory storage, leaving an empty Double column
+void TimeSeriesColumn::release(){
+    qFreeAligned(values);
+    qFreeAligned(packed);
+    values = nullptr;
+    packed = nullptr;
+    type = Double;
+    scale = 1;
+    offset = 0;
+    divisor = 1;
+    zero = 0;
+    blockBase.clear();
+    count = 0;
+    capacity = 0;
+}
+
+qreal TimeSeriesColumn::first() const{
+    return at(0);
+}
+
+qreal TimeSeriesColumn::last() const{
+    return at(size() - 1);
+}
+
+bool TimeSeriesColumn::isPaged() const{
+    return !pager.isNull();
+}
+
+/**
+ * @brief TimeSeriesColumn::getErrorString Empty unless part of a paged column could not be read (see ColumnPager)
+ */
+QString TimeSeriesColumn::getErrorString() const{
+    if(pager.isNull() || !pager->hasError())
+        return QString();
+    return pager->getErrorString();
+}
+
+/**
+ * @brief TimeSeriesColumn::constData Raw, COLUMN_ALIGNMENT aligned values of an in-memory column.
+ * @return nullptr for paged and encoded columns, which have no contiguous doubles; use ColumnReader for those.
+ */
+const double *TimeSeriesColumn::constData() const{
+    return values;
+}
+
+/**
+ * @brief TimeSeriesColumn::span View of all values of an in-memory Double column. Encoded columns (see compact) and
+ * paged columns have no contiguous doubles to view, and must not be asked for one: loops over loaded data read it
+ * with read(), readStrided() or ColumnReader instead, which decode on access.
+ */
+ColumnSpan TimeSeriesColumn::span() const{
+    Q_ASSERT(pager.isNull() && type == Double);
+    return ColumnSpan{values, count};
+}
+
+/**
+ * @brief TimeSeriesColumn::span View of [count] values starting at index [start] of an in-memory Double column. See
+ * span().
+ */
+ColumnSpan TimeSeriesColumn::span(int start, int count) const{
+    Q_ASSERT(pager.isNull() && type == Double && start >= 0 && start + count <= this->count);
+    return ColumnSpan{values + start, count};
+}
+
+/**
+ * @brief TimeSeriesColumn::read Copies [count] values starting at index [start] to [out]
+ */
+void TimeSeriesColumn::read(int start, int count, qreal *out) const{
+    if(!pager.isNull()){
+        pager->read(pagedColumn, start, count, out);
+    }
+    else if(type == Double){
+        memcpy(out, values + start, size_t(count) * sizeof(double));
+    }
+    else{
+        decode(start, count, out);
+    }
+}
+
+/**
+ * @brief TimeSeriesColumn::readStrided Copies [count] values to [out], taking every [stride]th one starting at index
+ * [start]. Paged and encoded columns are read in blocks, rather than locked or decoded once per value.
+ */
+void TimeSeriesColumn::readStrided(int start, int count, int stride, qreal *out) const{
+    if(count <= 0)
+        return;
+    if(stride == 1){
+        read(start, count, out);
+        return;
+    }
+    if(pager.isNull() && type == Double){
+        for(int i=0; i<count; i++){
+            out[i] = values[start + i*stride];
+        }
+        return;
+    }
+    const int rowEnd = start + (count - 1)*stride + 1;
+    QVector<double> raw(qMin(STRIDED_READ_ROWS, rowEnd - start));
+    for(int row=start; row<rowEnd; row+=raw.size()){
+        const int n = qMin(raw.size(), rowEnd - row);
+        read(row, n, raw.data());
+        // First row of this block that is taken
+        for(int i=start + (row - start + stride - 1)/stride*stride; i<row + n; i+=stride){
+            out[(i - start)/stride] = raw.at(i - row);
+        }
+    }
+}
+
+/**
+ * @brief TimeSeriesColumn::toVector Copies the whole column. Prefer ColumnReader, which works through it a block at a time.
+ */
+QVector<qreal> TimeSeriesColumn::toVector() const{
+    QVector<qreal> out(size());
+    read(0, out.size(), out.data());
+    return out;
+}
+
+void TimeSeriesColumn::reserve(int capacity){
+    if(capacity > this->capacity)
+        grow(capacity);
+}
+
+/**
+ * @brief TimeSeriesColumn::resize Sets the number of values of a Double column. New values are uninitialised.
+ * @return The values, to be filled in by the caller
+ */
+double *TimeSeriesColumn::resize(int count){
+    Q_ASSERT(type == Double);
+    reserve(count);
+    this->count = count;
+    return values;
+}
+
+/**
+ * @brief TimeSeriesColumn::resizeInt16 Turns the column into an Int16 column of [count] uninitialised raw values,
+ * each read back as raw*scale + offset. Lets importers store integer sensor counts without converting them.
+ * @return The raw values, to be filled in by the caller
+ */
+qint16 *TimeSeriesColumn::resizeInt16(int count, double scale, double offset){
+    release();
+    qint16 *r = static_cast<qint16 *>(qMallocAligned(qMax(size_t(count), size_t(1)) * sizeof(qint16), COLUMN_ALIGNMENT));
+    Q_CHECK_PTR(r);
+    packed = r;
+    type = Int16;
+    this->scale = scale;
+    this->offset = offset;
+    this->count = count;
+    this->capacity = count;
+    return r;
+}
+
+void TimeSeriesColumn::append(const double *values, int count){
+    Q_ASSERT(type == Double);
+    if(count <= 0)
+        return;
+    if(this->count + count > capacity)
+        grow(this->count + count);
+    memcpy(this->values + this->count, values, size_t(count) * sizeof(double));
+    this->count += count;
+}
+
+void TimeSeriesColumn::clear(){
+    if(type != Double)
+        release();
+    count = 0;
+}
+
+void TimeSeriesColumn::grow(int minCapacity){
+    // Grow geometrically so that appending one value at a time stays amortised O(1)
+    const int newCapacity = int(qMin(qint64(INT_MAX), qMax(qint64(minCapacity), qint64(capacity) * 3 / 2 + 16)));
+    values = static_cast<double *>(qReallocAligned(values, size_t(newCapacity) * sizeof(double),
+                                                   size_t(capacity) * sizeof(double), COLUMN_ALIGNMENT));
+    Q_CHECK_PTR(values);
+    capacity = newCapacity;
+}
+
+TimeSeriesColumn::Encoding TimeSeriesColumn::encoding() const{
+    return type;
+}
+
+/**
+ * @brief TimeSeriesColumn::memoryUsage Bytes of memory taken up by the values of this column
+ */
+qint64 TimeSeriesColumn::memoryUsage() const{
+    switch(type){
+    case Float32:
+        return qint64(count) * qint64(sizeof(float));
+    case Int16:
+        return qint64(count) * qint64(sizeof(qint16));
+    case Delta16:
+        return qint64(count) * qint64(sizeof(quint16)) + qint64(blockBase.size()) * qint64(sizeof(qint64));
+    default:
+        return qint64(capacity) * qint64(sizeof(double));
+    }
+}
+
+/**
+ * @brief TimeSeriesColumn::encode Stores the column in another encoding. Only done if every value decodes to
+ * exactly the double it was, so encoding never changes what readers of the column see. Int16 and Delta16 need the
+ * values to be fixed-point: a whole number of decimals (see fixedPoint), or a whole number of steps of some size
+ * (see levelStep).
+ * @return true if the column is now in the requested encoding
+ */
+bool TimeSeriesColumn::encode(Encoding encoding){
+    // Only complete in-memory columns of doubles are encoded
+    if(!pager.isNull() || type != Double || encoding == Double)
+        return encoding == type;
+
+    if(encoding == Float32){
+        TimeSeriesColumn encoded;
+        encoded.type = Float32;
+        encoded.count = count;
+        encoded.capacity = count;
+        float *f = static_cast<float *>(qMallocAligned(qMax(size_t(count), size_t(1)) * sizeof(float), COLUMN_ALIGNMENT));
+        Q_CHECK_PTR(f);
+        for(int i=0; i<count; i++){
+            f[i] = float(values[i]);
+        }
+        encoded.packed = f;
+        return keepIfLossless(encoded);
+    }
+
+    double divisor;
+    if(fixedPoint(divisor) && encodeFixed(encoding, 1, 0, divisor))
+        return true;
+    double step, largest;
+    if(!levelStep(step, largest))
+        return false;
+    // Should the step still be off by rounding, it is also tried as exactly what the largest value is a multiple of.
+    // Values with a bias cannot be told apart from rounding this way, and need the scale and offset they were made
+    // with (see compact(double, double)).
+    return encodeFixed(encoding, step, 0, 1) || encodeFixed(encoding, largest / double(std::llround(largest / step)), 0, 1);
+}
+
+/**
+ * @brief TimeSeriesColumn::encode Stores the column as Int16 or Delta16 raw values, each read back as
+ * raw*scale + offset. Only done if every value decodes to exactly the double it was.
+ * @return true if the column is now in the requested encoding
+ */
+bool TimeSeriesColumn::encode(Encoding encoding, double scale, double offset){
+    if(!pager.isNull() || type != Double || encoding == Double || encoding == Float32)
+        return encoding == type;
+    return encodeFixed(encoding, scale, offset, 1);
+}
+
+/**
+ * @brief TimeSeriesColumn::compact Stores the column in the smallest encoding that holds it without loss
+ */
+void TimeSeriesColumn::compact(){
+    if(!encode(Int16) && !encode(Delta16)){
+        encode(Float32);
+    }
+}
+
+/**
+ * @brief TimeSeriesColumn::compact Stores the column in the smallest encoding that holds it without loss, trying first
+ * the scale and offset its values were made with, such as those of a binary record field
+ */
+void TimeSeriesColumn::compact(double scale, double offset){
+    if(!encode(Int16, scale, offset) && !encode(Delta16, scale, offset)){
+        compact();
+    }
+}
+
+// Encodes the values as Int16 or Delta16 raw values, each read back as (raw*scale + offset) / divisor
+bool TimeSeriesColumn::encodeFixed(Encoding encoding, double scale, double offset, double divisor){
+    const double maxExactInteger = 9007199254740992.0; // 2^53
+    if(count == 0 || !std::isfinite(scale) || scale == 0)
+        return false;
+    qint64 minRaw = LLONG_MAX, maxRaw = LLONG_MIN;
+    for(int i=0; i<count; i++){
+        const double scaled = (values[i] * divisor - offset) / scale;
+        if(!(std::fabs(scaled) < maxExactInteger))
+            return false; // Out of range, infinite or NaN
+        const qint64 raw = std::llround(scaled);
+        minRaw = qMin(minRaw, raw);
+        maxRaw = qMax(maxRaw, raw);
+    }
+
+    TimeSeriesColumn encoded;
+    encoded.type = encoding;
+    encoded.count = count;
+    encoded.capacity = count;
+    encoded.scale = scale;
+    encoded.offset = offset;
+    encoded.divisor = divisor;
+    if(encoding == Int16){
+        if(maxRaw - minRaw > 0xFFFF)
+            return false;
+        // Center the range on zero so that it fits a signed 16-bit integer
+        const qint64 center = minRaw + 0x8000;
+        qint16 *r = static_cast<qint16 *>(qMallocAligned(qMax(size_t(count), size_t(1)) * sizeof(qint16), COLUMN_ALIGNMENT));
+        Q_CHECK_PTR(r);
+        encoded.packed = r;
+        encoded.zero = double(center);
+        for(int i=0; i<count; i++){
+            r[i] = qint16(std::llround((values[i] * divisor - offset) / scale) - center);
+        }
+    }
+    else if(encoding == Delta16){
+        const int numBlocks = (count + DELTA_BLOCK_ROWS - 1) / DELTA_BLOCK_ROWS;
+        quint16 *o = static_cast<quint16 *>(qMallocAligned(qMax(size_t(count), size_t(1)) * sizeof(quint16), COLUMN_ALIGNMENT));
+        Q_CHECK_PTR(o);
+        encoded.packed = o;
+        encoded.blockBase.resize(numBlocks);
+        for(int b=0; b<numBlocks; b++){
+            const int first = b * DELTA_BLOCK_ROWS;
+            const int last = qMin(count, first + DELTA_BLOCK_ROWS);
+            qint64 base = LLONG_MAX, top = LLONG_MIN;
+            for(int i=first; i<last; i++){
+                const qint64 raw = std::llround((values[i] * divisor - offset) / scale);
+                base = qMin(base, raw);
+                top = qMax(top, raw);
+            }
+            if(top - base > 0xFFFF)
+                return false;
+            encoded.blockBase[b] = base;
+            for(int i=first; i<last; i++){
+                o[i] = quint16(std::llround((values[i] * divisor - offset) / scale) - base);
+            }
+        }
+    }
+    else{
+        return false;
+    }
+    return keepIfLossless(encoded);
+}
+
+// Replaces the column with an encoded copy of it, if every value comes back exactly as it was, down to the sign of zero
+bool TimeSeriesColumn::keepIfLossless(TimeSeriesColumn &encoded){
+    double check[verifyBlockRows];
+    for(int start=0; start<count; start+=verifyBlockRows){
+        const int n = qMin(verifyBlockRows, count - start);
+        encoded.decode(start, n, check);
+        if(memcmp(check, values + start, size_t(n) * sizeof(double)) != 0)
+            return false;
+    }
+    *this = std::move(encoded);
+    return true;
+}
+
+/**
+ * Finds the smallest power of ten that turns every value into an integer. Values read from text with at most
+ * MAX_DECIMAL_DIGITS decimals qualify.
+ */
+bool TimeSeriesColumn::fixedPoint(double &divisor) const{
+    const double maxExactInteger = 9007199254740992.0; // 2^53
+    double power = 1;
+    for(int digits=0; digits<=MAX_DECIMAL_DIGITS; digits++, power *= 10){
+        bool integral = true;
+        for(int i=0; i<count && integral; i++){
+            const double scaled = values[i] * power;
+            if(!(std::fabs(scaled) < maxExactInteger)){
+                return false; // Out of range, infinite or NaN, and more digits will not help
+            }
+            integral = (double(std::llround(scaled)) / power == values[i]);
+        }
+        if(integral){
+            divisor = power;
+            return count > 0;
+        }
+    }
+    return false;
+}
+
+/**
+ * Estimates the step between the levels the values take, such as the weight of one count of a sensor whose counts
+ * were scaled to g (1/256 g, 3.9 mg) and do not fall on a decimal grid. The step is the greatest common divisor of
+ * the differences between successive values, to within rounding, and is then made exact where a value allows it.
+ * encodeFixed checks it either way.
+ * @param largest Receives the largest magnitude of any value
+ * @return false if the values are not finite, or have no step that is not lost in rounding
+ */
+bool TimeSeriesColumn::levelStep(double &step, double &largest) const{
+    step = 0;
+    largest = 0;
+    for(int i=0; i<count; i++){
+        const double v = values[i];
+        if(!std::isfinite(v))
+            return false;
+        largest = qMax(largest, std::fabs(v));
+        const double d = (i > 0) ? std::fabs(v - values[i - 1]) : 0;
+        if(d == 0)
+            continue;
+        if(step == 0){
+            step = d;
+            continue;
+        }
+        // Differences carry the rounding of the values they come from
+        const double tolerance = qMax(step, d) * stepTolerance + largest * std::numeric_limits<double>::epsilon() * 16;
+        const double steps = d / step;
+        if(std::fabs(steps - std::nearbyint(steps)) * step > tolerance){
+            // Taken as a whole number of the new steps from the larger of the two, so that rounding does not add up
+            const double common = commonStep(step, d, tolerance);
+            const double larger = qMax(step, d);
+            if(common <= tolerance)
+                return false;
+            step = larger / double(std::llround(larger / common));
+        }
+    }
+    if(step == 0)
+        return false;
+    // A value that is a power of two steps from zero gives the step exactly, as dividing by a power of two is exact
+    for(int i=0; i<count; i++){
+        const qint64 steps = std::llround(std::fabs(values[i]) / step);
+        if(steps > 0 && (steps & (steps - 1)) == 0){
+            step = std::fabs(values[i]) / double(steps);
+            break;
+        }
+    }
+    return true;
+}
+
+// Value of a single row of an encoded column
+qreal TimeSeriesColumn::decodeAt(int i) const{
+    switch(type){
+    case Float32:
+        return double(static_cast<const float *>(packed)[i]);
+    case Int16:
+        return ((double(static_cast<const qint16 *>(packed)[i]) + zero) * scale + offset) / divisor;
+    case Delta16:
+        return (double(blockBase.at(i / DELTA_BLOCK_ROWS) + static_cast<const quint16 *>(packed)[i]) * scale + offset) / divisor;
+    default:
+        return values[i];
+    }
+}
+
+// Decodes a range of rows of an encoded column. The loops are kept simple so that the compiler can vectorize them.
+void TimeSeriesColumn::decode(int start, int count, qreal *out) const{
+    const double scale = this->scale, offset = this->offset, divisor = this->divisor, zero = this->zero;
+    switch(type){
+    case Float32:{
+        const float *f = static_cast<const float *>(packed) + start;
+        for(int i=0; i<count; i++){
+            out[i] = double(f[i]);
+        }
+        break;
+    }
+    case Int16:{
+        const qint16 *r = static_cast<const qint16 *>(packed) + start;
+        for(int i=0; i<count; i++){
+            out[i] = ((double(r[i]) + zero) * scale + offset) / divisor;
+        }
+        break;
+    }
+    case Delta16:{
+        const quint16 *o = static_cast<const quint16 *>(packed);
+        const int end = start + count;
+        for(int first=start; first<end; ){
+            const int block = first / DELTA_BLOCK_ROWS;
+            const int last = qMin(end, (block + 1) * DELTA_BLOCK_ROWS);
+            const qint64 base = blockBase.at(block);
+            for(int i=first; i<last; i++){
+                out[i - start] = (double(base + o[i]) * scale + offset) / divisor;
+            }
+            first = last;
+        }
+        break;
+    }
+    default:
+        memcpy(out, values + start, size_t(count) * sizeof(double));
+    }
+}
+
+ColumnReader::ColumnReader(const TimeSeriesColumn *column){
+    this->column = column;
+}
+
+/**
+ * @brief ColumnReader::block Returns [count] contiguous values of the column starting at index [start]. The pointer
+ * is valid until the next call.
+ */
+const double *ColumnReader::block(int start, int count){
+    if(column->constData() != nullptr){
+        return column->constData() + start;
+    }
+    if(scratch.size() < count)
+        scratch.resize(count);
+    column->read(start, count, scratch.data());
+    return scratch.constData();
+}
@@ -0,0 +1,148 @@
+#ifndef TIMESERIESCOLUMN_H
+#define TIMESERIESCOLUMN_H
+
+#include <QList>
+#include <QSharedPointer>
+#include <QVector>
+#include "columnpager.h"
+
+// Alignment of in-memory column storage, in bytes. Matches a cache line, and suits any SIMD width.
+#define COLUMN_ALIGNMENT 64
+// Rows per block of a Delta16 encoded column. Each block has its own base value.
+#define DELTA_BLOCK_ROWS 4096
+// Largest power of ten tried when looking for a fixed-point representation of a column
+#define MAX_DECIMAL_DIGITS 6
+// Rows read at a time when only every few values of a column are wanted (see readStrided)
+#define STRIDED_READ_ROWS 65536
+
+/**
+ * @brief The ColumnSpan struct is a non-owning view of contiguous column values, in the spirit of std::span.
+ * It stays valid until the column it came from is modified or destroyed.
+ */
+struct ColumnSpan
+{
+    const double *data;
+    int size;
+
+    const double *begin() const { return data; }
+    const double *end() const { return data + size; }
+    double operator[](int i) const { return data[i]; }
+    bool isEmpty() const { return size == 0; }
+};
+
+/**
+ * @brief The TimeSeriesColumn class holds the values of a single TimeSeries column. Values either live in memory,
+ * or are paged in on demand from a cache file by a ColumnPager (see TimeSeriesCache::open), which allows working
+ * with data sets larger than the available memory. Both kinds of column are read the same way.
+ *
+ * In-memory values are stored contiguously in a COLUMN_ALIGNMENT aligned buffer owned by the column. Columns can
+ * be moved but not copied, so a column is never duplicated by accident on its way from the parser to a plot.
+ *
+ * Once a column is complete it can be stored more compactly (see compact). Encoded columns are decoded on access,
+ * and always give back exactly the doubles they were built from:
+ *  - Float32: values that are exactly representable as floats.
+ *  - Int16: fixed-point values, such as raw sensor counts, stored as 16-bit integers. A value is
+ *    ((raw + zero)*scale + offset) / divisor.
+ *  - Delta16: slowly changing fixed-point values with a large range, such as timestamps. Every DELTA_BLOCK_ROWS rows
+ *    share a 64-bit base, and each row stores its 16-bit distance from that base.
+ * Fixed-point values are either a whole number of decimals (divisor is a power of ten), a whole number of steps of a
+ * size found from the data (scale is the step, e.g. 1/256 g per count), or use the scale and offset they were made
+ * with, as given by the importer (see compact(double, double)).
+ */
+class TimeSeriesColumn
+{
+public:
+    enum Encoding { Double, Float32, Int16, Delta16 };
+
+    TimeSeriesColumn();
+    explicit TimeSeriesColumn(const QList<qreal> &values);
+    TimeSeriesColumn(QSharedPointer<ColumnPager> pager, int pagedColumn);
+    TimeSeriesColumn(TimeSeriesColumn &&other) Q_DECL_NOEXCEPT;
+    TimeSeriesColumn &operator=(TimeSeriesColumn &&other) Q_DECL_NOEXCEPT;
+    ~TimeSeriesColumn();
+
+    int size() const;
+    qreal at(int i) const;
+    qreal first() const;
+    qreal last() const;
+    bool isPaged() const;
+    QString getErrorString() const;
+    const double *constData() const;
+    ColumnSpan span() const;
+    ColumnSpan span(int start, int count) const;
+    void read(int start, int count, qreal *out) const;
+    void readStrided(int start, int count, int stride, qreal *out) const;
+    QVector<qreal> toVector() const;
+
+    void reserve(int capacity);
+    double *resize(int count);
+    qint16 *resizeInt16(int count, double scale, double offset);
+    void append(double value);
+    void append(const double *values, int count);
+    void clear();
+
+    Encoding encoding() const;
+    qint64 memoryUsage() const;
+    bool encode(Encoding encoding);
+    bool encode(Encoding encoding, double scale, double offset);
+    void compact();
+    void compact(double scale, double offset);
+
+private:
+    Q_DISABLE_COPY(TimeSeriesColumn)
+    void grow(int minCapacity);
+    qreal decodeAt(int i) const;
+    void decode(int start, int count, qreal *out) const;
+    bool encodeFixed(Encoding encoding, double scale, double offset, double divisor);
+    bool keepIfLossless(TimeSeriesColumn &encoded);
+    bool fixedPoint(double &divisor) const;
+    bool levelStep(double &step, double &largest) const;
+    void release();
+
+    // Only one of values (Double) and packed (any other encoding) is in use at a time
+    double *values;
+    void *packed;
+    Encoding type;
+    double scale, offset, divisor;
+    double zero;            // Added to Int16 raw values, which are centered on zero to fit
+    QVector<qint64> blockBase;
+    int count;
+    int capacity;
+    QSharedPointer<ColumnPager> pager;
+    int pagedColumn;
+};
+
+/**
+ * @brief The ColumnReader class walks through a column in blocks. Blocks of in-memory columns are returned in
+ * place; blocks of paged columns are copied into a scratch buffer first. Either way the caller gets a plain
+ * pointer to contiguous values, so loops over columns need not care where the data lives.
+ */
+class ColumnReader
+{
+public:
+    ColumnReader(const TimeSeriesColumn *column);
+    const double *block(int start, int count);
+
+private:
+    const TimeSeriesColumn *column;
+    QVector<double> scratch;
+};
+
+inline int TimeSeriesColumn::size() const{
+    return pager.isNull() ? count : int(pager->numRows());
+}
+
+inline qreal TimeSeriesColumn::at(int i) const{
+    if(!pager.isNull())
+        return pager->value(pagedColumn, i);
+    return (type == Double) ? values[i] : decodeAt(i);
+}
+
+inline void TimeSeriesColumn::append(double value){
+    Q_ASSERT(type == Double);
+    if(count == capacity)
+        grow(count + 1);
+    values[count++] = value;
+}
+
+#endif // TIMESERIESCOLUMN_H
@@ -0,0 +1,325 @@
+#include "timeseriesloader.h"
+#include "csvreader.h"
+#include "hdf5reader.h"
+#include "timeseriescache.h"
+#include "timeseriesmerge.h"
+#include <QFile>
+#include <QFileInfo>
+#include <QScopedPointer>
+#include <QtConcurrent>
+
+TimeSeriesLoader::TimeSeriesLoader(QObject *parent) : QObject(parent)
+{
+    generation = 0;
+    qRegisterMetaType<QList<QList<qreal>>>("QList<QList<qreal>>");
+
+    progressTimer.setInterval(LOAD_PROGRESS_INTERVAL);
+    connect(&progressTimer, SIGNAL(timeout()), this, SLOT(pollProgress()));
+    connect(&watcher, SIGNAL(finished()), this, SLOT(workerFinished()));
+    // Previews come from the worker thread, so they arrive here queued
+    connect(this, SIGNAL(workerPreview(int, QStringList, QList<QList<qreal>>)),
+            this, SLOT(gotWorkerPreview(int, QStringList, QList<QList<qreal>>)));
+}
+
+TimeSeriesLoader::~TimeSeriesLoader(){
+    discard();
+    // Canceled loads still emit previews from this object, and hand back data to delete
+    for(QFuture<Result> &future: canceled){
+        future.waitForFinished();
+    }
+    releaseCanceled();
+}
+
+/**
+ * @brief TimeSeriesLoader::start Starts loading data. Emits previewReady, then loaded or failed.
+ */
+void TimeSeriesLoader::start(const LoadRequest &request){
+    discard();
+    ++generation;
+    progress = QSharedPointer<LoadProgress>(new LoadProgress());
+    watcher.setFuture(QtConcurrent::run(this, &TimeSeriesLoader::run, generation, request, progress));
+    progressTimer.start();
+    emit progressChanged(0);
+}
+
+bool TimeSeriesLoader::isLoading() const{
+    return watcher.isRunning();
+}
+
+void TimeSeriesLoader::cancel(){
+    if(!progress.isNull()){
+        progress->cancel();
+    }
+}
+
+// Cancels the load in progress, if any, and throws away whatever it produces. Does not wait for it: it returns at its
+// next check for cancellation.
+void TimeSeriesLoader::discard(){
+    progressTimer.stop();
+    // A load that has finished but not yet been handed over still holds data
+    if(watcher.isRunning() || watcher.future().resultCount() > 0){
+        progress->cancel();
+        canceled.append(watcher.future());
+        // Forget the old future, along with any signals it has pending
+        watcher.setFuture(QFuture<Result>());
+    }
+    releaseCanceled();
+}
+
+// Deletes the data of canceled loads that have returned. Only the ones that have not yet are kept track of.
+void TimeSeriesLoader::releaseCanceled(){
+    for(int i=canceled.size() - 1; i>=0; i--){
+        if(canceled.at(i).isFinished()){
+            if(canceled.at(i).resultCount() > 0){
+                const Result result = canceled.at(i).result();
+                delete result.data;
+                delete result.streams;
+            }
+            canceled.removeAt(i);
+        }
+    }
+}
+
+void TimeSeriesLoader::gotWorkerPreview(int generation, QStringList columnNames, QList<QList<qreal>> rows){
+    if(generation == this->generation){
+        emit previewReady(columnNames, rows);
+    }
+}
+
+void TimeSeriesLoader::pollProgress(){
+    if(!progress.isNull()){
+        emit progressChanged(progress->percent());
+    }
+}
+
+void TimeSeriesLoader::workerFinished(){
+    progressTimer.stop();
+    if(watcher.future().resultCount() == 0){
+        return;
+    }
+    Result result = watcher.result();
+    watcher.setFuture(QFuture<Result>());
+    releaseCanceled();
+    // Results of superseded loads are dropped
+    if(result.generation != generation){
+        delete result.data;
+        delete result.streams;
+        return;
+    }
+    if(result.data != nullptr){
+        emit progressChanged(100);
+        emit loaded(result.data, result.streams);
+    }
+    else{
+        emit failed(result.error);
+    }
+}
+
+// Runs on a worker thread
+TimeSeriesLoader::Result TimeSeriesLoader::run(int generation, LoadRequest request, QSharedPointer<LoadProgress> progress){
+    Result result;
+    result.generation = generation;
+    result.data = nullptr;
+    result.streams = nullptr;
+
+    const QStringList &dataFileNames = request.dataFileNames;
+    const QStringList &selectedColumns = request.selectedColumns;
+    const bool binary = !request.layoutFileName.isEmpty();
+    RecordLayout layout;
+    if(binary && !layout.load(request.layoutFileName)){
+        result.error = QString("Record layout '%1'\ncannot be used:\n%2").arg(request.layoutFileName).arg(layout.getErrorString());
+        return result;
+    }
+    if(dataFileNames.isEmpty()){
+        return result;
+    }
+    const QString dataFileName = dataFileNames.first();
+    const bool hdf5 = !binary && HDF5Reader::isHDF5(dataFileName);
+    if(hdf5){
+        previewHDF5(generation, dataFileName);
+    }
+    else{
+        preview(generation, dataFileName, binary ? &layout : nullptr);
+    }
+
+    if(dataFileNames.size() > 1){
+        result = runMerge(dataFileNames, binary || hdf5, selectedColumns, progress);
+        result.generation = generation;
+        return result;
+    }
+    if(hdf5){
+        result = runHDF5(request, progress);
+        result.generation = generation;
+        return result;
+    }
+
+    QFile file(dataFileName);
+    QScopedPointer<TimeSeries> data(new TimeSeries());
+    bool openResult = false;
+    if(binary){
+        // Binary logger dump, read directly using its record layout
+        openResult = data->fromBinary(&file, layout, 0, progress.data());
+    }
+    else if(file.size() >= OUT_OF_CORE_BYTES){
+        // Too large to hold in memory: convert it to a cache if needed, and page columns in from there
+        openResult = TimeSeriesCache::open(dataFileName, 0, data.data()) ||
+                (TimeSeriesCache::build(&file, dataFileName, 0, progress.data()) && TimeSeriesCache::open(dataFileName, 0, data.data()));
+        file.close();
+    }
+    // Only parse the data file if it has changed since its cache was written
+    if(!openResult && !binary && !progress->isCanceled()){
+        openResult = TimeSeriesCache::load(dataFileName, 0, data.data(), selectedColumns);
+        if(!openResult){
+            openResult = data->fromCSV(&file, 0, progress.data(), selectedColumns);
+            // Only written when every column was parsed
+            if(openResult){
+                TimeSeriesCache::save(dataFileName, data.data());
+            }
+        }
+    }
+
+    if(progress->isCanceled()){
+        return result;
+    }
+    if(openResult){
+        result.data = data.take();
+    }
+    else{
+        result.error = QString("'%1'\ncannot be opened, or is not a valid data file.").arg(dataFileName);
+    }
+    return result;
+}
+
+/**
+ * Merges several CSV files by time. Files with the same columns as the first one are merged into the data set. Files
+ * with other columns are separate streams, recorded at rates of their own: each of those groups is merged on its own
+ * and kept beside the data set, rather than resampled onto its time column. Runs on the worker thread.
+ */
+TimeSeriesLoader::Result TimeSeriesLoader::runMerge(const QStringList &dataFileNames, bool binary, const QStringList &selectedColumns,
+                                                    QSharedPointer<LoadProgress> progress){
+    Result result;
+    result.generation = 0; // Set by run
+    result.data = nullptr;
+    result.streams = nullptr;
+    if(binary){
+        result.error = "Only CSV data files can be merged. Select a single binary or HDF5 data file.";
+        return result;
+    }
+    QList<QStringList> groups;
+    if(!TimeSeriesMerge::groupByColumns(dataFileNames, groups)){
+        result.error = QString("The %1 data files cannot be merged. Each of them must be a valid CSV data file.").arg(dataFileNames.size());
+        return result;
+    }
+    QScopedPointer<TimeSeries> data(new TimeSeries());
+    bool mergeResult = TimeSeriesMerge::merge(groups.first(), 0, data.data(), progress.data(), selectedColumns);
+    QScopedPointer<StreamSet> streams((groups.size() > 1) ? new StreamSet() : nullptr);
+    for(int g=1; g<groups.size() && mergeResult && !progress->isCanceled(); g++){
+        // Columns are only selected for the data set, whose preview they were picked from
+        QSharedPointer<TimeSeries> stream(new TimeSeries());
+        mergeResult = TimeSeriesMerge::merge(groups.at(g), 0, stream.data(), progress.data());
+        streams->addStream(QFileInfo(groups.at(g).first()).completeBaseName(), stream);
+    }
+    if(progress->isCanceled()){
+        return result;
+    }
+    if(mergeResult){
+        result.data = data.take();
+        result.streams = streams.take();
+    }
+    else{
+        result.error = QString("The %1 data files cannot be merged. Each of them must be a valid CSV data file, "
+                               "with a time column first.").arg(dataFileNames.size());
+    }
+    return result;
+}
+
+// Reads the selected datasets and time range of an HDF5 file. Runs on the worker thread.
+TimeSeriesLoader::Result TimeSeriesLoader::runHDF5(const LoadRequest &request, QSharedPointer<LoadProgress> progress){
+    Result result;
+    result.generation = 0; // Set by run
+    result.data = nullptr;
+    result.streams = nullptr;
+    const QString dataFileName = request.dataFileNames.first();
+    HDF5Reader reader;
+    QScopedPointer<TimeSeries> data(new TimeSeries());
+    const bool readResult = reader.open(dataFileName) &&
+            reader.read(data.data(), request.selectedColumns, request.rangeStart, request.rangeEnd, progress.data());
+    if(progress->isCanceled()){
+        return result;
+    }
+    if(readResult){
+        result.data = data.take();
+    }
+    else{
+        result.error = QString("'%1'\ncannot be read:\n%2").arg(dataFileName).arg(reader.getErrorString());
+    }
+    return result;
+}
+
+/**
+ * Reads just the first few rows of a data file and hands them to the GUI, long before the whole file is parsed.
+ * Runs on the worker thread.
+ */
+void TimeSeriesLoader::preview(int generation, const QString &dataFileName, const RecordLayout *layout){
+    QFile file(dataFileName);
+    if(!file.open(QFile::ReadOnly)){
+        return;
+    }
+    const QByteArray head = file.read(PREVIEW_BYTES);
+    const bool wholeFile = file.atEnd();
+
+    QStringList columnNames;
+    std::vector<TimeSeriesColumn> columns;
+    if(layout == nullptr){
+        const char *begin = head.constData();
+        const char *end = begin + head.size();
+        const char *body = CSVReader::nextLine(begin, end);
+        columnNames = QString(QByteArray::fromRawData(begin, int(body - begin))).trimmed().split(REGEX_COMMASEP, QString::KeepEmptyParts);
+        // Only take complete lines; the last one read may have been cut short
+        const char *last = body;
+        for(int row=0; row<PREVIEW_ROWS && last < end; row++){
+            const char *next = CSVReader::nextLine(last, end);
+            if(next == end && !wholeFile && end[-1] != '\n')
+                break;
+            last = next;
+        }
+        columns.resize(columnNames.size());
+        CSVReader::parseRows(body, last, columns);
+    }
+    else{
+        for(const RecordField &field: layout->fields){
+            columnNames.append(field.name);
+        }
+        const qint64 available = (head.size() - layout->headerSize) / layout->recordSize;
+        const int numRecords = int(qBound(qint64(0), available, qint64(PREVIEW_ROWS)));
+        if(numRecords > 0){
+            BinaryReader::decodeRecords(reinterpret_cast<const uchar *>(head.constData()) + layout->headerSize, numRecords, *layout, columns);
+        }
+    }
+
+    QList<QList<qreal>> rows;
+    const int numRows = columns.empty() ? 0 : columns.front().size();
+    for(int row=0; row<numRows; row++){
+        QList<qreal> values;
+        for(const TimeSeriesColumn &column: columns){
+            values.append(column.at(row));
+        }
+        rows.append(values);
+    }
+    emit workerPreview(generation, columnNames, rows, QPrivateSignal());
+}
+
+// Like preview, for HDF5 files. Only the first chunk of each dataset is read.
+void TimeSeriesLoader::previewHDF5(int generation, const QString &dataFileName){
+    HDF5Reader reader;
+    TimeSeries data;
+    if(!reader.open(dataFileName) || !reader.read(&data, QStringList(), -std::numeric_limits<double>::infinity(),
+                                                   std::numeric_limits<double>::infinity(), nullptr, PREVIEW_ROWS)){
+        return;
+    }
+    QList<QList<qreal>> rows;
+    for(int row=0; row<data.numRows(); row++){
+        rows.append(data.rowData(row));
+    }
+    emit workerPreview(generation, reader.columnNames(), rows, QPrivateSignal());
+}
@@ -0,0 +1,102 @@
+#ifndef TIMESERIESLOADER_H
+#define TIMESERIESLOADER_H
+
+#include <QFutureWatcher>
+#include <QList>
+#include <QObject>
+#include <QSharedPointer>
+#include <QStringList>
+#include <QTimer>
+#include <limits>
+#include "binaryreader.h"
+#include "loadprogress.h"
+#include "streamset.h"
+#include "timeseries.h"
+
+// Number of rows shown in the preview of a data file
+#define PREVIEW_ROWS 10
+// Bytes read from the start of a data file to build its preview
+#define PREVIEW_BYTES (64*1024)
+// Interval between progress updates while loading, in ms
+#define LOAD_PROGRESS_INTERVAL 100
+
+/**
+ * @brief The LoadRequest struct says what TimeSeriesLoader::start is to load
+ */
+struct LoadRequest
+{
+    // The data file, or several CSV files of one deployment to be merged by time. CSV files with other columns than
+    // the first one are loaded as separate streams (see TimeSeriesLoader::loaded).
+    QStringList dataFileNames;
+    // Record layout of a binary dump, or empty for CSV or HDF5 data
+    QString layoutFileName;
+    // Columns to read up front, or empty for all. See TimeSeries::fromCSV.
+    QStringList selectedColumns;
+    // Time range read from HDF5 files. Other formats are always read whole.
+    double rangeStart = -std::numeric_limits<double>::infinity();
+    double rangeEnd = std::numeric_limits<double>::infinity();
+};
+
+/**
+ * @brief The TimeSeriesLoader class loads a data file into a TimeSeries on a worker thread, so that the GUI stays
+ * responsive while large files are parsed. It picks the fastest way in (cache, paged cache, CSV, binary dump, HDF5,
+ * or a merge of several CSV files),
+ * reports a preview of the first rows as soon as they are read, reports progress while the rest is parsed, and can
+ * be canceled at any time. Starting a new load cancels the one in progress without waiting for it; what it produces
+ * is thrown away by generation once it returns.
+ */
+class TimeSeriesLoader : public QObject
+{
+    Q_OBJECT
+public:
+    explicit TimeSeriesLoader(QObject *parent = nullptr);
+    ~TimeSeriesLoader();
+    void start(const LoadRequest &request);
+    bool isLoading() const;
+
+signals:
+    void previewReady(QStringList columnNames, QList<QList<qreal>> rows);
+    void progressChanged(int percent);
+    // The receiver takes ownership of data, and of streams. Streams holds the data files whose columns differ from
+    // those of the first file, at their own rates, or is null if there are none.
+    void loaded(TimeSeries *data, StreamSet *streams);
+    // Empty if the load was canceled
+    void failed(QString error);
+
+    // Carries previews from the worker thread to gotWorkerPreview. Only emitted by the loader itself.
+    void workerPreview(int generation, QStringList columnNames, QList<QList<qreal>> rows, QPrivateSignal);
+
+public slots:
+    void cancel();
+
+private slots:
+    void gotWorkerPreview(int generation, QStringList columnNames, QList<QList<qreal>> rows);
+    void pollProgress();
+    void workerFinished();
+
+private:
+    struct Result{
+        int generation; // Which load this is
+        TimeSeries *data;
+        StreamSet *streams;
+        QString error;
+    };
+
+    Result run(int generation, LoadRequest request, QSharedPointer<LoadProgress> progress);
+    Result runHDF5(const LoadRequest &request, QSharedPointer<LoadProgress> progress);
+    Result runMerge(const QStringList &dataFileNames, bool binary, const QStringList &selectedColumns, QSharedPointer<LoadProgress> progress);
+    void preview(int generation, const QString &dataFileName, const RecordLayout *layout);
+    void previewHDF5(int generation, const QString &dataFileName);
+    void discard();
+    void releaseCanceled();
+
+    QFutureWatcher<Result> watcher;
+    QTimer progressTimer;
+    QSharedPointer<LoadProgress> progress;
+    // Identifies the current load, so that previews of earlier ones are ignored
+    int generation;
+    // Canceled loads, whose data is deleted once they return
+    QList<QFuture<Result>> canceled;
+};
+
+#endif // TIMESERIESLOADER_H
@@ -0,0 +1,236 @@
+#include "timeseriesmerge.h"
+#include "csvreader.h"
+#include <QFile>
+#include <QSharedPointer>
+#include <climits>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <utility>
+#include <vector>
+
+namespace {
+// One of the files being merged, along with the block of its rows parsed most recently
+struct MergeInput{
+    QFile file;
+    QByteArray buffer;
+    uchar *mapped;
+    const char *next;   // Start of the first line that has not been parsed yet
+    const char *end;
+    std::vector<TimeSeriesColumn> block;
+    int row;            // Next row of block to be merged
+    double lastTime;    // Time of the last row of the file that was merged
+    double period;      // Smallest spacing between rows of the file so far, or 0 until known. Gaps do not change it.
+};
+
+// Maps a data file and reads its header
+bool openInput(MergeInput &input, const QString &fileName, QStringList &header){
+    input.file.setFileName(fileName);
+    input.mapped = nullptr;
+    if(!input.file.open(QFile::ReadOnly) || input.file.size() == 0)
+        return false;
+
+    qint64 length = input.file.size();
+    const char *begin;
+    input.mapped = input.file.map(0, length);
+    if(input.mapped != nullptr){
+        begin = reinterpret_cast<const char *>(input.mapped);
+    }
+    else{
+        // Not every device can be mapped, so fall back to reading the whole thing
+        input.buffer = input.file.readAll();
+        begin = input.buffer.constData();
+        length = input.buffer.size();
+    }
+    input.end = begin + length;
+    input.next = CSVReader::nextLine(begin, input.end);
+    input.row = 0;
+    input.lastTime = -std::numeric_limits<double>::infinity();
+    input.period = 0;
+    header = QString(QByteArray::fromRawData(begin, int(input.next - begin))).trimmed().split(REGEX_COMMASEP, QString::KeepEmptyParts);
+    return true;
+}
+
+// Parses the next block of rows of a file, replacing the previous block
+void readBlock(MergeInput &input, const QVector<bool> &selected, LoadProgress *progress){
+    const char *blockEnd = input.next;
+    for(int i=0; i<MERGE_BLOCK_ROWS && blockEnd < input.end; i++){
+        blockEnd = CSVReader::nextLine(blockEnd, input.end);
+    }
+    for(TimeSeriesColumn &column: input.block){
+        column.clear();
+    }
+    CSVReader::parseRows(input.next, blockEnd, input.block, nullptr, selected);
+    if(progress != nullptr){
+        progress->add(blockEnd - input.next);
+    }
+    input.next = blockEnd;
+    input.row = 0;
+}
+
+/**
+ * Moves a file on to its next row that does not go back in time, parsing blocks as needed. Rows that do are skipped
+ * and counted in [skipped].
+ * @return false once the file is done, or the merge was canceled
+ */
+bool advance(MergeInput &input, int timeColumn, const QVector<bool> &selected, LoadProgress *progress, qint64 &skipped){
+    for(;;){
+        const TimeSeriesColumn &time = input.block[timeColumn];
+        if(input.row == time.size()){
+            if(input.next >= input.end)
+                return false;
+            readBlock(input, selected, progress);
+            if(progress != nullptr && progress->isCanceled())
+                return false;
+            continue;
+        }
+        const double t = time.at(input.row);
+        if(!(t >= input.lastTime)){
+            ++skipped;
+            ++input.row;
+            continue;
+        }
+        // Before the file's second row, the spacing to the row after it stands in
+        const double spacing = !std::isinf(input.lastTime) ? t - input.lastTime :
+                               (input.row + 1 < time.size()) ? time.at(input.row + 1) - t : 0;
+        if(spacing > 0)
+            input.period = (input.period > 0) ? qMin(input.period, spacing) : spacing;
+        input.lastTime = t;
+        return true;
+    }
+}
+}
+
+/**
+ * @brief TimeSeriesMerge::groupByColumns Groups files that have the same columns, in the order they are first listed
+ * @param groups Receives one list of files per distinct header
+ * @return false if a file cannot be read
+ */
+bool TimeSeriesMerge::groupByColumns(const QStringList &dataFileNames, QList<QStringList> &groups){
+    QList<QStringList> headers;
+    groups.clear();
+    for(const QString &fileName: dataFileNames){
+        QFile file(fileName);
+        if(!file.open(QFile::ReadOnly) || file.size() == 0)
+            return false;
+        const QStringList header = QString(file.readLine()).trimmed().split(REGEX_COMMASEP, QString::KeepEmptyParts);
+        int group = headers.indexOf(header);
+        if(group < 0){
+            headers.append(header);
+            groups.append(QStringList());
+            group = groups.size() - 1;
+        }
+        groups[group].append(fileName);
+    }
+    return true;
+}
+
+/**
+ * @brief TimeSeriesMerge::merge Merges the rows of several CSV files into one TimeSeries, ordered by time
+ * @param dataFileNames The files. Where they overlap, rows of files listed first are kept.
+ * @param ts An empty TimeSeries to fill
+ * @param progress If given, follows the merge and can cancel it
+ * @param selectedColumns Names of the columns to read now, or empty for all of them. See TimeSeries::fromCSV.
+ * @param duplicates If given, receives the number of rows dropped because their time had already been taken
+ * @param outOfOrder If given, receives the number of rows skipped because their time was below that of the row before
+ * them in their file
+ * @return false if a file cannot be read, the files do not all have the same columns, or the merge was canceled
+ */
+bool TimeSeriesMerge::merge(const QStringList &dataFileNames, int timeColumn, TimeSeries *ts, LoadProgress *progress,
+                            const QStringList &selectedColumns, qint64 *duplicates, qint64 *outOfOrder){
+    if(dataFileNames.isEmpty())
+        return false;
+
+    std::vector<QSharedPointer<MergeInput>> inputs;
+    QStringList header;
+    qint64 totalBytes = 0;
+    qint64 estimatedRows = 0;
+    for(const QString &fileName: dataFileNames){
+        QSharedPointer<MergeInput> input(new MergeInput());
+        QStringList fileHeader;
+        if(!openInput(*input, fileName, fileHeader))
+            return false;
+        if(inputs.empty())
+            header = fileHeader;
+        else if(fileHeader != header)
+            return false;
+        totalBytes += input->end - input->next;
+        estimatedRows += CSVReader::estimateRows(input->next, input->end);
+        inputs.push_back(input);
+    }
+    if(timeColumn < 0 || timeColumn >= header.size())
+        return false;
+    if(progress != nullptr)
+        progress->setTotal(totalBytes);
+
+    const QVector<bool> selected = CSVReader::selectColumns(header, selectedColumns, timeColumn);
+    std::vector<TimeSeriesColumn> columns(header.size());
+    for(int col=0; col<header.size(); col++){
+        if(selected.at(col))
+            columns[col].reserve(int(qMin(estimatedRows, qint64(INT_MAX/2))));
+    }
+
+    // Next row of each file, earliest time first. Ties go to the file listed first.
+    typedef std::pair<double, int> Head;
+    std::priority_queue<Head, std::vector<Head>, std::greater<Head>> heads;
+    qint64 skipped = 0;
+    for(int i=0; i<int(inputs.size()); i++){
+        MergeInput &input = *inputs[i];
+        input.block.resize(header.size());
+        if(advance(input, timeColumn, selected, progress, skipped))
+            heads.push(Head(input.block[timeColumn].at(input.row), i));
+    }
+
+    qint64 dropped = 0;
+    int lastInput = -1; // File of the last row taken
+    while(!heads.empty()){
+        const Head head = heads.top();
+        heads.pop();
+        MergeInput &input = *inputs[head.second];
+
+        // Overlapping files repeat rows; the output is sorted, so a repeat always follows the row it repeats. Only rows
+        // of different files are matched within a tolerance: rows of one file are all genuine samples.
+        const TimeSeriesColumn &time = columns[timeColumn];
+        double tolerance = 0;
+        if(lastInput >= 0 && lastInput != head.second)
+            tolerance = MERGE_TIME_TOLERANCE * qMin(input.period, inputs[lastInput]->period);
+        if(time.size() > 0 && head.first - time.last() <= tolerance){
+            ++dropped;
+        }
+        else{
+            for(int col=0; col<header.size(); col++){
+                if(selected.at(col))
+                    columns[col].append(input.block[col].at(input.row));
+            }
+            lastInput = head.second;
+        }
+
+        ++input.row;
+        if(advance(input, timeColumn, selected, progress, skipped))
+            heads.push(Head(input.block[timeColumn].at(input.row), head.second));
+    }
+    // A canceled file stops advancing as if it were done
+    if(progress != nullptr && progress->isCanceled())
+        return false;
+
+    for(const QSharedPointer<MergeInput> &input: inputs){
+        if(input->mapped != nullptr)
+            input->file.unmap(input->mapped);
+    }
+
+    for(int col=0; col<header.size(); col++){
+        if(selected.at(col))
+            ts->addColumn(header.at(col), std::move(columns[col]));
+        else
+            ts->addColumn(header.at(col));
+    }
+    ts->setSourceFiles(dataFileNames);
+    ts->setTimeColumn(timeColumn);
+    ts->compact();
+    if(duplicates != nullptr)
+        *duplicates = dropped;
+    if(outOfOrder != nullptr)
+        *outOfOrder = skipped;
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef TIMESERIESMERGE_H
+#define TIMESERIESMERGE_H
+
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include "loadprogress.h"
+#include "timeseries.h"
+
+// Lines parsed from one file at a time while merging
+#define MERGE_BLOCK_ROWS 65536
+// Rows of overlapping files closer in time than this fraction of the sample period are the same row
+#define MERGE_TIME_TOLERANCE 0.5
+
+/**
+ * TimeSeriesMerge stitches the CSV files of one deployment (e.g. a logger that starts a new file every few hours)
+ * into a single TimeSeries. All files must have the same columns. Their rows are merged by time in one streaming
+ * pass: each file is parsed a block of rows at a time, and the row with the earliest time among the files' next
+ * rows is taken, so neither the files nor their concatenation are ever held in memory as text.
+ *
+ * Where files overlap, rows whose time has already been taken are dropped, keeping the earlier row, or the one from
+ * the file listed first if their times are equal. Times count as taken within MERGE_TIME_TOLERANCE of a sample period, since files written by different
+ * runs of a logger need not print them identically. Each file must be sorted by time: rows whose time is below that
+ * of the row before them in their file (e.g. a blank or cut-off last line, which reads as 0) are skipped. Gaps
+ * between files are left as they are; they show up in the TimeIndex of the result like any other gap.
+ *
+ * Files with different columns are not parts of the same recording but separate streams (e.g. acceleration and
+ * pressure logged at different rates). groupByColumns sorts them out, so that each stream can be merged on its own.
+ */
+namespace TimeSeriesMerge{
+    bool groupByColumns(const QStringList &dataFileNames, QList<QStringList> &groups);
+    bool merge(const QStringList &dataFileNames, int timeColumn, TimeSeries *ts, LoadProgress *progress = nullptr,
+               const QStringList &selectedColumns = QStringList(), qint64 *duplicates = nullptr,
+               qint64 *outOfOrder = nullptr);
+}
+
+#endif // TIMESERIESMERGE_H
@@ -0,0 +1,186 @@
+#include "timeseriesresample.h"
+#include <QSaveFile>
+#include <QSettings>
+#include <QVector>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+// Stores a double as little-endian float64
+void storeDouble(double value, uchar *p){
+    quint64 bits;
+    memcpy(&bits, &value, sizeof(bits));
+    qToLittleEndian<quint64>(bits, p);
+}
+}
+
+/**
+ * @brief TimeSeriesResample::interpolate Evaluates columns at sorted timestamps
+ * @param columns Indices of the columns to evaluate
+ * @param times The timestamps, in ascending order
+ * @param count Number of timestamps
+ * @param out Receives count rows of columns.size() values each, row by row
+ */
+void TimeSeriesResample::interpolate(TimeSeries *ts, const QList<int> &columns, const double *times, int count, double *out){
+    const int numColumns = columns.size();
+    const int rows = ts->numRows();
+    if(count <= 0 || numColumns == 0){
+        return;
+    }
+    if(rows == 0){
+        std::fill(out, out + qint64(count) * numColumns, std::numeric_limits<double>::quiet_NaN());
+        return;
+    }
+
+    // Rows of the data that the timestamps fall between. Only these are read, whatever the encoding of the columns.
+    const int first = qMax(0, ts->indexOfLEQ(times[0], 0, rows - 1));
+    const int last = qMin(rows - 1, qMax(0, ts->indexOfLEQ(times[count - 1], 0, rows - 1)) + 1);
+    const int span = last - first + 1;
+    QVector<double> values(span);
+    ts->timeColumnData()->read(first, span, values.data());
+
+    // Merge the timestamps with the time column: each gets the sample before it and its weight towards the next
+    QVector<int> before(count);
+    QVector<double> weight(count);
+    const double *time = values.constData();
+    int k = 0;
+    for(int i=0; i<count; i++){
+        const double t = times[i];
+        while(k + 1 < span && time[k + 1] <= t){
+            ++k;
+        }
+        before[i] = k;
+        if(!(t >= time[0] && t <= time[span - 1]))
+            weight[i] = std::numeric_limits<double>::quiet_NaN(); // Out of range, and spreads to every column
+        else if(k + 1 < span)
+            weight[i] = (t - time[k]) / (time[k + 1] - time[k]);
+        else
+            weight[i] = 0;
+    }
+
+    for(int c=0; c<numColumns; c++){
+        ts->getColumn(columns.at(c))->read(first, span, values.data());
+        const double *v = values.constData();
+        double *o = out + c;
+        for(int i=0; i<count; i++){
+            const int a = before.at(i);
+            const int b = qMin(a + 1, span - 1);
+            o[qint64(i) * numColumns] = v[a] + (v[b] - v[a]) * weight.at(i);
+        }
+    }
+}
+
+/**
+ * @brief TimeSeriesResample::exportFrames Writes the data at every frame of a video to a file, one row per frame. Each
+ * row holds the data time of the frame, the frame number and the interpolated value of every other column.
+ *
+ * CSV files have a header line. Binary files hold little-endian float64 records, and come with a record layout
+ * ([fileName].ini) that can be used to load them again.
+ * @param frameInterval Time between frames, in ms
+ * @param startTime Data time of the first frame
+ * @param rate Seconds of data time per second of video
+ * @param error If given, receives a description of what went wrong
+ * @return false if the file cannot be written
+ */
+bool TimeSeriesResample::exportFrames(TimeSeries *ts, int numFrames, double frameInterval, double startTime, double rate,
+                                      const QString &fileName, Format format, QString *error){
+    QList<int> columns;
+    QStringList names;
+    for(int col=0; col<ts->numColumns(); col++){
+        if(col != ts->getTimeColumn()){
+            columns.append(col);
+            names.append(ts->columnName(col));
+        }
+    }
+    const int numColumns = columns.size();
+
+    QSaveFile file(fileName);
+    if(!file.open(QFile::WriteOnly)){
+        if(error != nullptr)
+            *error = QString("'%1'\ncannot be written.").arg(fileName);
+        return false;
+    }
+    if(format == CSV){
+        file.write(QString("Time,Frame,%1\n").arg(names.join(",")).toUtf8());
+    }
+
+    QVector<double> times(RESAMPLE_BLOCK_ROWS);
+    QVector<double> values(RESAMPLE_BLOCK_ROWS * numColumns);
+    QByteArray block;
+    for(int start=0; start<numFrames; start+=RESAMPLE_BLOCK_ROWS){
+        const int n = qMin(RESAMPLE_BLOCK_ROWS, numFrames - start);
+        for(int i=0; i<n; i++){
+            times[i] = rate*((start + i)*frameInterval/1000.0) + startTime;
+        }
+        interpolate(ts, columns, times.constData(), n, values.data());
+
+        block.clear();
+        if(format == CSV){
+            for(int i=0; i<n; i++){
+                block.append(QByteArray::number(times.at(i), 'g', 15)).append(',').append(QByteArray::number(start + i));
+                for(int c=0; c<numColumns; c++){
+                    const double value = values.at(i*numColumns + c);
+                    block.append(',');
+                    // Frames outside the data are left blank
+                    if(!std::isnan(value))
+                        block.append(QByteArray::number(value, 'g', 15));
+                }
+                block.append('\n');
+            }
+        }
+        else{
+            block.resize(n * (numColumns + 2) * int(sizeof(double)));
+            uchar *p = reinterpret_cast<uchar *>(block.data());
+            for(int i=0; i<n; i++){
+                storeDouble(times.at(i), p);
+                storeDouble(double(start + i), p + sizeof(double));
+                p += 2*sizeof(double);
+                for(int c=0; c<numColumns; c++){
+                    storeDouble(values.at(i*numColumns + c), p);
+                    p += sizeof(double);
+                }
+            }
+        }
+        if(file.write(block) != block.size()){
+            file.cancelWriting();
+            break;
+        }
+    }
+    // Rows of data that could not be read are NaN, so the export is not kept
+    const QString dataError = ts->getErrorString();
+    if(!dataError.isEmpty()){
+        file.cancelWriting();
+        if(error != nullptr)
+            *error = dataError;
+        return false;
+    }
+    if(!file.commit()){
+        if(error != nullptr)
+            *error = QString("'%1'\ncould not be written completely.").arg(fileName);
+        return false;
+    }
+
+    if(format == Binary){
+        QSettings layout(fileName + ".ini", QSettings::IniFormat);
+        layout.clear();
+        layout.beginGroup("record");
+        layout.setValue("size", (numColumns + 2) * int(sizeof(double)));
+        layout.setValue("header", 0);
+        layout.setValue("byteorder", "little");
+        layout.endGroup();
+        layout.beginWriteArray("fields");
+        const QStringList fields = QStringList() << "Time" << "Frame" << names;
+        for(int i=0; i<fields.size(); i++){
+            layout.setArrayIndex(i);
+            layout.setValue("name", fields.at(i));
+            layout.setValue("offset", i * int(sizeof(double)));
+            layout.setValue("type", "float64");
+        }
+        layout.endArray();
+        layout.sync();
+    }
+    return true;
+}
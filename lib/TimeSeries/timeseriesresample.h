@@ -0,0 +1,28 @@
+#ifndef TIMESERIESRESAMPLE_H
+#define TIMESERIESRESAMPLE_H
+
+#include <QList>
+#include <QString>
+#include "timeseries.h"
+
+// Timestamps resampled at a time when exporting
+#define RESAMPLE_BLOCK_ROWS 4096
+
+/**
+ * TimeSeriesResample evaluates the columns of a TimeSeries at many timestamps at once, e.g. at every frame of a video,
+ * by linear interpolation between the samples either side. The timestamps must be sorted. They are merged with the
+ * time column in a single pass, which finds the pair of samples around each timestamp and how far between them it
+ * lies; every column is then interpolated with those same weights in one tight loop, without any per-timestamp
+ * lookups or allocations.
+ *
+ * Timestamps before the first sample or after the last one have no value, and come out as NaN.
+ */
+namespace TimeSeriesResample{
+    enum Format { CSV, Binary };
+
+    void interpolate(TimeSeries *ts, const QList<int> &columns, const double *times, int count, double *out);
+    bool exportFrames(TimeSeries *ts, int numFrames, double frameInterval, double startTime, double rate,
+                      const QString &fileName, Format format, QString *error = nullptr);
+}
+
+#endif // TIMESERIESRESAMPLE_H